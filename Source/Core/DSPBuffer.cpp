@@ -0,0 +1,165 @@
+/*
+  ==============================================================================
+
+    DSPBuffer.cpp
+
+  ==============================================================================
+*/
+
+#include "DSPBuffer.h"
+
+#include <cassert>
+#include <cstdlib>
+
+#if defined (__linux__) || defined (__APPLE__)
+ #define INFATUATION_POSIX 1
+ #include <sys/mman.h>
+ #include <sys/resource.h>
+ #include <unistd.h>
+#else
+ #define INFATUATION_POSIX 0
+#endif
+
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+//==============================================================================
+DSPBuffer::DSPBuffer (bool shouldLockPages)
+    : mShouldLockPages (shouldLockPages)
+{
+}
+
+DSPBuffer::~DSPBuffer()
+{
+    free();
+}
+
+void DSPBuffer::allocate (size_t numFloats)
+{
+    free();
+
+    if (numFloats == 0)
+        return;
+
+    size_t numBytes = numFloats * sizeof (float);
+
+   #if INFATUATION_POSIX
+    size_t pageSize = (size_t) sysconf (_SC_PAGESIZE);
+    void* address = MAP_FAILED;
+
+   #if defined (__linux__)
+    // explicit huge pages first, they only exist if the admin reserved some
+    if (numBytes >= HUGE_PAGE_SIZE)
+    {
+        size_t hugeBytes = (numBytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+        address = mmap (nullptr, hugeBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+        if (address != MAP_FAILED)
+        {
+            mNumBytesMapped = hugeBytes;
+            mUsesHugePages = true;
+        }
+    }
+   #endif
+
+    if (address == MAP_FAILED)
+    {
+        mNumBytesMapped = (numBytes + pageSize - 1) / pageSize * pageSize;
+        address = mmap (nullptr, mNumBytesMapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+       #if defined (__linux__)
+        // otherwise ask for transparent huge pages, which the kernel may or may not honour
+        if (address != MAP_FAILED && mNumBytesMapped >= HUGE_PAGE_SIZE)
+            madvise (address, mNumBytesMapped, MADV_HUGEPAGE);
+       #endif
+    }
+
+    if (address != MAP_FAILED)
+    {
+        mData = static_cast<float*> (address);
+        mIsMapped = true;
+
+        if (mShouldLockPages)
+            mIsLocked = mlock (address, mNumBytesMapped) == 0;
+    }
+   #endif
+
+    if (mData == nullptr)
+    {
+        mData = static_cast<float*> (std::calloc (numFloats, sizeof (float)));
+        mNumBytesMapped = numBytes;
+
+        if (mData == nullptr)
+        {
+            mNumBytesMapped = 0;
+            assert (false);
+            return;
+        }
+    }
+
+    mNumFloats = numFloats;
+
+    // Anonymous mappings read as zero but aren't backed until written, so
+    // touch every page here rather than on the audio thread
+    auto* bytes = reinterpret_cast<volatile char*> (mData);
+
+    for (size_t offset = 0; offset < numBytes; offset += 4096)
+        bytes[offset] = 0;
+
+    bytes[numBytes - 1] = 0;
+}
+
+void DSPBuffer::free()
+{
+    if (mData == nullptr)
+        return;
+
+   #if INFATUATION_POSIX
+    if (mIsMapped)
+    {
+        if (mIsLocked)
+            munlock (mData, mNumBytesMapped);
+
+        munmap (mData, mNumBytesMapped);
+    }
+    else
+   #endif
+    {
+        std::free (mData);
+    }
+
+    mData = nullptr;
+    mNumFloats = 0;
+    mNumBytesMapped = 0;
+
+    mIsMapped = false;
+    mIsLocked = false;
+    mUsesHugePages = false;
+}
+
+void DSPBuffer::setShouldLockPages (bool shouldLock)
+{
+    mShouldLockPages = shouldLock;
+
+   #if INFATUATION_POSIX
+    if (mIsMapped && shouldLock && ! mIsLocked)
+        mIsLocked = mlock (mData, mNumBytesMapped) == 0;
+
+    if (mIsMapped && ! shouldLock && mIsLocked)
+    {
+        munlock (mData, mNumBytesMapped);
+        mIsLocked = false;
+    }
+   #endif
+}
+
+int64_t DSPBuffer::getThreadPageFaults() noexcept
+{
+   #if defined (__linux__)
+    struct rusage usage;
+
+    if (getrusage (RUSAGE_THREAD, &usage) == 0)
+        return (int64_t) usage.ru_minflt + (int64_t) usage.ru_majflt;
+   #endif
+
+    return 0;
+}
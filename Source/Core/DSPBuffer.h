@@ -0,0 +1,63 @@
+/*
+  ==============================================================================
+
+    DSPBuffer.h
+
+    Zeroed float storage for the delay lines and other state the audio
+    thread touches. Every page is faulted in when the buffer is allocated,
+    so the first pass of the write head doesn't page-fault on the audio
+    thread. Where the OS allows it the memory is also locked, so an idle
+    instance can't be swapped out, and backed by huge pages to save TLB
+    misses. Either of those failing (RLIMIT_MEMLOCK, no huge pages
+    configured) just falls back to ordinary pre-faulted memory.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+//==============================================================================
+/**
+*/
+class DSPBuffer
+{
+public:
+    DSPBuffer (bool shouldLockPages = true);
+    ~DSPBuffer();
+
+    // Frees any previous allocation. Not for the audio thread.
+    void allocate (size_t numFloats);
+    void free();
+
+    // Locks or unlocks the memory already allocated, and decides whether
+    // later allocations are locked. Not for the audio thread.
+    void setShouldLockPages (bool shouldLock);
+
+    float* getData() const noexcept              { return mData; }
+    size_t getNumFloats() const noexcept         { return mNumFloats; }
+    size_t getNumBytesAllocated() const noexcept { return mNumBytesMapped; }
+
+    bool isLocked() const noexcept               { return mIsLocked; }
+    bool usesHugePages() const noexcept          { return mUsesHugePages; }
+
+    // Minor plus major page faults taken so far by the calling thread, or 0
+    // where the OS doesn't report them per thread.
+    static int64_t getThreadPageFaults() noexcept;
+
+private:
+    bool mShouldLockPages;
+
+    float* mData = nullptr;
+    size_t mNumFloats = 0;
+    size_t mNumBytesMapped = 0;
+
+    bool mIsMapped = false;
+    bool mIsLocked = false;
+    bool mUsesHugePages = false;
+
+    DSPBuffer (const DSPBuffer&) = delete;
+    DSPBuffer& operator= (const DSPBuffer&) = delete;
+};
@@ -0,0 +1,638 @@
+/*
+  ==============================================================================
+
+    DSPKernels.cpp
+
+  ==============================================================================
+*/
+
+#include "DSPKernels.h"
+
+// Every variant has to give bit-identical results to the scalar one, so the
+// compiler mustn't fuse multiplies and adds into FMAs where the CPU has them
+#if defined (__clang__)
+ #pragma clang fp contract (off)
+#elif defined (__GNUC__)
+ #pragma GCC optimize ("fp-contract=off")
+#endif
+
+#include "DSPPlatform.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace InfatuationKernels
+{
+
+//==============================================================================
+static void mixDryWetScalar (float* inOut, const float* wet, const float* noise, float wetLevel, int numSamples)
+{
+    float dryLevel = 1 - wetLevel;
+
+    for (int i = 0; i < numSamples; ++i)
+        inOut[i] = (inOut[i] * dryLevel + wet[i] * wetLevel) + noise[i];
+}
+
+static void mixDryWetSendScalar (float* inOut, float* wetOut, const float* wet, const float* noise, float wetLevel, int numSamples)
+{
+    float dryLevel = 1 - wetLevel;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        wetOut[i] = wet[i] + noise[i];
+        inOut[i] = (inOut[i] * dryLevel + wet[i] * wetLevel) + noise[i];
+    }
+}
+
+static const uint64_t randomMultiplier = 0x5deece66dULL;
+static const uint64_t randomIncrement = 11;
+static const uint64_t randomMask = 0xffffffffffffULL;
+
+static inline float toRandomFloat (uint64_t state)
+{
+    float result = (float) (uint32_t) (state >> 16) / ((float) std::numeric_limits<uint32_t>::max() + 1.0f);
+
+    return result == 1.0f ? 1.0f - std::numeric_limits<float>::epsilon() : result;
+}
+
+static void generateRandomScalar (float* out, uint64_t& state, int numSamples)
+{
+    // the same generator and float conversion as juce::Random, so renders
+    // match the ones the plugin made before the engine was split out
+    for (int i = 0; i < numSamples; ++i)
+    {
+        state = (state * randomMultiplier + randomIncrement) & randomMask;
+        out[i] = toRandomFloat (state);
+    }
+}
+
+// Puts the next numLanes steps from state in lanes, and gives the multiplier
+// and increment that move a step numLanes steps on in one go
+static void startRandomLanes (uint64_t* lanes, uint64_t state, int numLanes, uint64_t& multiplier, uint64_t& increment)
+{
+    multiplier = 1;
+    increment = 0;
+
+    for (int i = 0; i < numLanes; ++i)
+    {
+        state = (state * randomMultiplier + randomIncrement) & randomMask;
+        lanes[i] = state;
+
+        multiplier = (multiplier * randomMultiplier) & randomMask;
+        increment = (increment * randomMultiplier + randomIncrement) & randomMask;
+    }
+}
+
+static void shapeNoiseScalar (float* inOut, float scale, float offset, float level, int numSamples)
+{
+    for (int i = 0; i < numSamples; ++i)
+        inOut[i] = (inOut[i] * scale + offset) * level;
+}
+
+static inline float interpolateOne (const float* circularBuffer, int circularBufferLength, float readHead)
+{
+    int readHead_x = (int) readHead;
+    int readHead_x1 = readHead_x + 1;
+    float readHeadFloat = readHead - readHead_x;
+
+    if (readHead_x1 >= circularBufferLength)
+        readHead_x1 -= circularBufferLength;
+
+    return (1 - readHeadFloat) * circularBuffer[readHead_x] + readHeadFloat * circularBuffer[readHead_x1];
+}
+
+static void interpolateScalar (float* out, const float* circularBuffer, int circularBufferLength, const float* readHeads, int numSamples)
+{
+    for (int i = 0; i < numSamples; ++i)
+        out[i] = interpolateOne (circularBuffer, circularBufferLength, readHeads[i]);
+}
+
+#if INFATUATION_INTEL
+//==============================================================================
+INFATUATION_TARGET ("sse2")
+static void mixDryWetSSE2 (float* inOut, const float* wet, const float* noise, float wetLevel, int numSamples)
+{
+    __m128 dryLevel = _mm_set1_ps (1 - wetLevel);
+    __m128 wetLevels = _mm_set1_ps (wetLevel);
+    int i = 0;
+
+    for (; i + 4 <= numSamples; i += 4)
+    {
+        __m128 dry = _mm_mul_ps (_mm_loadu_ps (inOut + i), dryLevel);
+        __m128 mixed = _mm_add_ps (dry, _mm_mul_ps (_mm_loadu_ps (wet + i), wetLevels));
+        _mm_storeu_ps (inOut + i, _mm_add_ps (mixed, _mm_loadu_ps (noise + i)));
+    }
+
+    mixDryWetScalar (inOut + i, wet + i, noise + i, wetLevel, numSamples - i);
+}
+
+INFATUATION_TARGET ("sse2")
+static void mixDryWetSendSSE2 (float* inOut, float* wetOut, const float* wet, const float* noise, float wetLevel, int numSamples)
+{
+    __m128 dryLevel = _mm_set1_ps (1 - wetLevel);
+    __m128 wetLevels = _mm_set1_ps (wetLevel);
+    int i = 0;
+
+    for (; i + 4 <= numSamples; i += 4)
+    {
+        __m128 wetSamples = _mm_loadu_ps (wet + i);
+        __m128 noiseSamples = _mm_loadu_ps (noise + i);
+        _mm_storeu_ps (wetOut + i, _mm_add_ps (wetSamples, noiseSamples));
+
+        __m128 dry = _mm_mul_ps (_mm_loadu_ps (inOut + i), dryLevel);
+        __m128 mixed = _mm_add_ps (dry, _mm_mul_ps (wetSamples, wetLevels));
+        _mm_storeu_ps (inOut + i, _mm_add_ps (mixed, noiseSamples));
+    }
+
+    mixDryWetSendScalar (inOut + i, wetOut + i, wet + i, noise + i, wetLevel, numSamples - i);
+}
+
+// state * multiplier + increment modulo 2^48, built from 32-bit multiplies
+INFATUATION_TARGET ("sse2")
+static inline __m128i stepRandomSSE2 (__m128i state, __m128i multiplierLow, __m128i multiplierHigh, __m128i increment)
+{
+    __m128i cross = _mm_add_epi64 (_mm_mul_epu32 (_mm_srli_epi64 (state, 32), multiplierLow), _mm_mul_epu32 (state, multiplierHigh));
+    __m128i product = _mm_add_epi64 (_mm_mul_epu32 (state, multiplierLow), _mm_slli_epi64 (cross, 32));
+
+    return _mm_and_si128 (_mm_add_epi64 (product, increment), _mm_set1_epi64x ((long long) randomMask));
+}
+
+INFATUATION_TARGET ("sse2")
+static inline __m128 toRandomFloatsSSE2 (__m128i statesLow, __m128i statesHigh)
+{
+    __m128i low = _mm_shuffle_epi32 (_mm_srli_epi64 (statesLow, 16), _MM_SHUFFLE (2, 0, 2, 0));
+    __m128i high = _mm_shuffle_epi32 (_mm_srli_epi64 (statesHigh, 16), _MM_SHUFFLE (2, 0, 2, 0));
+    __m128i values = _mm_unpacklo_epi64 (low, high);
+
+    // no unsigned conversion before AVX-512; both halves convert exactly and
+    // the add rounds once, the same as converting the whole value
+    __m128 upper = _mm_mul_ps (_mm_cvtepi32_ps (_mm_srli_epi32 (values, 16)), _mm_set1_ps (65536.0f));
+    __m128 lower = _mm_cvtepi32_ps (_mm_and_si128 (values, _mm_set1_epi32 (0xffff)));
+    __m128 result = _mm_mul_ps (_mm_add_ps (upper, lower), _mm_set1_ps (1.0f / 4294967296.0f));
+
+    __m128 isOne = _mm_cmpeq_ps (result, _mm_set1_ps (1.0f));
+    return _mm_or_ps (_mm_andnot_ps (isOne, result), _mm_and_ps (isOne, _mm_set1_ps (1.0f - std::numeric_limits<float>::epsilon())));
+}
+
+INFATUATION_TARGET ("sse2")
+static void generateRandomSSE2 (float* out, uint64_t& state, int numSamples)
+{
+    if (numSamples < 4)
+    {
+        generateRandomScalar (out, state, numSamples);
+        return;
+    }
+
+    alignas (16) uint64_t lanes[4];
+    uint64_t multiplier, increment;
+    startRandomLanes (lanes, state, 4, multiplier, increment);
+
+    __m128i multiplierLow = _mm_set1_epi64x ((long long) (multiplier & 0xffffffff));
+    __m128i multiplierHigh = _mm_set1_epi64x ((long long) (multiplier >> 32));
+    __m128i increments = _mm_set1_epi64x ((long long) increment);
+    __m128i statesLow = _mm_load_si128 ((const __m128i*) lanes);
+    __m128i statesHigh = _mm_load_si128 ((const __m128i*) (lanes + 2));
+
+    _mm_storeu_ps (out, toRandomFloatsSSE2 (statesLow, statesHigh));
+    int i = 4;
+
+    for (; i + 4 <= numSamples; i += 4)
+    {
+        statesLow = stepRandomSSE2 (statesLow, multiplierLow, multiplierHigh, increments);
+        statesHigh = stepRandomSSE2 (statesHigh, multiplierLow, multiplierHigh, increments);
+        _mm_storeu_ps (out + i, toRandomFloatsSSE2 (statesLow, statesHigh));
+    }
+
+    // the last lane holds the step the last value came from
+    _mm_store_si128 ((__m128i*) (lanes + 2), statesHigh);
+    state = lanes[3];
+
+    generateRandomScalar (out + i, state, numSamples - i);
+}
+
+INFATUATION_TARGET ("sse2")
+static void shapeNoiseSSE2 (float* inOut, float scale, float offset, float level, int numSamples)
+{
+    __m128 scales = _mm_set1_ps (scale);
+    __m128 offsets = _mm_set1_ps (offset);
+    __m128 levels = _mm_set1_ps (level);
+    int i = 0;
+
+    for (; i + 4 <= numSamples; i += 4)
+    {
+        __m128 shaped = _mm_add_ps (_mm_mul_ps (_mm_loadu_ps (inOut + i), scales), offsets);
+        _mm_storeu_ps (inOut + i, _mm_mul_ps (shaped, levels));
+    }
+
+    shapeNoiseScalar (inOut + i, scale, offset, level, numSamples - i);
+}
+
+INFATUATION_TARGET ("sse2")
+static void interpolateSSE2 (float* out, const float* circularBuffer, int circularBufferLength, const float* readHeads, int numSamples)
+{
+    // no gather before AVX2, so only the index and weight maths is vectorised
+    __m128i lastIndex = _mm_set1_epi32 (circularBufferLength - 1);
+    __m128i length = _mm_set1_epi32 (circularBufferLength);
+    __m128i one = _mm_set1_epi32 (1);
+    __m128 ones = _mm_set1_ps (1.0f);
+    int i = 0;
+
+    for (; i + 4 <= numSamples; i += 4)
+    {
+        __m128 readHead = _mm_loadu_ps (readHeads + i);
+        __m128i x = _mm_cvttps_epi32 (readHead);
+        __m128 fraction = _mm_sub_ps (readHead, _mm_cvtepi32_ps (x));
+
+        __m128i x1 = _mm_add_epi32 (x, one);
+        x1 = _mm_sub_epi32 (x1, _mm_and_si128 (_mm_cmpgt_epi32 (x1, lastIndex), length));
+
+        alignas (16) int indices[4];
+        alignas (16) int nextIndices[4];
+        _mm_store_si128 ((__m128i*) indices, x);
+        _mm_store_si128 ((__m128i*) nextIndices, x1);
+
+        __m128 samples = _mm_setr_ps (circularBuffer[indices[0]], circularBuffer[indices[1]],
+                                      circularBuffer[indices[2]], circularBuffer[indices[3]]);
+        __m128 nextSamples = _mm_setr_ps (circularBuffer[nextIndices[0]], circularBuffer[nextIndices[1]],
+                                          circularBuffer[nextIndices[2]], circularBuffer[nextIndices[3]]);
+
+        __m128 result = _mm_add_ps (_mm_mul_ps (_mm_sub_ps (ones, fraction), samples), _mm_mul_ps (fraction, nextSamples));
+        _mm_storeu_ps (out + i, result);
+    }
+
+    interpolateScalar (out + i, circularBuffer, circularBufferLength, readHeads + i, numSamples - i);
+}
+
+//==============================================================================
+INFATUATION_TARGET ("avx2")
+static void mixDryWetAVX2 (float* inOut, const float* wet, const float* noise, float wetLevel, int numSamples)
+{
+    __m256 dryLevel = _mm256_set1_ps (1 - wetLevel);
+    __m256 wetLevels = _mm256_set1_ps (wetLevel);
+    int i = 0;
+
+    for (; i + 8 <= numSamples; i += 8)
+    {
+        __m256 dry = _mm256_mul_ps (_mm256_loadu_ps (inOut + i), dryLevel);
+        __m256 mixed = _mm256_add_ps (dry, _mm256_mul_ps (_mm256_loadu_ps (wet + i), wetLevels));
+        _mm256_storeu_ps (inOut + i, _mm256_add_ps (mixed, _mm256_loadu_ps (noise + i)));
+    }
+
+    mixDryWetSSE2 (inOut + i, wet + i, noise + i, wetLevel, numSamples - i);
+}
+
+INFATUATION_TARGET ("avx2")
+static void mixDryWetSendAVX2 (float* inOut, float* wetOut, const float* wet, const float* noise, float wetLevel, int numSamples)
+{
+    __m256 dryLevel = _mm256_set1_ps (1 - wetLevel);
+    __m256 wetLevels = _mm256_set1_ps (wetLevel);
+    int i = 0;
+
+    for (; i + 8 <= numSamples; i += 8)
+    {
+        __m256 wetSamples = _mm256_loadu_ps (wet + i);
+        __m256 noiseSamples = _mm256_loadu_ps (noise + i);
+        _mm256_storeu_ps (wetOut + i, _mm256_add_ps (wetSamples, noiseSamples));
+
+        __m256 dry = _mm256_mul_ps (_mm256_loadu_ps (inOut + i), dryLevel);
+        __m256 mixed = _mm256_add_ps (dry, _mm256_mul_ps (wetSamples, wetLevels));
+        _mm256_storeu_ps (inOut + i, _mm256_add_ps (mixed, noiseSamples));
+    }
+
+    mixDryWetSendSSE2 (inOut + i, wetOut + i, wet + i, noise + i, wetLevel, numSamples - i);
+}
+
+INFATUATION_TARGET ("avx2")
+static inline __m256i stepRandomAVX2 (__m256i state, __m256i multiplierLow, __m256i multiplierHigh, __m256i increment)
+{
+    __m256i cross = _mm256_add_epi64 (_mm256_mul_epu32 (_mm256_srli_epi64 (state, 32), multiplierLow), _mm256_mul_epu32 (state, multiplierHigh));
+    __m256i product = _mm256_add_epi64 (_mm256_mul_epu32 (state, multiplierLow), _mm256_slli_epi64 (cross, 32));
+
+    return _mm256_and_si256 (_mm256_add_epi64 (product, increment), _mm256_set1_epi64x ((long long) randomMask));
+}
+
+INFATUATION_TARGET ("avx2")
+static inline __m256 toRandomFloatsAVX2 (__m256i statesLow, __m256i statesHigh)
+{
+    // the low states' values go to the bottom half and the high ones' to the top
+    __m256i low = _mm256_permutevar8x32_epi32 (_mm256_srli_epi64 (statesLow, 16), _mm256_setr_epi32 (0, 2, 4, 6, 1, 3, 5, 7));
+    __m256i high = _mm256_permutevar8x32_epi32 (_mm256_srli_epi64 (statesHigh, 16), _mm256_setr_epi32 (1, 3, 5, 7, 0, 2, 4, 6));
+    __m256i values = _mm256_blend_epi32 (low, high, 0xf0);
+
+    __m256 upper = _mm256_mul_ps (_mm256_cvtepi32_ps (_mm256_srli_epi32 (values, 16)), _mm256_set1_ps (65536.0f));
+    __m256 lower = _mm256_cvtepi32_ps (_mm256_and_si256 (values, _mm256_set1_epi32 (0xffff)));
+    __m256 result = _mm256_mul_ps (_mm256_add_ps (upper, lower), _mm256_set1_ps (1.0f / 4294967296.0f));
+
+    return _mm256_blendv_ps (result, _mm256_set1_ps (1.0f - std::numeric_limits<float>::epsilon()),
+                             _mm256_cmp_ps (result, _mm256_set1_ps (1.0f), _CMP_EQ_OQ));
+}
+
+INFATUATION_TARGET ("avx2")
+static void generateRandomAVX2 (float* out, uint64_t& state, int numSamples)
+{
+    if (numSamples < 8)
+    {
+        generateRandomSSE2 (out, state, numSamples);
+        return;
+    }
+
+    alignas (32) uint64_t lanes[8];
+    uint64_t multiplier, increment;
+    startRandomLanes (lanes, state, 8, multiplier, increment);
+
+    __m256i multiplierLow = _mm256_set1_epi64x ((long long) (multiplier & 0xffffffff));
+    __m256i multiplierHigh = _mm256_set1_epi64x ((long long) (multiplier >> 32));
+    __m256i increments = _mm256_set1_epi64x ((long long) increment);
+    __m256i statesLow = _mm256_load_si256 ((const __m256i*) lanes);
+    __m256i statesHigh = _mm256_load_si256 ((const __m256i*) (lanes + 4));
+
+    _mm256_storeu_ps (out, toRandomFloatsAVX2 (statesLow, statesHigh));
+    int i = 8;
+
+    for (; i + 8 <= numSamples; i += 8)
+    {
+        statesLow = stepRandomAVX2 (statesLow, multiplierLow, multiplierHigh, increments);
+        statesHigh = stepRandomAVX2 (statesHigh, multiplierLow, multiplierHigh, increments);
+        _mm256_storeu_ps (out + i, toRandomFloatsAVX2 (statesLow, statesHigh));
+    }
+
+    _mm256_store_si256 ((__m256i*) (lanes + 4), statesHigh);
+    state = lanes[7];
+
+    generateRandomSSE2 (out + i, state, numSamples - i);
+}
+
+INFATUATION_TARGET ("avx2")
+static void shapeNoiseAVX2 (float* inOut, float scale, float offset, float level, int numSamples)
+{
+    __m256 scales = _mm256_set1_ps (scale);
+    __m256 offsets = _mm256_set1_ps (offset);
+    __m256 levels = _mm256_set1_ps (level);
+    int i = 0;
+
+    for (; i + 8 <= numSamples; i += 8)
+    {
+        __m256 shaped = _mm256_add_ps (_mm256_mul_ps (_mm256_loadu_ps (inOut + i), scales), offsets);
+        _mm256_storeu_ps (inOut + i, _mm256_mul_ps (shaped, levels));
+    }
+
+    shapeNoiseSSE2 (inOut + i, scale, offset, level, numSamples - i);
+}
+
+INFATUATION_TARGET ("avx2")
+static void interpolateAVX2 (float* out, const float* circularBuffer, int circularBufferLength, const float* readHeads, int numSamples)
+{
+    __m256i lastIndex = _mm256_set1_epi32 (circularBufferLength - 1);
+    __m256i length = _mm256_set1_epi32 (circularBufferLength);
+    __m256i one = _mm256_set1_epi32 (1);
+    __m256 ones = _mm256_set1_ps (1.0f);
+    int i = 0;
+
+    for (; i + 8 <= numSamples; i += 8)
+    {
+        __m256 readHead = _mm256_loadu_ps (readHeads + i);
+        __m256i x = _mm256_cvttps_epi32 (readHead);
+        __m256 fraction = _mm256_sub_ps (readHead, _mm256_cvtepi32_ps (x));
+
+        __m256i x1 = _mm256_add_epi32 (x, one);
+        x1 = _mm256_sub_epi32 (x1, _mm256_and_si256 (_mm256_cmpgt_epi32 (x1, lastIndex), length));
+
+        __m256 samples = _mm256_i32gather_ps (circularBuffer, x, 4);
+        __m256 nextSamples = _mm256_i32gather_ps (circularBuffer, x1, 4);
+
+        __m256 result = _mm256_add_ps (_mm256_mul_ps (_mm256_sub_ps (ones, fraction), samples), _mm256_mul_ps (fraction, nextSamples));
+        _mm256_storeu_ps (out + i, result);
+    }
+
+    interpolateSSE2 (out + i, circularBuffer, circularBufferLength, readHeads + i, numSamples - i);
+}
+
+//==============================================================================
+INFATUATION_BEGIN_AVX512
+
+INFATUATION_TARGET ("avx512f")
+static void mixDryWetAVX512 (float* inOut, const float* wet, const float* noise, float wetLevel, int numSamples)
+{
+    __m512 dryLevel = _mm512_set1_ps (1 - wetLevel);
+    __m512 wetLevels = _mm512_set1_ps (wetLevel);
+    int i = 0;
+
+    for (; i + 16 <= numSamples; i += 16)
+    {
+        __m512 dry = _mm512_mul_ps (_mm512_loadu_ps (inOut + i), dryLevel);
+        __m512 mixed = _mm512_add_ps (dry, _mm512_mul_ps (_mm512_loadu_ps (wet + i), wetLevels));
+        _mm512_storeu_ps (inOut + i, _mm512_add_ps (mixed, _mm512_loadu_ps (noise + i)));
+    }
+
+    mixDryWetAVX2 (inOut + i, wet + i, noise + i, wetLevel, numSamples - i);
+}
+
+INFATUATION_TARGET ("avx512f")
+static void mixDryWetSendAVX512 (float* inOut, float* wetOut, const float* wet, const float* noise, float wetLevel, int numSamples)
+{
+    __m512 dryLevel = _mm512_set1_ps (1 - wetLevel);
+    __m512 wetLevels = _mm512_set1_ps (wetLevel);
+    int i = 0;
+
+    for (; i + 16 <= numSamples; i += 16)
+    {
+        __m512 wetSamples = _mm512_loadu_ps (wet + i);
+        __m512 noiseSamples = _mm512_loadu_ps (noise + i);
+        _mm512_storeu_ps (wetOut + i, _mm512_add_ps (wetSamples, noiseSamples));
+
+        __m512 dry = _mm512_mul_ps (_mm512_loadu_ps (inOut + i), dryLevel);
+        __m512 mixed = _mm512_add_ps (dry, _mm512_mul_ps (wetSamples, wetLevels));
+        _mm512_storeu_ps (inOut + i, _mm512_add_ps (mixed, noiseSamples));
+    }
+
+    mixDryWetSendAVX2 (inOut + i, wetOut + i, wet + i, noise + i, wetLevel, numSamples - i);
+}
+
+INFATUATION_TARGET ("avx512f")
+static inline __m512i stepRandomAVX512 (__m512i state, __m512i multiplierLow, __m512i multiplierHigh, __m512i increment)
+{
+    __m512i cross = _mm512_add_epi64 (_mm512_mul_epu32 (_mm512_srli_epi64 (state, 32), multiplierLow), _mm512_mul_epu32 (state, multiplierHigh));
+    __m512i product = _mm512_add_epi64 (_mm512_mul_epu32 (state, multiplierLow), _mm512_slli_epi64 (cross, 32));
+
+    return _mm512_and_si512 (_mm512_add_epi64 (product, increment), _mm512_set1_epi64 ((long long) randomMask));
+}
+
+INFATUATION_TARGET ("avx512f")
+static inline __m512 toRandomFloatsAVX512 (__m512i statesLow, __m512i statesHigh)
+{
+    __m512i evens = _mm512_setr_epi32 (0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30);
+    __m512i values = _mm512_permutex2var_epi32 (_mm512_srli_epi64 (statesLow, 16), evens, _mm512_srli_epi64 (statesHigh, 16));
+
+    __m512 result = _mm512_mul_ps (_mm512_cvtepu32_ps (values), _mm512_set1_ps (1.0f / 4294967296.0f));
+
+    return _mm512_mask_mov_ps (result, _mm512_cmp_ps_mask (result, _mm512_set1_ps (1.0f), _CMP_EQ_OQ),
+                               _mm512_set1_ps (1.0f - std::numeric_limits<float>::epsilon()));
+}
+
+INFATUATION_TARGET ("avx512f")
+static void generateRandomAVX512 (float* out, uint64_t& state, int numSamples)
+{
+    if (numSamples < 16)
+    {
+        generateRandomAVX2 (out, state, numSamples);
+        return;
+    }
+
+    alignas (64) uint64_t lanes[16];
+    uint64_t multiplier, increment;
+    startRandomLanes (lanes, state, 16, multiplier, increment);
+
+    __m512i multiplierLow = _mm512_set1_epi64 ((long long) (multiplier & 0xffffffff));
+    __m512i multiplierHigh = _mm512_set1_epi64 ((long long) (multiplier >> 32));
+    __m512i increments = _mm512_set1_epi64 ((long long) increment);
+    __m512i statesLow = _mm512_load_si512 (lanes);
+    __m512i statesHigh = _mm512_load_si512 (lanes + 8);
+
+    _mm512_storeu_ps (out, toRandomFloatsAVX512 (statesLow, statesHigh));
+    int i = 16;
+
+    for (; i + 16 <= numSamples; i += 16)
+    {
+        statesLow = stepRandomAVX512 (statesLow, multiplierLow, multiplierHigh, increments);
+        statesHigh = stepRandomAVX512 (statesHigh, multiplierLow, multiplierHigh, increments);
+        _mm512_storeu_ps (out + i, toRandomFloatsAVX512 (statesLow, statesHigh));
+    }
+
+    _mm512_store_si512 (lanes + 8, statesHigh);
+    state = lanes[15];
+
+    generateRandomAVX2 (out + i, state, numSamples - i);
+}
+
+INFATUATION_TARGET ("avx512f")
+static void shapeNoiseAVX512 (float* inOut, float scale, float offset, float level, int numSamples)
+{
+    __m512 scales = _mm512_set1_ps (scale);
+    __m512 offsets = _mm512_set1_ps (offset);
+    __m512 levels = _mm512_set1_ps (level);
+    int i = 0;
+
+    for (; i + 16 <= numSamples; i += 16)
+    {
+        __m512 shaped = _mm512_add_ps (_mm512_mul_ps (_mm512_loadu_ps (inOut + i), scales), offsets);
+        _mm512_storeu_ps (inOut + i, _mm512_mul_ps (shaped, levels));
+    }
+
+    shapeNoiseAVX2 (inOut + i, scale, offset, level, numSamples - i);
+}
+
+INFATUATION_TARGET ("avx512f")
+static void interpolateAVX512 (float* out, const float* circularBuffer, int circularBufferLength, const float* readHeads, int numSamples)
+{
+    __m512i lastIndex = _mm512_set1_epi32 (circularBufferLength - 1);
+    __m512i length = _mm512_set1_epi32 (circularBufferLength);
+    __m512i one = _mm512_set1_epi32 (1);
+    __m512 ones = _mm512_set1_ps (1.0f);
+    int i = 0;
+
+    for (; i + 16 <= numSamples; i += 16)
+    {
+        __m512 readHead = _mm512_loadu_ps (readHeads + i);
+        __m512i x = _mm512_cvttps_epi32 (readHead);
+        __m512 fraction = _mm512_sub_ps (readHead, _mm512_cvtepi32_ps (x));
+
+        __m512i x1 = _mm512_add_epi32 (x, one);
+        x1 = _mm512_mask_sub_epi32 (x1, _mm512_cmpgt_epi32_mask (x1, lastIndex), x1, length);
+
+        __m512 samples = _mm512_i32gather_ps (x, circularBuffer, 4);
+        __m512 nextSamples = _mm512_i32gather_ps (x1, circularBuffer, 4);
+
+        __m512 result = _mm512_add_ps (_mm512_mul_ps (_mm512_sub_ps (ones, fraction), samples), _mm512_mul_ps (fraction, nextSamples));
+        _mm512_storeu_ps (out + i, result);
+    }
+
+    interpolateAVX2 (out + i, circularBuffer, circularBufferLength, readHeads + i, numSamples - i);
+}
+
+INFATUATION_END_AVX512
+#endif
+
+//==============================================================================
+Variant getBestVariant()
+{
+   #if INFATUATION_INTEL && defined (_MSC_VER) && ! defined (__clang__)
+    int info[4];
+    __cpuid (info, 1);
+
+    bool hasSSE2 = (info[3] & (1 << 26)) != 0;
+    bool osSavesAVX = (info[2] & (1 << 27)) != 0 && (_xgetbv (0) & 0x06) == 0x06;
+    bool osSavesAVX512 = osSavesAVX && (_xgetbv (0) & 0xe0) == 0xe0;
+
+    __cpuidex (info, 7, 0);
+
+    if (osSavesAVX512 && (info[1] & (1 << 16)) != 0)
+        return Variant::avx512;
+
+    if (osSavesAVX && (info[1] & (1 << 5)) != 0)
+        return Variant::avx2;
+
+    if (hasSSE2)
+        return Variant::sse2;
+   #elif INFATUATION_INTEL
+    // these also check that the OS saves the wider registers
+    if (__builtin_cpu_supports ("avx512f"))
+        return Variant::avx512;
+
+    if (__builtin_cpu_supports ("avx2"))
+        return Variant::avx2;
+
+    if (__builtin_cpu_supports ("sse2"))
+        return Variant::sse2;
+   #endif
+
+    return Variant::scalar;
+}
+
+const KernelTable& getKernels (Variant variant)
+{
+    static const KernelTable scalarKernels { Variant::scalar, mixDryWetScalar, mixDryWetSendScalar, generateRandomScalar, shapeNoiseScalar, interpolateScalar };
+
+   #if INFATUATION_INTEL
+    static const KernelTable sse2Kernels { Variant::sse2, mixDryWetSSE2, mixDryWetSendSSE2, generateRandomSSE2, shapeNoiseSSE2, interpolateSSE2 };
+    static const KernelTable avx2Kernels { Variant::avx2, mixDryWetAVX2, mixDryWetSendAVX2, generateRandomAVX2, shapeNoiseAVX2, interpolateAVX2 };
+    static const KernelTable avx512Kernels { Variant::avx512, mixDryWetAVX512, mixDryWetSendAVX512, generateRandomAVX512, shapeNoiseAVX512, interpolateAVX512 };
+
+    auto best = getBestVariant();
+
+    if (variant == Variant::avx512 && best == Variant::avx512)
+        return avx512Kernels;
+
+    if (variant >= Variant::avx2 && best >= Variant::avx2)
+        return avx2Kernels;
+
+    if (variant >= Variant::sse2 && best >= Variant::sse2)
+        return sse2Kernels;
+   #else
+    (void) variant;
+   #endif
+
+    return scalarKernels;
+}
+
+const char* getVariantName (Variant variant)
+{
+    switch (variant)
+    {
+        case Variant::sse2:     return "SSE2";
+        case Variant::avx2:     return "AVX2";
+        case Variant::avx512:   return "AVX-512";
+        case Variant::scalar:
+        default:                return "Scalar";
+    }
+}
+
+void writeCircular (float* circularBuffer, int circularBufferLength, int writeHead, const float* in, int numSamples)
+{
+    int firstPart = std::min (numSamples, circularBufferLength - writeHead);
+
+    std::memcpy (circularBuffer + writeHead, in, (size_t) firstPart * sizeof (float));
+    std::memcpy (circularBuffer, in + firstPart, (size_t) (numSamples - firstPart) * sizeof (float));
+}
+
+}
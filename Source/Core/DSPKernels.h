@@ -0,0 +1,64 @@
+/*
+  ==============================================================================
+
+    DSPKernels.h
+
+    The block-based inner loops of the processor, in scalar, SSE2, AVX2 and
+    AVX-512 flavours. The engine picks the best table the CPU supports
+    once in prepare() and calls through it from then on.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <cstdint>
+
+namespace InfatuationKernels
+{
+    enum class Variant
+    {
+        scalar,
+        sse2,
+        avx2,
+        avx512
+    };
+
+    struct KernelTable
+    {
+        Variant variant;
+
+        // inOut = inOut * (1 - wetLevel) + wet * wetLevel + noise
+        void (*mixDryWet) (float* inOut, const float* wet, const float* noise, float wetLevel, int numSamples);
+
+        // mixDryWet that also writes wet + noise to wetOut in the same pass,
+        // which is what mixDryWet gives at a wetLevel of 1
+        void (*mixDryWetSend) (float* inOut, float* wetOut, const float* wet, const float* noise, float wetLevel, int numSamples);
+
+        // Steps the 48-bit LCG from juce::Random numSamples times from state,
+        // writes each step's value as a float in [0, 1) and leaves state on the
+        // last step. The vector versions run one lane per consecutive step,
+        // each jumping as many steps ahead as there are lanes.
+        void (*generateRandom) (float* out, uint64_t& state, int numSamples);
+
+        // inOut = (inOut * scale + offset) * level, turns uniform random values into noise
+        void (*shapeNoise) (float* inOut, float scale, float offset, float level, int numSamples);
+
+        // out[i] = circularBuffer read at the fractional position readHeads[i]
+        // with linear interpolation. Read heads must lie in [0, circularBufferLength).
+        void (*interpolate) (float* out, const float* circularBuffer, int circularBufferLength, const float* readHeads, int numSamples);
+    };
+
+    // Fastest variant this CPU can run. Always scalar on non-Intel builds.
+    Variant getBestVariant();
+
+    // Tables for variants the CPU can't run fall back to the next one down.
+    const KernelTable& getKernels (Variant variant);
+
+    const char* getVariantName (Variant variant);
+
+    // Copies numSamples into a circular buffer starting at writeHead, wrapping
+    // at circularBufferLength. This is a straight memcpy, which the C library
+    // already dispatches on CPU features, so it isn't in the table.
+    void writeCircular (float* circularBuffer, int circularBufferLength, int writeHead, const float* in, int numSamples);
+}
@@ -0,0 +1,46 @@
+/*
+  ==============================================================================
+
+    DSPPlatform.h
+
+    Compiler and CPU macros for the files that build several instruction-set
+    variants of the same code side by side.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#if defined (__x86_64__) || defined (__i386__) || defined (_M_X64) || defined (_M_IX86)
+ #define INFATUATION_INTEL 1
+ #include <immintrin.h>
+
+ // GCC and Clang only emit instructions for the extensions a function asks
+ // for, so the wider variants can live in one file without -mavx2 etc.
+ #if defined (_MSC_VER) && ! defined (__clang__)
+  #include <intrin.h>
+  #define INFATUATION_TARGET(isa)
+ #else
+  #define INFATUATION_TARGET(isa) __attribute__ ((target (isa)))
+ #endif
+#else
+ #define INFATUATION_INTEL 0
+#endif
+
+// GCC 12's AVX-512 headers fill the unused lanes of many intrinsics from a
+// self-initialised _mm512_undefined value, which -Wmaybe-uninitialized then
+// flags wherever they're inlined. These go around the AVX-512 variants.
+#if defined (__GNUC__) && ! defined (__clang__)
+ #define INFATUATION_BEGIN_AVX512 _Pragma ("GCC diagnostic push") _Pragma ("GCC diagnostic ignored \"-Wmaybe-uninitialized\"")
+ #define INFATUATION_END_AVX512 _Pragma ("GCC diagnostic pop")
+#else
+ #define INFATUATION_BEGIN_AVX512
+ #define INFATUATION_END_AVX512
+#endif
+
+// For code shared between variants, so each copy is compiled for its caller's instruction set
+#if defined (_MSC_VER) && ! defined (__clang__)
+ #define INFATUATION_ALWAYS_INLINE __forceinline
+#else
+ #define INFATUATION_ALWAYS_INLINE inline __attribute__ ((always_inline))
+#endif
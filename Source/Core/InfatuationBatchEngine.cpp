@@ -0,0 +1,831 @@
+/*
+  ==============================================================================
+
+    InfatuationBatchEngine.cpp
+
+  ==============================================================================
+*/
+
+#include "InfatuationBatchEngine.h"
+#include "InfatuationEngine.h"
+
+// Lanes have to match InfatuationEngine bit for bit, so no FMA contraction
+// in the vectorised loops either
+#if defined (__clang__)
+ #pragma clang fp contract (off)
+#elif defined (__GNUC__)
+ #pragma GCC optimize ("fp-contract=off")
+#endif
+
+#include "DSPPlatform.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+using LaneGroup = InfatuationBatchEngine::LaneGroup;
+using BlockContext = InfatuationBatchEngine::BlockContext;
+
+//==============================================================================
+// Once per LFO_CONTROL_INTERVAL samples: the same sums as
+// InfatuationEngine::updateLFOControlRate, lane by lane. Inlined into each
+// variant rather than called, which also keeps GCC 12 from dropping the call
+// as dead at -O1 and above.
+INFATUATION_ALWAYS_INLINE static void updateControlRate(LaneGroup& group, double sampleRate)
+{
+    for (int lane = 0; lane < BATCH_LANES; lane++) {
+        const InfatuationParams& parameters = group.parameters[lane];
+        double phase = group.lfoPhase[lane];
+
+        double nextPhase = phase + LFO_CONTROL_INTERVAL * parameters.rate / sampleRate;
+        nextPhase -= std::floor(nextPhase);
+
+        float delayLeft = InfatuationEngine::getLFODelayInSamples(parameters, sampleRate, phase);
+        float delayRight = InfatuationEngine::getLFODelayInSamples(parameters, sampleRate, InfatuationEngine::getRightLFOPhase(parameters, phase));
+
+        group.controlDelayLeft[lane] = delayLeft;
+        group.controlDelayRight[lane] = delayRight;
+        group.controlStepLeft[lane] = (InfatuationEngine::getLFODelayInSamples(parameters, sampleRate, nextPhase) - delayLeft) / LFO_CONTROL_INTERVAL;
+        group.controlStepRight[lane] = (InfatuationEngine::getLFODelayInSamples(parameters, sampleRate, InfatuationEngine::getRightLFOPhase(parameters, nextPhase)) - delayRight) / LFO_CONTROL_INTERVAL;
+    }
+}
+
+// The generator and float conversion from the generateRandom kernels
+static inline float nextRandomFloat(uint64_t& state)
+{
+    state = (state * 0x5deece66dULL + 11) & 0xffffffffffffULL;
+
+    float result = (float)(uint32_t)(state >> 16) / ((float)std::numeric_limits<uint32_t>::max() + 1.0f);
+
+    return result == 1.0f ? 1.0f - std::numeric_limits<float>::epsilon() : result;
+}
+
+// InfatuationEngine::readDelayLine at Eco quality
+static inline float readDelayLine(const float* circularBuffer, int writeHead, int length, float delayTimeInSamples)
+{
+    float delayReadHead = writeHead - delayTimeInSamples;
+
+    if (delayReadHead < 0) {
+        delayReadHead += length;
+    }
+
+    int readHead_x = (int)delayReadHead;
+    int readHead_x1 = readHead_x + 1;
+    float readHeadFloat = delayReadHead - readHead_x;
+
+    if (readHead_x >= length) {
+        readHead_x -= length;
+    }
+
+    if (readHead_x1 >= length) {
+        readHead_x1 -= length;
+    }
+
+    return (1 - readHeadFloat) * circularBuffer[readHead_x] + readHeadFloat * circularBuffer[readHead_x1];
+}
+
+//==============================================================================
+// One lane at a time, the engine's per-sample loop with the lanes innermost.
+template <int effectType>
+static void processGroupScalarBody(LaneGroup& group, const BlockContext& context)
+{
+    float delayTimeLeft[BATCH_LANES];
+    float delayTimeRight[BATCH_LANES];
+
+    int counter = context.lfoControlCounter;
+    int writeHead = context.circularBufferWriteHead;
+    int length = context.circularBufferLength;
+
+    for (int i = 0; i < context.numSamples; i++) {
+        const float* inLeft = context.inLeft + i * BATCH_LANES;
+        const float* inRight = context.inRight + i * BATCH_LANES;
+        float* wetLeft = context.wetLeft + i * BATCH_LANES;
+        float* wetRight = context.wetRight + i * BATCH_LANES;
+        float* noise = context.noise + i * BATCH_LANES;
+
+        if (effectType == INFATUATION_DELAY) {
+            for (int lane = 0; lane < BATCH_LANES; lane++) {
+                group.delayTimeSmoothed[lane] = group.delayTimeSmoothed[lane] - 0.001 * (group.delayTimeSmoothed[lane] - group.delayTime[lane]);
+
+                delayTimeLeft[lane] = context.sampleRate * group.delayTimeSmoothed[lane];
+                delayTimeRight[lane] = delayTimeLeft[lane];
+            }
+        } else {
+            if (counter == 0) {
+                updateControlRate(group, context.sampleRate);
+            }
+
+            for (int lane = 0; lane < BATCH_LANES; lane++) {
+                delayTimeLeft[lane] = group.controlDelayLeft[lane] + group.controlStepLeft[lane] * counter;
+                delayTimeRight[lane] = group.controlDelayRight[lane] + group.controlStepRight[lane] * counter;
+            }
+        }
+
+        for (int lane = 0; lane < BATCH_LANES; lane++) {
+            float* circularBufferLeft = group.delayLeft + lane * length;
+            float* circularBufferRight = group.delayRight + lane * length;
+
+            // the chorus doesn't feed back
+            if (effectType == INFATUATION_CHORUS) {
+                circularBufferLeft[writeHead] = inLeft[lane];
+                circularBufferRight[writeHead] = inRight[lane];
+            } else {
+                circularBufferLeft[writeHead] = inLeft[lane] + group.feedbackLeft[lane];
+                circularBufferRight[writeHead] = inRight[lane] + group.feedbackRight[lane];
+            }
+
+            wetLeft[lane] = readDelayLine(circularBufferLeft, writeHead, length, delayTimeLeft[lane]);
+            wetRight[lane] = readDelayLine(circularBufferRight, writeHead, length, delayTimeRight[lane]);
+
+            group.feedbackLeft[lane] = wetLeft[lane] * group.feedback[lane];
+            group.feedbackRight[lane] = wetRight[lane] * group.feedback[lane];
+
+            noise[lane] = (nextRandomFloat(group.randomState[lane]) * group.noiseScale[lane] + group.noiseOffset[lane]) * group.noiseLevel[lane];
+
+            if (effectType != INFATUATION_DELAY) {
+                group.lfoPhase[lane] += group.lfoIncrement[lane];
+
+                if (group.lfoPhase[lane] > 1) {
+                    group.lfoPhase[lane] -= 1;
+                }
+            }
+        }
+
+        if (effectType != INFATUATION_DELAY) {
+            counter = (counter + 1 >= LFO_CONTROL_INTERVAL) ? 0 : counter + 1;
+        }
+
+        writeHead = (writeHead + 1 >= length) ? 0 : writeHead + 1;
+    }
+}
+
+static void processGroupScalar(LaneGroup& group, const BlockContext& context, int effectType)
+{
+    if (effectType == INFATUATION_DELAY) {
+        processGroupScalarBody<INFATUATION_DELAY>(group, context);
+    } else if (effectType == INFATUATION_CHORUS) {
+        processGroupScalarBody<INFATUATION_CHORUS>(group, context);
+    } else if (effectType == INFATUATION_FLANGER) {
+        processGroupScalarBody<INFATUATION_FLANGER>(group, context);
+    }
+}
+
+#if INFATUATION_INTEL
+//==============================================================================
+// Half the lanes per register, so every step runs twice. AVX2 can gather but
+// not scatter, so the delay line writes stay scalar.
+
+INFATUATION_TARGET ("avx2")
+static inline __m256 toFloatAVX2(__m256d low, __m256d high)
+{
+    return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm256_cvtpd_ps(low)), _mm256_cvtpd_ps(high), 1);
+}
+
+INFATUATION_TARGET ("avx2")
+static inline __m256 readDelayLinesAVX2(const float* circularBuffer, __m256i laneOffsets, int writeHead, int length, __m256 delayTimes)
+{
+    __m256 readHead = _mm256_sub_ps(_mm256_set1_ps((float)writeHead), delayTimes);
+    readHead = _mm256_blendv_ps(readHead, _mm256_add_ps(readHead, _mm256_set1_ps((float)length)), _mm256_cmp_ps(readHead, _mm256_setzero_ps(), _CMP_LT_OQ));
+
+    __m256i lastIndex = _mm256_set1_epi32(length - 1);
+    __m256i lengths = _mm256_set1_epi32(length);
+
+    __m256i x = _mm256_cvttps_epi32(readHead);
+    __m256 fraction = _mm256_sub_ps(readHead, _mm256_cvtepi32_ps(x));
+    __m256i x1 = _mm256_add_epi32(x, _mm256_set1_epi32(1));
+
+    x = _mm256_sub_epi32(x, _mm256_and_si256(_mm256_cmpgt_epi32(x, lastIndex), lengths));
+    x1 = _mm256_sub_epi32(x1, _mm256_and_si256(_mm256_cmpgt_epi32(x1, lastIndex), lengths));
+
+    __m256 samples = _mm256_i32gather_ps(circularBuffer, _mm256_add_epi32(x, laneOffsets), 4);
+    __m256 nextSamples = _mm256_i32gather_ps(circularBuffer, _mm256_add_epi32(x1, laneOffsets), 4);
+
+    return _mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(1.0f), fraction), samples), _mm256_mul_ps(fraction, nextSamples));
+}
+
+// state * 0x5deece66d + 11 modulo 2^48, built from 32-bit multiplies
+INFATUATION_TARGET ("avx2")
+static inline __m256i nextRandomStateAVX2(__m256i state)
+{
+    __m256i multiplierLow = _mm256_set1_epi64x(0xdeece66d);
+    __m256i multiplierHigh = _mm256_set1_epi64x(0x5);
+
+    __m256i cross = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(state, 32), multiplierLow), _mm256_mul_epu32(state, multiplierHigh));
+    __m256i product = _mm256_add_epi64(_mm256_mul_epu32(state, multiplierLow), _mm256_slli_epi64(cross, 32));
+
+    return _mm256_and_si256(_mm256_add_epi64(product, _mm256_set1_epi64x(11)), _mm256_set1_epi64x(0xffffffffffffLL));
+}
+
+INFATUATION_TARGET ("avx2")
+static inline __m256 randomFloatsAVX2(__m256i stateLow, __m256i stateHigh)
+{
+    __m256i evens = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+    __m128i low = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(_mm256_srli_epi64(stateLow, 16), evens));
+    __m128i high = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(_mm256_srli_epi64(stateHigh, 16), evens));
+    __m256i values = _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+
+    // no unsigned conversion before AVX-512; both halves convert exactly and
+    // the add rounds once, the same as converting the whole value
+    __m256 upper = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(values, 16)), _mm256_set1_ps(65536.0f));
+    __m256 lower = _mm256_cvtepi32_ps(_mm256_and_si256(values, _mm256_set1_epi32(0xffff)));
+    __m256 result = _mm256_mul_ps(_mm256_add_ps(upper, lower), _mm256_set1_ps(1.0f / 4294967296.0f));
+
+    __m256 ones = _mm256_set1_ps(1.0f);
+    return _mm256_blendv_ps(result, _mm256_set1_ps(1.0f - std::numeric_limits<float>::epsilon()), _mm256_cmp_ps(result, ones, _CMP_EQ_OQ));
+}
+
+template <int effectType>
+INFATUATION_TARGET ("avx2")
+static void processGroupAVX2Body(LaneGroup& group, const BlockContext& context)
+{
+    const int length = context.circularBufferLength;
+    const int halfLanes = BATCH_LANES / 2;
+
+    __m256i laneOffsets[2];
+    __m256 feedbackLeft[2], feedbackRight[2], feedback[2];
+    __m256 delayTimeSmoothed[2], delayTime[2];
+    __m256 noiseScale[2], noiseOffset[2], noiseLevel[2];
+    __m256d lfoPhase[4], lfoIncrement[4];
+    __m256i randomState[4];
+
+    for (int h = 0; h < 2; h++) {
+        laneOffsets[h] = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(length));
+        laneOffsets[h] = _mm256_add_epi32(laneOffsets[h], _mm256_set1_epi32(h * halfLanes * length));
+
+        feedbackLeft[h] = _mm256_load_ps(group.feedbackLeft + h * halfLanes);
+        feedbackRight[h] = _mm256_load_ps(group.feedbackRight + h * halfLanes);
+        feedback[h] = _mm256_load_ps(group.feedback + h * halfLanes);
+        delayTimeSmoothed[h] = _mm256_load_ps(group.delayTimeSmoothed + h * halfLanes);
+        delayTime[h] = _mm256_load_ps(group.delayTime + h * halfLanes);
+        noiseScale[h] = _mm256_load_ps(group.noiseScale + h * halfLanes);
+        noiseOffset[h] = _mm256_load_ps(group.noiseOffset + h * halfLanes);
+        noiseLevel[h] = _mm256_load_ps(group.noiseLevel + h * halfLanes);
+    }
+
+    for (int q = 0; q < 4; q++) {
+        lfoPhase[q] = _mm256_load_pd(group.lfoPhase + q * 4);
+        lfoIncrement[q] = _mm256_load_pd(group.lfoIncrement + q * 4);
+        randomState[q] = _mm256_loadu_si256((const __m256i*)(group.randomState + q * 4));
+    }
+
+    int counter = context.lfoControlCounter;
+    int writeHead = context.circularBufferWriteHead;
+
+    for (int i = 0; i < context.numSamples; i++) {
+
+        if (effectType != INFATUATION_DELAY && counter == 0) {
+            for (int q = 0; q < 4; q++) {
+                _mm256_store_pd(group.lfoPhase + q * 4, lfoPhase[q]);
+            }
+
+            updateControlRate(group, context.sampleRate);
+        }
+
+        alignas(32) float writeLeft[BATCH_LANES];
+        alignas(32) float writeRight[BATCH_LANES];
+        __m256 delayLeft[2], delayRight[2];
+
+        for (int h = 0; h < 2; h++) {
+            const int offset = i * BATCH_LANES + h * halfLanes;
+
+            __m256 inLeft = _mm256_load_ps(context.inLeft + offset);
+            __m256 inRight = _mm256_load_ps(context.inRight + offset);
+
+            if (effectType == INFATUATION_DELAY) {
+                __m256 difference = _mm256_sub_ps(delayTimeSmoothed[h], delayTime[h]);
+                __m256d low = _mm256_sub_pd(_mm256_cvtps_pd(_mm256_castps256_ps128(delayTimeSmoothed[h])), _mm256_mul_pd(_mm256_set1_pd(0.001), _mm256_cvtps_pd(_mm256_castps256_ps128(difference))));
+                __m256d high = _mm256_sub_pd(_mm256_cvtps_pd(_mm256_extractf128_ps(delayTimeSmoothed[h], 1)), _mm256_mul_pd(_mm256_set1_pd(0.001), _mm256_cvtps_pd(_mm256_extractf128_ps(difference, 1))));
+                delayTimeSmoothed[h] = toFloatAVX2(low, high);
+
+                __m256d sampleRate = _mm256_set1_pd(context.sampleRate);
+                delayLeft[h] = toFloatAVX2(_mm256_mul_pd(sampleRate, _mm256_cvtps_pd(_mm256_castps256_ps128(delayTimeSmoothed[h]))),
+                                           _mm256_mul_pd(sampleRate, _mm256_cvtps_pd(_mm256_extractf128_ps(delayTimeSmoothed[h], 1))));
+                delayRight[h] = delayLeft[h];
+            } else {
+                __m256 position = _mm256_set1_ps((float)counter);
+                delayLeft[h] = _mm256_add_ps(_mm256_load_ps(group.controlDelayLeft + h * halfLanes), _mm256_mul_ps(_mm256_load_ps(group.controlStepLeft + h * halfLanes), position));
+                delayRight[h] = _mm256_add_ps(_mm256_load_ps(group.controlDelayRight + h * halfLanes), _mm256_mul_ps(_mm256_load_ps(group.controlStepRight + h * halfLanes), position));
+            }
+
+            // the chorus doesn't feed back
+            if (effectType == INFATUATION_CHORUS) {
+                _mm256_store_ps(writeLeft + h * halfLanes, inLeft);
+                _mm256_store_ps(writeRight + h * halfLanes, inRight);
+            } else {
+                _mm256_store_ps(writeLeft + h * halfLanes, _mm256_add_ps(inLeft, feedbackLeft[h]));
+                _mm256_store_ps(writeRight + h * halfLanes, _mm256_add_ps(inRight, feedbackRight[h]));
+            }
+        }
+
+        for (int lane = 0; lane < BATCH_LANES; lane++) {
+            group.delayLeft[lane * length + writeHead] = writeLeft[lane];
+            group.delayRight[lane * length + writeHead] = writeRight[lane];
+        }
+
+        for (int h = 0; h < 2; h++) {
+            const int offset = i * BATCH_LANES + h * halfLanes;
+
+            __m256 outLeft = readDelayLinesAVX2(group.delayLeft, laneOffsets[h], writeHead, length, delayLeft[h]);
+            __m256 outRight = readDelayLinesAVX2(group.delayRight, laneOffsets[h], writeHead, length, delayRight[h]);
+
+            feedbackLeft[h] = _mm256_mul_ps(outLeft, feedback[h]);
+            feedbackRight[h] = _mm256_mul_ps(outRight, feedback[h]);
+
+            _mm256_store_ps(context.wetLeft + offset, outLeft);
+            _mm256_store_ps(context.wetRight + offset, outRight);
+
+            randomState[h * 2] = nextRandomStateAVX2(randomState[h * 2]);
+            randomState[h * 2 + 1] = nextRandomStateAVX2(randomState[h * 2 + 1]);
+
+            __m256 random = randomFloatsAVX2(randomState[h * 2], randomState[h * 2 + 1]);
+            _mm256_store_ps(context.noise + offset, _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(random, noiseScale[h]), noiseOffset[h]), noiseLevel[h]));
+        }
+
+        if (effectType != INFATUATION_DELAY) {
+            __m256d ones = _mm256_set1_pd(1.0);
+
+            for (int q = 0; q < 4; q++) {
+                lfoPhase[q] = _mm256_add_pd(lfoPhase[q], lfoIncrement[q]);
+                lfoPhase[q] = _mm256_sub_pd(lfoPhase[q], _mm256_and_pd(_mm256_cmp_pd(lfoPhase[q], ones, _CMP_GT_OQ), ones));
+            }
+
+            counter = (counter + 1 >= LFO_CONTROL_INTERVAL) ? 0 : counter + 1;
+        }
+
+        writeHead = (writeHead + 1 >= length) ? 0 : writeHead + 1;
+    }
+
+    for (int h = 0; h < 2; h++) {
+        _mm256_store_ps(group.feedbackLeft + h * halfLanes, feedbackLeft[h]);
+        _mm256_store_ps(group.feedbackRight + h * halfLanes, feedbackRight[h]);
+        _mm256_store_ps(group.delayTimeSmoothed + h * halfLanes, delayTimeSmoothed[h]);
+    }
+
+    for (int q = 0; q < 4; q++) {
+        _mm256_store_pd(group.lfoPhase + q * 4, lfoPhase[q]);
+        _mm256_storeu_si256((__m256i*)(group.randomState + q * 4), randomState[q]);
+    }
+}
+
+INFATUATION_TARGET ("avx2")
+static void processGroupAVX2(LaneGroup& group, const BlockContext& context, int effectType)
+{
+    if (effectType == INFATUATION_DELAY) {
+        processGroupAVX2Body<INFATUATION_DELAY>(group, context);
+    } else if (effectType == INFATUATION_CHORUS) {
+        processGroupAVX2Body<INFATUATION_CHORUS>(group, context);
+    } else if (effectType == INFATUATION_FLANGER) {
+        processGroupAVX2Body<INFATUATION_FLANGER>(group, context);
+    }
+}
+
+//==============================================================================
+// All the lanes in one register.
+
+INFATUATION_BEGIN_AVX512
+
+INFATUATION_TARGET ("avx512f")
+static inline __m512d lowToDoubleAVX512(__m512 x)
+{
+    return _mm512_cvtps_pd(_mm512_castps512_ps256(x));
+}
+
+INFATUATION_TARGET ("avx512f")
+static inline __m512d highToDoubleAVX512(__m512 x)
+{
+    return _mm512_cvtps_pd(_mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(x), 1)));
+}
+
+INFATUATION_TARGET ("avx512f")
+static inline __m512 toFloatAVX512(__m512d low, __m512d high)
+{
+    __m512d lowHalf = _mm512_castps_pd(_mm512_castps256_ps512(_mm512_cvtpd_ps(low)));
+    return _mm512_castpd_ps(_mm512_insertf64x4(lowHalf, _mm256_castps_pd(_mm512_cvtpd_ps(high)), 1));
+}
+
+INFATUATION_TARGET ("avx512f")
+static inline __m512 readDelayLinesAVX512(const float* circularBuffer, __m512i laneOffsets, int writeHead, int length, __m512 delayTimes)
+{
+    __m512 readHead = _mm512_sub_ps(_mm512_set1_ps((float)writeHead), delayTimes);
+    readHead = _mm512_mask_add_ps(readHead, _mm512_cmp_ps_mask(readHead, _mm512_setzero_ps(), _CMP_LT_OQ), readHead, _mm512_set1_ps((float)length));
+
+    __m512i lastIndex = _mm512_set1_epi32(length - 1);
+    __m512i lengths = _mm512_set1_epi32(length);
+
+    __m512i x = _mm512_cvttps_epi32(readHead);
+    __m512 fraction = _mm512_sub_ps(readHead, _mm512_cvtepi32_ps(x));
+    __m512i x1 = _mm512_add_epi32(x, _mm512_set1_epi32(1));
+
+    x = _mm512_mask_sub_epi32(x, _mm512_cmpgt_epi32_mask(x, lastIndex), x, lengths);
+    x1 = _mm512_mask_sub_epi32(x1, _mm512_cmpgt_epi32_mask(x1, lastIndex), x1, lengths);
+
+    __m512 samples = _mm512_i32gather_ps(_mm512_add_epi32(x, laneOffsets), circularBuffer, 4);
+    __m512 nextSamples = _mm512_i32gather_ps(_mm512_add_epi32(x1, laneOffsets), circularBuffer, 4);
+
+    return _mm512_add_ps(_mm512_mul_ps(_mm512_sub_ps(_mm512_set1_ps(1.0f), fraction), samples), _mm512_mul_ps(fraction, nextSamples));
+}
+
+INFATUATION_TARGET ("avx512f")
+static inline __m512i nextRandomStateAVX512(__m512i state)
+{
+    __m512i multiplierLow = _mm512_set1_epi64(0xdeece66d);
+    __m512i multiplierHigh = _mm512_set1_epi64(0x5);
+
+    __m512i cross = _mm512_add_epi64(_mm512_mul_epu32(_mm512_srli_epi64(state, 32), multiplierLow), _mm512_mul_epu32(state, multiplierHigh));
+    __m512i product = _mm512_add_epi64(_mm512_mul_epu32(state, multiplierLow), _mm512_slli_epi64(cross, 32));
+
+    return _mm512_and_si512(_mm512_add_epi64(product, _mm512_set1_epi64(11)), _mm512_set1_epi64(0xffffffffffffLL));
+}
+
+INFATUATION_TARGET ("avx512f")
+static inline __m512 randomFloatsAVX512(__m512i stateLow, __m512i stateHigh)
+{
+    __m256i low = _mm512_cvtepi64_epi32(_mm512_srli_epi64(stateLow, 16));
+    __m256i high = _mm512_cvtepi64_epi32(_mm512_srli_epi64(stateHigh, 16));
+    __m512i values = _mm512_inserti64x4(_mm512_castsi256_si512(low), high, 1);
+
+    __m512 result = _mm512_mul_ps(_mm512_cvtepu32_ps(values), _mm512_set1_ps(1.0f / 4294967296.0f));
+
+    return _mm512_mask_mov_ps(result, _mm512_cmp_ps_mask(result, _mm512_set1_ps(1.0f), _CMP_EQ_OQ), _mm512_set1_ps(1.0f - std::numeric_limits<float>::epsilon()));
+}
+
+template <int effectType>
+INFATUATION_TARGET ("avx512f")
+static void processGroupAVX512Body(LaneGroup& group, const BlockContext& context)
+{
+    const int length = context.circularBufferLength;
+    const __m512i laneOffsets = _mm512_mullo_epi32(_mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15), _mm512_set1_epi32(length));
+
+    __m512 feedbackLeft = _mm512_load_ps(group.feedbackLeft);
+    __m512 feedbackRight = _mm512_load_ps(group.feedbackRight);
+    __m512 feedback = _mm512_load_ps(group.feedback);
+    __m512 delayTimeSmoothed = _mm512_load_ps(group.delayTimeSmoothed);
+    __m512 delayTime = _mm512_load_ps(group.delayTime);
+    __m512 noiseScale = _mm512_load_ps(group.noiseScale);
+    __m512 noiseOffset = _mm512_load_ps(group.noiseOffset);
+    __m512 noiseLevel = _mm512_load_ps(group.noiseLevel);
+
+    __m512d lfoPhaseLow = _mm512_load_pd(group.lfoPhase);
+    __m512d lfoPhaseHigh = _mm512_load_pd(group.lfoPhase + 8);
+    __m512d lfoIncrementLow = _mm512_load_pd(group.lfoIncrement);
+    __m512d lfoIncrementHigh = _mm512_load_pd(group.lfoIncrement + 8);
+
+    __m512i randomStateLow = _mm512_loadu_si512(group.randomState);
+    __m512i randomStateHigh = _mm512_loadu_si512(group.randomState + 8);
+
+    int counter = context.lfoControlCounter;
+    int writeHead = context.circularBufferWriteHead;
+
+    for (int i = 0; i < context.numSamples; i++) {
+        const int offset = i * BATCH_LANES;
+
+        __m512 inLeft = _mm512_load_ps(context.inLeft + offset);
+        __m512 inRight = _mm512_load_ps(context.inRight + offset);
+        __m512 delayLeft;
+        __m512 delayRight;
+
+        if (effectType == INFATUATION_DELAY) {
+            __m512 difference = _mm512_sub_ps(delayTimeSmoothed, delayTime);
+            __m512d smoothing = _mm512_set1_pd(0.001);
+            __m512d low = _mm512_sub_pd(lowToDoubleAVX512(delayTimeSmoothed), _mm512_mul_pd(smoothing, lowToDoubleAVX512(difference)));
+            __m512d high = _mm512_sub_pd(highToDoubleAVX512(delayTimeSmoothed), _mm512_mul_pd(smoothing, highToDoubleAVX512(difference)));
+            delayTimeSmoothed = toFloatAVX512(low, high);
+
+            __m512d sampleRate = _mm512_set1_pd(context.sampleRate);
+            delayLeft = toFloatAVX512(_mm512_mul_pd(sampleRate, lowToDoubleAVX512(delayTimeSmoothed)), _mm512_mul_pd(sampleRate, highToDoubleAVX512(delayTimeSmoothed)));
+            delayRight = delayLeft;
+        } else {
+            if (counter == 0) {
+                _mm512_store_pd(group.lfoPhase, lfoPhaseLow);
+                _mm512_store_pd(group.lfoPhase + 8, lfoPhaseHigh);
+
+                updateControlRate(group, context.sampleRate);
+            }
+
+            __m512 position = _mm512_set1_ps((float)counter);
+            delayLeft = _mm512_add_ps(_mm512_load_ps(group.controlDelayLeft), _mm512_mul_ps(_mm512_load_ps(group.controlStepLeft), position));
+            delayRight = _mm512_add_ps(_mm512_load_ps(group.controlDelayRight), _mm512_mul_ps(_mm512_load_ps(group.controlStepRight), position));
+        }
+
+        __m512i writeIndex = _mm512_add_epi32(laneOffsets, _mm512_set1_epi32(writeHead));
+
+        // the chorus doesn't feed back
+        if (effectType == INFATUATION_CHORUS) {
+            _mm512_i32scatter_ps(group.delayLeft, writeIndex, inLeft, 4);
+            _mm512_i32scatter_ps(group.delayRight, writeIndex, inRight, 4);
+        } else {
+            _mm512_i32scatter_ps(group.delayLeft, writeIndex, _mm512_add_ps(inLeft, feedbackLeft), 4);
+            _mm512_i32scatter_ps(group.delayRight, writeIndex, _mm512_add_ps(inRight, feedbackRight), 4);
+        }
+
+        __m512 outLeft = readDelayLinesAVX512(group.delayLeft, laneOffsets, writeHead, length, delayLeft);
+        __m512 outRight = readDelayLinesAVX512(group.delayRight, laneOffsets, writeHead, length, delayRight);
+
+        feedbackLeft = _mm512_mul_ps(outLeft, feedback);
+        feedbackRight = _mm512_mul_ps(outRight, feedback);
+
+        _mm512_store_ps(context.wetLeft + offset, outLeft);
+        _mm512_store_ps(context.wetRight + offset, outRight);
+
+        randomStateLow = nextRandomStateAVX512(randomStateLow);
+        randomStateHigh = nextRandomStateAVX512(randomStateHigh);
+
+        __m512 random = randomFloatsAVX512(randomStateLow, randomStateHigh);
+        _mm512_store_ps(context.noise + offset, _mm512_mul_ps(_mm512_add_ps(_mm512_mul_ps(random, noiseScale), noiseOffset), noiseLevel));
+
+        if (effectType != INFATUATION_DELAY) {
+            __m512d ones = _mm512_set1_pd(1.0);
+
+            lfoPhaseLow = _mm512_add_pd(lfoPhaseLow, lfoIncrementLow);
+            lfoPhaseLow = _mm512_mask_sub_pd(lfoPhaseLow, _mm512_cmp_pd_mask(lfoPhaseLow, ones, _CMP_GT_OQ), lfoPhaseLow, ones);
+            lfoPhaseHigh = _mm512_add_pd(lfoPhaseHigh, lfoIncrementHigh);
+            lfoPhaseHigh = _mm512_mask_sub_pd(lfoPhaseHigh, _mm512_cmp_pd_mask(lfoPhaseHigh, ones, _CMP_GT_OQ), lfoPhaseHigh, ones);
+
+            counter = (counter + 1 >= LFO_CONTROL_INTERVAL) ? 0 : counter + 1;
+        }
+
+        writeHead = (writeHead + 1 >= length) ? 0 : writeHead + 1;
+    }
+
+    _mm512_store_ps(group.feedbackLeft, feedbackLeft);
+    _mm512_store_ps(group.feedbackRight, feedbackRight);
+    _mm512_store_ps(group.delayTimeSmoothed, delayTimeSmoothed);
+    _mm512_store_pd(group.lfoPhase, lfoPhaseLow);
+    _mm512_store_pd(group.lfoPhase + 8, lfoPhaseHigh);
+    _mm512_storeu_si512(group.randomState, randomStateLow);
+    _mm512_storeu_si512(group.randomState + 8, randomStateHigh);
+}
+
+INFATUATION_TARGET ("avx512f")
+static void processGroupAVX512(LaneGroup& group, const BlockContext& context, int effectType)
+{
+    if (effectType == INFATUATION_DELAY) {
+        processGroupAVX512Body<INFATUATION_DELAY>(group, context);
+    } else if (effectType == INFATUATION_CHORUS) {
+        processGroupAVX512Body<INFATUATION_CHORUS>(group, context);
+    } else if (effectType == INFATUATION_FLANGER) {
+        processGroupAVX512Body<INFATUATION_FLANGER>(group, context);
+    }
+}
+
+INFATUATION_END_AVX512
+#endif
+
+//==============================================================================
+InfatuationBatchEngine::InfatuationBatchEngine()
+{
+    mNumStreams = 0;
+    mEffectType = INFATUATION_DELAY;
+    mSampleRate = 44100;
+    mHasProcessed = false;
+
+    mLFOControlCounter = 0;
+    mCircularBufferWriteHead = 0;
+    mCircularBufferLength = 0;
+    mScratchLength = 0;
+
+    mVariant = InfatuationKernels::Variant::scalar;
+}
+
+InfatuationBatchEngine::~InfatuationBatchEngine()
+{
+}
+
+bool InfatuationBatchEngine::prepare(double sampleRate, int numStreams, int maxBlockSize)
+{
+    mSampleRate = sampleRate;
+    mNumStreams = std::max(0, numStreams);
+    mCircularBufferLength = sampleRate * MAX_DELAY_TIME;
+
+    int numGroups = (mNumStreams + BATCH_LANES - 1) / BATCH_LANES;
+    size_t groupFloats = 2 * (size_t)mCircularBufferLength * BATCH_LANES;
+
+    mGroups.assign((size_t)numGroups, LaneGroup());
+    mDelayMemory.allocate(groupFloats * numGroups);
+
+    mScratchLength = std::min(std::max(1, maxBlockSize), MAX_SCRATCH_LENGTH);
+    mScratchMemory.allocate(5 * (size_t)mScratchLength * BATCH_LANES);
+
+    InfatuationParams defaults;
+    infatuation_default_params(&defaults);
+
+    for (int g = 0; g < numGroups; g++) {
+        LaneGroup& group = mGroups[(size_t)g];
+
+        group.delayLeft = (mDelayMemory.getData() != nullptr) ? mDelayMemory.getData() + g * groupFloats : nullptr;
+        group.delayRight = (group.delayLeft != nullptr) ? group.delayLeft + (size_t)mCircularBufferLength * BATCH_LANES : nullptr;
+
+        for (int lane = 0; lane < BATCH_LANES; lane++) {
+            group.parameters[lane] = defaults;
+            group.randomSeed[lane] = DEFAULT_RANDOM_SEED;
+            updateGroupParameters(group, lane);
+        }
+    }
+
+    mVariant = InfatuationKernels::getKernels(InfatuationKernels::getBestVariant()).variant;
+
+    // SSE2 has no gather, so below AVX2 the lanes are run one at a time
+    if (mVariant == InfatuationKernels::Variant::sse2) {
+        mVariant = InfatuationKernels::Variant::scalar;
+    }
+
+    reset();
+
+    return (numGroups == 0 || mDelayMemory.getData() != nullptr) && mScratchMemory.getData() != nullptr;
+}
+
+void InfatuationBatchEngine::reset()
+{
+    if (mDelayMemory.getData() != nullptr) {
+        std::memset(mDelayMemory.getData(), 0, mDelayMemory.getNumFloats() * sizeof(float));
+    }
+
+    for (auto& group : mGroups) {
+        for (int lane = 0; lane < BATCH_LANES; lane++) {
+            group.feedbackLeft[lane] = 0;
+            group.feedbackRight[lane] = 0;
+            group.controlDelayLeft[lane] = 0;
+            group.controlDelayRight[lane] = 0;
+            group.controlStepLeft[lane] = 0;
+            group.controlStepRight[lane] = 0;
+            group.delayTimeSmoothed[lane] = group.delayTime[lane];
+            group.lfoPhase[lane] = 0;
+            group.randomState[lane] = (uint64_t)group.randomSeed[lane];
+        }
+    }
+
+    mLFOControlCounter = 0;
+    mCircularBufferWriteHead = 0;
+
+    mHasProcessed = false;
+}
+
+void InfatuationBatchEngine::setEffectType(int effectType)
+{
+    mEffectType = effectType;
+
+    for (auto& group : mGroups) {
+        for (int lane = 0; lane < BATCH_LANES; lane++) {
+            group.parameters[lane].effectType = effectType;
+        }
+    }
+}
+
+int InfatuationBatchEngine::getEffectType() const
+{
+    return mEffectType;
+}
+
+void InfatuationBatchEngine::setParameters(int stream, const InfatuationParams& parameters)
+{
+    if (stream < 0 || stream >= mNumStreams) {
+        return;
+    }
+
+    LaneGroup& group = mGroups[(size_t)(stream / BATCH_LANES)];
+    int lane = stream % BATCH_LANES;
+
+    group.parameters[lane] = parameters;
+    group.parameters[lane].effectType = mEffectType;
+    group.parameters[lane].quality = INFATUATION_QUALITY_ECO;
+
+    updateGroupParameters(group, lane);
+
+    if (! mHasProcessed) {
+        group.delayTimeSmoothed[lane] = group.delayTime[lane];
+    }
+}
+
+void InfatuationBatchEngine::setRandomSeed(int stream, int64_t seed)
+{
+    if (stream < 0 || stream >= mNumStreams) {
+        return;
+    }
+
+    LaneGroup& group = mGroups[(size_t)(stream / BATCH_LANES)];
+    int lane = stream % BATCH_LANES;
+
+    group.randomSeed[lane] = seed;
+    group.randomState[lane] = (uint64_t)seed;
+}
+
+void InfatuationBatchEngine::updateGroupParameters(LaneGroup& group, int lane)
+{
+    const InfatuationParams& parameters = group.parameters[lane];
+
+    group.delayTime[lane] = parameters.delayTime;
+    group.feedback[lane] = parameters.feedback;
+    group.dryWet[lane] = parameters.dryWet;
+    group.noiseLevel[lane] = parameters.noiseLevel;
+    group.lfoIncrement[lane] = parameters.rate / mSampleRate;
+
+    group.noiseScale[lane] = 0;
+    group.noiseOffset[lane] = 0;
+
+    if (parameters.noiseType == 1) {
+        group.noiseScale[lane] = 1.0f;
+    } else if (parameters.noiseType == 2) {
+        group.noiseScale[lane] = 2.0f;
+        group.noiseOffset[lane] = -1.0f;
+    } else if (parameters.noiseType == 3) {
+        group.noiseScale[lane] = 0.5f;
+        group.noiseOffset[lane] = -0.25f;
+    }
+}
+
+void InfatuationBatchEngine::process(const float* const* inLeft, const float* const* inRight, float* const* outLeft, float* const* outRight, int numSamples)
+{
+    if (mScratchMemory.getData() == nullptr || (! mGroups.empty() && mDelayMemory.getData() == nullptr)) {
+        return;
+    }
+
+    mHasProcessed = true;
+
+    void (*processGroupVariant)(LaneGroup&, const BlockContext&, int) = processGroupScalar;
+
+   #if INFATUATION_INTEL
+    if (mVariant == InfatuationKernels::Variant::avx512) {
+        processGroupVariant = processGroupAVX512;
+    } else if (mVariant == InfatuationKernels::Variant::avx2) {
+        processGroupVariant = processGroupAVX2;
+    }
+   #endif
+
+    BlockContext context;
+    context.circularBufferLength = mCircularBufferLength;
+    context.sampleRate = mSampleRate;
+    context.inLeft = mScratchMemory.getData();
+    context.inRight = context.inLeft + (size_t)mScratchLength * BATCH_LANES;
+    context.wetLeft = context.inRight + (size_t)mScratchLength * BATCH_LANES;
+    context.wetRight = context.wetLeft + (size_t)mScratchLength * BATCH_LANES;
+    context.noise = context.wetRight + (size_t)mScratchLength * BATCH_LANES;
+
+    for (int start = 0; start < numSamples; start += mScratchLength) {
+
+        int segmentLength = std::min(mScratchLength, numSamples - start);
+
+        context.numSamples = segmentLength;
+        context.lfoControlCounter = mLFOControlCounter;
+        context.circularBufferWriteHead = mCircularBufferWriteHead;
+
+        for (size_t g = 0; g < mGroups.size(); g++) {
+            LaneGroup& group = mGroups[g];
+            int firstStream = (int)g * BATCH_LANES;
+            int numLanes = std::min(BATCH_LANES, mNumStreams - firstStream);
+
+            // streams in, one lane each; unused lanes run on silence
+            if (numLanes < BATCH_LANES) {
+                std::memset(context.inLeft, 0, (size_t)segmentLength * BATCH_LANES * sizeof(float));
+                std::memset(context.inRight, 0, (size_t)segmentLength * BATCH_LANES * sizeof(float));
+            }
+
+            for (int lane = 0; lane < numLanes; lane++) {
+                const float* left = inLeft[firstStream + lane] + start;
+                const float* right = (inRight[firstStream + lane] != nullptr) ? inRight[firstStream + lane] + start : left;
+
+                for (int i = 0; i < segmentLength; i++) {
+                    context.inLeft[i * BATCH_LANES + lane] = left[i];
+                    context.inRight[i * BATCH_LANES + lane] = right[i];
+                }
+            }
+
+            processGroupVariant(group, context, mEffectType);
+
+            // the dry/wet mix, as InfatuationKernels::mixDryWet does it
+            for (int lane = 0; lane < numLanes; lane++) {
+                float* left = outLeft[firstStream + lane] + start;
+                float* right = (outRight[firstStream + lane] != nullptr) ? outRight[firstStream + lane] + start : nullptr;
+
+                float wetLevel = group.dryWet[lane];
+                float dryLevel = 1 - wetLevel;
+
+                for (int i = 0; i < segmentLength; i++) {
+                    float noise = context.noise[i * BATCH_LANES + lane];
+
+                    left[i] = (context.inLeft[i * BATCH_LANES + lane] * dryLevel + context.wetLeft[i * BATCH_LANES + lane] * wetLevel) + noise;
+
+                    if (right != nullptr) {
+                        right[i] = (context.inRight[i * BATCH_LANES + lane] * dryLevel + context.wetRight[i * BATCH_LANES + lane] * wetLevel) + noise;
+                    }
+                }
+            }
+        }
+
+        if (mEffectType != INFATUATION_DELAY) {
+            mLFOControlCounter = (mLFOControlCounter + segmentLength) % LFO_CONTROL_INTERVAL;
+        }
+
+        mCircularBufferWriteHead = (mCircularBufferWriteHead + segmentLength) % mCircularBufferLength;
+    }
+}
+
+int InfatuationBatchEngine::getNumStreams() const
+{
+    return mNumStreams;
+}
+
+InfatuationKernels::Variant InfatuationBatchEngine::getKernelVariant() const
+{
+    return mVariant;
+}
@@ -0,0 +1,133 @@
+/*
+  ==============================================================================
+
+    InfatuationBatchEngine.h
+
+    Runs many independent streams of the same effect type in lockstep, one
+    stream per SIMD lane. State is kept in structure-of-arrays form, so each
+    step of the per-sample loop (including the flanger's feedback path,
+    which can't be vectorised along time) works on BATCH_LANES streams at
+    once. Each stream has its own parameters and noise seed.
+
+    The LFO always runs at control rate, as Eco quality does per instance,
+    so every stream's output is bit-identical to an InfatuationEngine at
+    Eco quality with the same parameters and seed. The quality parameter
+    is ignored.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "DSPBuffer.h"
+#include "DSPKernels.h"
+#include "InfatuationCore.h"
+
+#define BATCH_LANES 16
+
+//==============================================================================
+/**
+*/
+class InfatuationBatchEngine
+{
+public:
+    InfatuationBatchEngine();
+    ~InfatuationBatchEngine();
+
+    // Allocates state for numStreams streams and resets everything. Not for
+    // the audio thread. Returns false if the memory couldn't be allocated.
+    bool prepare(double sampleRate, int numStreams, int maxBlockSize);
+
+    // Clears the delay lines and restarts every stream's LFO and noise generator.
+    void reset();
+
+    // Shared by all streams.
+    void setEffectType(int effectType);
+    int getEffectType() const;
+
+    // effectType and quality in parameters are ignored. As with the engine,
+    // the delay time is taken as it is before the first block after a reset.
+    void setParameters(int stream, const InfatuationParams& parameters);
+    void setRandomSeed(int stream, int64_t seed);
+
+    // One pointer per stream in each array. A null inRight reads inLeft for
+    // that stream, a null outRight drops the right channel, so mono streams
+    // can share a batch with stereo ones. Outputs may alias the inputs.
+    void process(const float* const* inLeft, const float* const* inRight, float* const* outLeft, float* const* outRight, int numSamples);
+
+    int getNumStreams() const;
+    InfatuationKernels::Variant getKernelVariant() const;
+
+    // Per-lane state for BATCH_LANES streams. Public so the SIMD kernels in
+    // the .cpp can see it, not for use outside the engine.
+    struct LaneGroup
+    {
+        alignas(64) float feedbackLeft[BATCH_LANES];
+        alignas(64) float feedbackRight[BATCH_LANES];
+        alignas(64) float controlDelayLeft[BATCH_LANES];
+        alignas(64) float controlDelayRight[BATCH_LANES];
+        alignas(64) float controlStepLeft[BATCH_LANES];
+        alignas(64) float controlStepRight[BATCH_LANES];
+        alignas(64) float delayTimeSmoothed[BATCH_LANES];
+
+        alignas(64) float delayTime[BATCH_LANES];
+        alignas(64) float feedback[BATCH_LANES];
+        alignas(64) float dryWet[BATCH_LANES];
+        alignas(64) float noiseScale[BATCH_LANES];
+        alignas(64) float noiseOffset[BATCH_LANES];
+        alignas(64) float noiseLevel[BATCH_LANES];
+
+        alignas(64) double lfoPhase[BATCH_LANES];
+        alignas(64) double lfoIncrement[BATCH_LANES];
+
+        uint64_t randomState[BATCH_LANES];
+        int64_t randomSeed[BATCH_LANES];
+        InfatuationParams parameters[BATCH_LANES];
+
+        // [lane * circularBufferLength + position], so each lane reads its
+        // own delay line front to back, as a single engine does
+        float* delayLeft;
+        float* delayRight;
+    };
+
+    // Everything one pass over a group needs besides the group itself.
+    struct BlockContext
+    {
+        int numSamples;
+        int lfoControlCounter;
+        int circularBufferWriteHead;
+        int circularBufferLength;
+        double sampleRate;
+
+        // [sample * BATCH_LANES + lane]
+        float* inLeft;
+        float* inRight;
+        float* wetLeft;
+        float* wetRight;
+        float* noise;
+    };
+
+private:
+    void updateGroupParameters(LaneGroup& group, int lane);
+
+    std::vector<LaneGroup> mGroups;
+    int mNumStreams;
+    int mEffectType;
+    double mSampleRate;
+    bool mHasProcessed;
+
+    int mLFOControlCounter;
+    int mCircularBufferWriteHead;
+    int mCircularBufferLength;
+    DSPBuffer mDelayMemory;
+
+    DSPBuffer mScratchMemory;
+    int mScratchLength;
+
+    InfatuationKernels::Variant mVariant;
+
+    InfatuationBatchEngine(const InfatuationBatchEngine&) = delete;
+    InfatuationBatchEngine& operator=(const InfatuationBatchEngine&) = delete;
+};
@@ -0,0 +1,198 @@
+/*
+  ==============================================================================
+
+    InfatuationCore.cpp
+
+  ==============================================================================
+*/
+
+#include "InfatuationCore.h"
+#include "InfatuationEngine.h"
+#include "InfatuationBatchEngine.h"
+
+#include <cstring>
+#include <new>
+
+//==============================================================================
+void infatuation_default_params(InfatuationParams* params)
+{
+    if (params == nullptr) {
+        return;
+    }
+
+    params->effectType = INFATUATION_DELAY;
+    params->waveType = INFATUATION_WAVE_SINE;
+    params->noiseType = 1;
+    params->quality = INFATUATION_QUALITY_STANDARD;
+
+    params->dryWet = 0.5f;
+    params->depth = 0.5f;
+    params->rate = 0.5f;
+    params->phaseOffset = 0.5f;
+    params->feedback = 0.5f;
+    params->delayTime = 1.0f;
+    params->noiseLevel = 0;
+}
+
+InfatuationHandle infatuation_create(double sampleRate, int maxBlockSize)
+{
+    InfatuationEngine* engine = new (std::nothrow) InfatuationEngine();
+
+    if (engine == nullptr) {
+        return nullptr;
+    }
+
+    if (! engine->prepare(sampleRate, maxBlockSize)) {
+        delete engine;
+        return nullptr;
+    }
+
+    return engine;
+}
+
+void infatuation_set_params(InfatuationHandle handle, const InfatuationParams* params)
+{
+    if (handle != nullptr && params != nullptr) {
+        handle->setParameters(*params);
+    }
+}
+
+void infatuation_set_smoothing(InfatuationHandle handle, int shape, double seconds)
+{
+    if (handle != nullptr) {
+        handle->setSmoothing(shape, seconds);
+    }
+}
+
+void infatuation_set_random_seed(InfatuationHandle handle, long long seed)
+{
+    if (handle != nullptr) {
+        handle->setRandomSeed(seed);
+    }
+}
+
+void infatuation_reset(InfatuationHandle handle)
+{
+    if (handle != nullptr) {
+        handle->reset();
+    }
+}
+
+void infatuation_process(InfatuationHandle handle, const float* const* in, float* const* out, int numSamples)
+{
+    infatuation_process_wet(handle, in, out, nullptr, numSamples);
+}
+
+void infatuation_process_wet(InfatuationHandle handle, const float* const* in, float* const* out, float* const* wetOut, int numSamples)
+{
+    if (handle == nullptr || in == nullptr || out == nullptr || numSamples <= 0) {
+        return;
+    }
+
+    // the engine mixes into the outputs, so they have to start out as the dry signal
+    for (int channel = 0; channel < 2; channel++) {
+        if (out[channel] != in[channel]) {
+            std::memmove(out[channel], in[channel], (size_t)numSamples * sizeof(float));
+        }
+    }
+
+    if (wetOut != nullptr) {
+        handle->process(in[0], in[1], out[0], out[1], numSamples, wetOut[0], wetOut[1]);
+    } else {
+        handle->process(in[0], in[1], out[0], out[1], numSamples);
+    }
+}
+
+int infatuation_save_checkpoint(InfatuationHandle handle, const char* path, long long samplePosition)
+{
+    if (handle == nullptr || path == nullptr) {
+        return 0;
+    }
+
+    return handle->saveCheckpoint(path, samplePosition) ? 1 : 0;
+}
+
+int infatuation_load_checkpoint(InfatuationHandle handle, const char* path, long long* samplePosition)
+{
+    if (handle == nullptr || path == nullptr) {
+        return 0;
+    }
+
+    int64_t position = 0;
+
+    if (! handle->loadCheckpoint(path, &position)) {
+        return 0;
+    }
+
+    if (samplePosition != nullptr) {
+        *samplePosition = position;
+    }
+
+    return 1;
+}
+
+void infatuation_destroy(InfatuationHandle handle)
+{
+    delete handle;
+}
+
+//==============================================================================
+InfatuationBatchHandle infatuation_batch_create(double sampleRate, int numStreams, int maxBlockSize)
+{
+    InfatuationBatchEngine* batch = new (std::nothrow) InfatuationBatchEngine();
+
+    if (batch == nullptr) {
+        return nullptr;
+    }
+
+    if (! batch->prepare(sampleRate, numStreams, maxBlockSize)) {
+        delete batch;
+        return nullptr;
+    }
+
+    return batch;
+}
+
+void infatuation_batch_set_effect_type(InfatuationBatchHandle handle, int effectType)
+{
+    if (handle != nullptr) {
+        handle->setEffectType(effectType);
+    }
+}
+
+void infatuation_batch_set_params(InfatuationBatchHandle handle, int stream, const InfatuationParams* params)
+{
+    if (handle != nullptr && params != nullptr) {
+        handle->setParameters(stream, *params);
+    }
+}
+
+void infatuation_batch_set_random_seed(InfatuationBatchHandle handle, int stream, long long seed)
+{
+    if (handle != nullptr) {
+        handle->setRandomSeed(stream, seed);
+    }
+}
+
+void infatuation_batch_reset(InfatuationBatchHandle handle)
+{
+    if (handle != nullptr) {
+        handle->reset();
+    }
+}
+
+void infatuation_batch_process(InfatuationBatchHandle handle,
+                               const float* const* inLeft, const float* const* inRight,
+                               float* const* outLeft, float* const* outRight, int numSamples)
+{
+    if (handle == nullptr || inLeft == nullptr || inRight == nullptr || outLeft == nullptr || outRight == nullptr || numSamples <= 0) {
+        return;
+    }
+
+    handle->process(inLeft, inRight, outLeft, outRight, numSamples);
+}
+
+void infatuation_batch_destroy(InfatuationBatchHandle handle)
+{
+    delete handle;
+}
@@ -0,0 +1,141 @@
+/*
+  ==============================================================================
+
+    InfatuationCore.h
+
+    C interface to the Infatuation DSP engine, for hosts that don't want to
+    link JUCE. The core is every file in Source/Core and only needs a C++17
+    compiler and the C library; the README shows how to build it as a static
+    or shared library.
+
+    A handle is used from one thread at a time. infatuation_process() doesn't
+    allocate, lock or make system calls, so it's safe on an audio thread.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct InfatuationEngine* InfatuationHandle;
+typedef struct InfatuationBatchEngine* InfatuationBatchHandle;
+
+enum
+{
+    INFATUATION_DELAY = 1,
+    INFATUATION_CHORUS = 2,
+    INFATUATION_FLANGER = 3
+};
+
+enum
+{
+    INFATUATION_WAVE_SINE = 1,
+    INFATUATION_WAVE_SAW = 2,
+    INFATUATION_WAVE_TRIANGLE = 3
+};
+
+enum
+{
+    INFATUATION_QUALITY_ECO = 1,
+    INFATUATION_QUALITY_STANDARD = 2,
+    INFATUATION_QUALITY_HIGH = 3
+};
+
+enum
+{
+    INFATUATION_SMOOTHING_NONE = 0,
+    INFATUATION_SMOOTHING_LINEAR = 1,
+    INFATUATION_SMOOTHING_EXPONENTIAL = 2
+};
+
+typedef struct InfatuationParams
+{
+    int effectType;         /* INFATUATION_DELAY, _CHORUS or _FLANGER */
+    int waveType;           /* LFO shape, INFATUATION_WAVE_* */
+    int noiseType;          /* 1 to 3 */
+    int quality;            /* INFATUATION_QUALITY_*, changes are crossfaded */
+
+    float dryWet;           /* 0 to 1 */
+    float depth;            /* LFO depth, 0 to 1 */
+    float rate;             /* LFO rate in Hz, 0 to 1 */
+    float phaseOffset;      /* flanger right-channel LFO offset in cycles, 0 to 1 */
+    float feedback;         /* 0 to 0.98 */
+    float delayTime;        /* delay mode only, in seconds, 0.01 to 2 */
+    float noiseLevel;       /* 0 to 1 */
+} InfatuationParams;
+
+/* The plugin's default settings. */
+void infatuation_default_params (InfatuationParams* params);
+
+/* Returns NULL if the delay memory couldn't be allocated. maxBlockSize is
+   only a hint, process() accepts blocks of any length. */
+InfatuationHandle infatuation_create (double sampleRate, int maxBlockSize);
+
+void infatuation_set_params (InfatuationHandle handle, const InfatuationParams* params);
+
+/* Later changes of dryWet, depth, rate, phaseOffset, feedback and noiseLevel
+   glide over seconds instead of jumping, at any sample rate. shape is an
+   INFATUATION_SMOOTHING_* value; exponential glides get within 1% of the
+   new value in that time. Off by default. */
+void infatuation_set_smoothing (InfatuationHandle handle, int shape, double seconds);
+
+/* The noise generator restarts from this seed on infatuation_reset(), so two
+   runs over the same input give the same output. */
+void infatuation_set_random_seed (InfatuationHandle handle, long long seed);
+
+/* Clears the delay lines and restarts the LFO and noise generator. */
+void infatuation_reset (InfatuationHandle handle);
+
+/* Processes numSamples of stereo audio. in and out each point to two
+   channels; out may be the same buffers as in. */
+void infatuation_process (InfatuationHandle handle, const float* const* in, float* const* out, int numSamples);
+
+/* As infatuation_process(), and also writes the wet signal alone (with the
+   noise, as out would hold at a dryWet of 1) to the two channels of wetOut,
+   for parallel routing. wetOut mustn't overlap in or out; NULL skips it. */
+void infatuation_process_wet (InfatuationHandle handle, const float* const* in, float* const* out,
+                              float* const* wetOut, int numSamples);
+
+/* Saves the engine's complete state, delay lines included, to a
+   memory-mapped file at path along with samplePosition, so a long render can
+   be stopped and resumed later or on another machine. Call it between
+   blocks. An earlier checkpoint at path is only replaced once the new one is
+   safely on disk. Returns 0 on failure. */
+int infatuation_save_checkpoint (InfatuationHandle handle, const char* path, long long samplePosition);
+
+/* Restores a checkpoint into a handle created at the same sample rate, and
+   sets samplePosition (if not NULL) to where it was taken. Processing then
+   carries on sample for sample as the saved engine would have, whatever SIMD
+   support the CPU has. Returns 0 and leaves the handle untouched if the
+   file can't be used. */
+int infatuation_load_checkpoint (InfatuationHandle handle, const char* path, long long* samplePosition);
+
+void infatuation_destroy (InfatuationHandle handle);
+
+/* A batch runs numStreams independent streams of one effect type in
+   lockstep, one per SIMD lane, for hosts rendering many instances at once.
+   Each stream has its own parameters and seed and matches an engine at Eco
+   quality sample for sample; the quality and effectType fields are ignored.
+   Returns NULL if the memory couldn't be allocated. */
+InfatuationBatchHandle infatuation_batch_create (double sampleRate, int numStreams, int maxBlockSize);
+
+void infatuation_batch_set_effect_type (InfatuationBatchHandle handle, int effectType);
+void infatuation_batch_set_params (InfatuationBatchHandle handle, int stream, const InfatuationParams* params);
+void infatuation_batch_set_random_seed (InfatuationBatchHandle handle, int stream, long long seed);
+void infatuation_batch_reset (InfatuationBatchHandle handle);
+
+/* Each array holds one channel pointer per stream. A NULL right input reads
+   the left one, a NULL right output is skipped. Outputs may be the same
+   buffers as the inputs. */
+void infatuation_batch_process (InfatuationBatchHandle handle,
+                                const float* const* inLeft, const float* const* inRight,
+                                float* const* outLeft, float* const* outRight, int numSamples);
+
+void infatuation_batch_destroy (InfatuationBatchHandle handle);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,1204 @@
+/*
+  ==============================================================================
+
+    InfatuationEngine.cpp
+
+  ==============================================================================
+*/
+
+#include "InfatuationEngine.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#ifndef M_PI
+ #define M_PI 3.14159265358979323846
+#endif
+
+// same as juce::jmap, which the plugin used before the engine was split out
+static float mapRange(float value, float sourceMin, float sourceMax, float targetMin, float targetMax)
+{
+    return targetMin + (targetMax - targetMin) * (value - sourceMin) / (sourceMax - sourceMin);
+}
+
+// each input sample plus the feedback from the wet sample before it, the
+// first one carrying the feedback over from the sample before the block
+static void getFeedbackInput(float* out, const float* in, const float* wet, float firstFeedback, float feedback, const float* feedbackGains, int length)
+{
+    out[0] = in[0] + firstFeedback;
+
+    if (feedbackGains != nullptr) {
+        for (int i = 1; i < length; i++) {
+            out[i] = in[i] + wet[i - 1] * feedbackGains[i - 1];
+        }
+    } else {
+        for (int i = 1; i < length; i++) {
+            out[i] = in[i] + wet[i - 1] * feedback;
+        }
+    }
+}
+
+// What a checkpoint file starts with. The state and then the two delay lines
+// follow, each starting on a CHECKPOINT_ALIGNMENT boundary.
+struct CheckpointHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t stateSize;
+    double sampleRate;
+    int64_t samplePosition;
+    int64_t circularBufferLength;
+    int32_t reserved[2];
+};
+
+static const char checkpointMagic[8] = { 'I', 'N', 'F', 'C', 'K', 'P', 'T', 0 };
+
+#define CHECKPOINT_ALIGNMENT 64
+
+static size_t alignCheckpointOffset(size_t offset)
+{
+    return (offset + CHECKPOINT_ALIGNMENT - 1) / CHECKPOINT_ALIGNMENT * CHECKPOINT_ALIGNMENT;
+}
+
+//==============================================================================
+InfatuationEngine::InfatuationEngine()
+{
+    infatuation_default_params(&mParameters);
+
+    mSampleRate = 44100;
+    mHasProcessed = false;
+    mIsDelayLineClear = true;
+
+    mDelayTimeSmoothed = 0;
+    mCircularBufferLeft = nullptr;
+    mCircularBufferRight = nullptr;
+    mCircularBufferWriteHead = 0;
+    mCircularBufferLength = 0;
+    mDelayTimeInSamples = 0;
+
+    mFeedbackLeft = 0;
+    mFeedbackRight = 0;
+
+    mLFOPhase = 0;
+
+    mLFOControlCounter = 0;
+    mLFOControlDelayLeft = 0;
+    mLFOControlDelayRight = 0;
+    mLFOControlStepLeft = 0;
+    mLFOControlStepRight = 0;
+
+    mQuality = INFATUATION_QUALITY_STANDARD;
+    mPreviousQuality = INFATUATION_QUALITY_STANDARD;
+    mQualityCrossfadeLength = 1;
+    mQualityCrossfadeRemaining = 0;
+
+    for (int p = 0; p < numRampedParameters; p++) {
+        mRamps[p] = ParameterRamp { false, false, 0, 0, 0, 0, 0 };
+        mRampValues[p] = nullptr;
+    }
+
+    mIsRamping = false;
+
+    mSmoothingShape = INFATUATION_SMOOTHING_NONE;
+    mSmoothingTime = 0;
+    mSmoothingLength = 0;
+    mSmoothingCoefficient = 0;
+
+    mKernels = &InfatuationKernels::getKernels(InfatuationKernels::Variant::scalar);
+    mScratchLength = 0;
+
+    mRandomSeed = DEFAULT_RANDOM_SEED;
+    mRandomState = (uint64_t)mRandomSeed;
+}
+
+InfatuationEngine::~InfatuationEngine()
+{
+    mCircularBufferLeft = nullptr;
+    mCircularBufferRight = nullptr;
+}
+
+bool InfatuationEngine::prepare(double sampleRate, int maxBlockSize)
+{
+    mSampleRate = sampleRate;
+
+    int circularBufferLength = sampleRate * MAX_DELAY_TIME;
+
+    // Hosts often prepare again with the same settings while a session
+    // loads, so the memory is only replaced when its size changes
+    if (mCircularBufferLeft == nullptr || circularBufferLength != mCircularBufferLength) {
+        mCircularBufferLength = circularBufferLength;
+
+        // Both channels share one allocation, which comes back zeroed with every
+        // page already faulted in (and locked, if the OS lets us)
+        mDelayMemory.allocate(2 * (size_t)mCircularBufferLength);
+
+        mCircularBufferLeft = mDelayMemory.getData();
+        mCircularBufferRight = (mCircularBufferLeft != nullptr) ? mCircularBufferLeft + mCircularBufferLength : nullptr;
+        mIsDelayLineClear = true;
+    }
+
+    mKernels = &InfatuationKernels::getKernels(InfatuationKernels::getBestVariant());
+
+    int scratchLength = std::min(std::max(1, maxBlockSize), MAX_SCRATCH_LENGTH);
+
+    if (mScratchMemory.getData() == nullptr || scratchLength != mScratchLength) {
+        mScratchLength = scratchLength;
+        mScratchMemory.allocate(numScratchChannels * (size_t)mScratchLength);
+    }
+
+    updateSmoothing();
+    reset();
+
+    return mCircularBufferLeft != nullptr && mScratchMemory.getData() != nullptr;
+}
+
+void InfatuationEngine::reset()
+{
+    // nothing has been written since the last clear, so it's still zero
+    if (mCircularBufferLeft != nullptr && ! mIsDelayLineClear) {
+        std::memset(mCircularBufferLeft, 0, 2 * (size_t)mCircularBufferLength * sizeof(float));
+        mIsDelayLineClear = true;
+    }
+
+    // ramps still running finish at once
+    for (int p = 0; p < numRampedParameters; p++) {
+        if (mRamps[p].isActive) {
+            mParameters.*getRampedField(p) = mRamps[p].target;
+            mRamps[p].isActive = false;
+        }
+    }
+
+    mLFOPhase = 0;
+
+    mDelayTimeInSamples = mSampleRate * mParameters.delayTime;
+    mDelayTimeSmoothed = mParameters.delayTime;
+    mCircularBufferWriteHead = 0;
+
+    mFeedbackLeft = 0;
+    mFeedbackRight = 0;
+
+    mRandomState = (uint64_t)mRandomSeed;
+
+    mLFOControlCounter = 0;
+
+    mQuality = mParameters.quality;
+    mPreviousQuality = mQuality;
+    mQualityCrossfadeRemaining = 0;
+
+    mHasProcessed = false;
+}
+
+void InfatuationEngine::setParameters(const InfatuationParams& newParameters, int rampLength)
+{
+    InfatuationParams previous = mParameters;
+    mParameters = newParameters;
+
+    // nothing to glide from before the first block
+    bool isSmoothing = mHasProcessed && mSmoothingShape != INFATUATION_SMOOTHING_NONE && mSmoothingLength > 0;
+
+    for (int p = 0; p < numRampedParameters; p++) {
+        float InfatuationParams::* field = getRampedField(p);
+        ParameterRamp& ramp = mRamps[p];
+        float current = previous.*field;
+        float target = newParameters.*field;
+
+        if (rampLength > 0 && target != current) {
+            startRamp(p, current, target, rampLength);
+        } else if (rampLength == 0 && ramp.isActive && target == ramp.target) {
+            mParameters.*field = current;
+        } else if (rampLength == 0 && isSmoothing && p != delayTimeRamp && target != current) {
+            if (mSmoothingShape == INFATUATION_SMOOTHING_EXPONENTIAL) {
+                startExponentialRamp(p, current, target);
+            } else {
+                startRamp(p, current, target, mSmoothingLength);
+            }
+        } else {
+            ramp.isActive = false;
+        }
+    }
+
+    if (! mHasProcessed) {
+        mDelayTimeInSamples = mSampleRate * mParameters.delayTime;
+        mDelayTimeSmoothed = mParameters.delayTime;
+        mQuality = mParameters.quality;
+        mPreviousQuality = mQuality;
+    } else if (mParameters.quality != mQuality) {
+        setQuality(mParameters.quality);
+    }
+}
+
+const InfatuationParams& InfatuationEngine::getParameters() const
+{
+    return mParameters;
+}
+
+void InfatuationEngine::setSmoothing(int shape, double time)
+{
+    mSmoothingShape = shape;
+    mSmoothingTime = std::max(0.0, time);
+
+    updateSmoothing();
+}
+
+void InfatuationEngine::setMemoryLocking(bool shouldLock)
+{
+    mDelayMemory.setShouldLockPages(shouldLock);
+    mScratchMemory.setShouldLockPages(shouldLock);
+}
+
+void InfatuationEngine::process(const float* inLeft, const float* inRight, float* outLeft, float* outRight, int numSamples,
+                                float* wetOutLeft, float* wetOutRight)
+{
+    if (mCircularBufferLeft == nullptr || mScratchMemory.getData() == nullptr) {
+        return;
+    }
+
+    mHasProcessed = true;
+    mIsDelayLineClear = false;
+
+    float noiseScale = 0;
+    float noiseOffset = 0;
+
+    if (mParameters.noiseType == 1) {
+        noiseScale = 1.0f;
+    } else if (mParameters.noiseType == 2) {
+        noiseScale = 2.0f;
+        noiseOffset = -1.0f;
+    } else if (mParameters.noiseType == 3) {
+        noiseScale = 0.5f;
+        noiseOffset = -0.25f;
+    }
+
+    float* wetLeft = getScratch(wetLeftScratch);
+    float* wetRight = getScratch(wetRightScratch);
+    float* noise = getScratch(noiseScratch);
+
+    // the scratch buffer holds one prepared block, anything bigger the host
+    // sends us is done in pieces
+
+    for (int start = 0; start < numSamples; start += mScratchLength) {
+
+        int segmentLength = std::min(mScratchLength, numSamples - start);
+
+        fillRamps(segmentLength);
+
+        // the delay doesn't crossfade between qualities, so it never waits for one to finish
+        bool isCrossfading = mQualityCrossfadeRemaining > 0 && mParameters.effectType != INFATUATION_DELAY;
+
+        if (mParameters.effectType == INFATUATION_CHORUS && mQuality != INFATUATION_QUALITY_HIGH && ! isCrossfading) {
+            processChorusBlock(inLeft + start, inRight + start, wetLeft, wetRight, segmentLength);
+        } else if (mParameters.effectType != INFATUATION_CHORUS && mQuality != INFATUATION_QUALITY_HIGH && ! isCrossfading) {
+            processFeedbackBlock(inLeft + start, inRight + start, wetLeft, wetRight, segmentLength);
+        } else {
+            processSamples(inLeft + start, inRight + start, wetLeft, wetRight, segmentLength);
+        }
+
+        // one random value per sample, whatever the noise type, so the
+        // output doesn't depend on how the host splits the audio into blocks
+        mKernels->generateRandom(noise, mRandomState, segmentLength);
+
+        const float* noiseLevels = mRampValues[noiseLevelRamp];
+
+        if (noiseLevels != nullptr) {
+            mKernels->shapeNoise(noise, noiseScale, noiseOffset, 1.0f, segmentLength);
+
+            for (int i = 0; i < segmentLength; i++) {
+                noise[i] *= noiseLevels[i];
+            }
+        } else {
+            mKernels->shapeNoise(noise, noiseScale, noiseOffset, mParameters.noiseLevel, segmentLength);
+        }
+
+        mixSegment(outLeft + start, (wetOutLeft != nullptr) ? wetOutLeft + start : nullptr, wetLeft, noise, segmentLength);
+        mixSegment(outRight + start, (wetOutRight != nullptr) ? wetOutRight + start : nullptr, wetRight, noise, segmentLength);
+
+        advanceRamps(segmentLength);
+    }
+}
+
+void InfatuationEngine::mixSegment(float* out, float* wetOut, const float* wet, const float* noise, int numSamples)
+{
+    const float* wetLevels = mRampValues[dryWetRamp];
+
+    if (wetLevels != nullptr) {
+        // as mixDryWet does it, with a wet level per sample
+        for (int i = 0; i < numSamples; i++) {
+            out[i] = (out[i] * (1 - wetLevels[i]) + wet[i] * wetLevels[i]) + noise[i];
+        }
+
+        if (wetOut != nullptr) {
+            for (int i = 0; i < numSamples; i++) {
+                wetOut[i] = wet[i] + noise[i];
+            }
+        }
+    } else if (wetOut != nullptr) {
+        mKernels->mixDryWetSend(out, wetOut, wet, noise, mParameters.dryWet, numSamples);
+    } else {
+        mKernels->mixDryWet(out, wet, noise, mParameters.dryWet, numSamples);
+    }
+}
+
+void InfatuationEngine::processSamples(const float* leftChannel, const float* rightChannel, float* wetLeft, float* wetRight, int numSamples)
+{
+    for (int i = 0; i < numSamples; i++) {
+
+        if (mIsRamping) {
+            applyRamps(i);
+        }
+
+        float delay_sample_left = 0;
+        float delay_sample_right = 0;
+
+        if ((mParameters.effectType == INFATUATION_CHORUS) || (mParameters.effectType == INFATUATION_FLANGER)) {
+
+            // LFO/phase starts
+
+            if (mLFOControlCounter == 0) {
+                updateLFOControlRate(mLFOPhase);
+            }
+
+            if (mParameters.effectType == INFATUATION_CHORUS)
+            {
+                mCircularBufferLeft[mCircularBufferWriteHead] = leftChannel[i];
+                mCircularBufferRight[mCircularBufferWriteHead] = rightChannel[i];
+            } else {
+                mCircularBufferLeft[mCircularBufferWriteHead] = leftChannel[i] + mFeedbackLeft;
+                mCircularBufferRight[mCircularBufferWriteHead] = rightChannel[i] + mFeedbackRight;
+            }
+
+            readModulatedDelay(mQuality, delay_sample_left, delay_sample_right);
+
+            if (mQualityCrossfadeRemaining > 0) {
+                float previous_sample_left;
+                float previous_sample_right;
+
+                readModulatedDelay(mPreviousQuality, previous_sample_left, previous_sample_right);
+
+                float gain = (float)mQualityCrossfadeRemaining / mQualityCrossfadeLength;
+                delay_sample_left += gain * (previous_sample_left - delay_sample_left);
+                delay_sample_right += gain * (previous_sample_right - delay_sample_right);
+                mQualityCrossfadeRemaining--;
+            }
+
+            advanceLFO();
+        } else if (mParameters.effectType == INFATUATION_DELAY)
+        {
+            mDelayTimeSmoothed = mDelayTimeSmoothed - 0.001 * (mDelayTimeSmoothed - mParameters.delayTime);
+            mDelayTimeInSamples = mSampleRate * mDelayTimeSmoothed;
+
+            mCircularBufferLeft[mCircularBufferWriteHead] = leftChannel[i] + mFeedbackLeft;
+            mCircularBufferRight[mCircularBufferWriteHead] = rightChannel[i] + mFeedbackRight;
+
+            // only the interpolation order changes with the quality here,
+            // so there's nothing worth crossfading
+
+            int order = (mQuality == INFATUATION_QUALITY_HIGH) ? 3 : 1;
+
+            delay_sample_left = readDelayLine(mCircularBufferLeft, mDelayTimeInSamples, order);
+            delay_sample_right = readDelayLine(mCircularBufferRight, mDelayTimeInSamples, order);
+        }
+
+        // same as Infatuation
+
+        mFeedbackLeft = delay_sample_left * mParameters.feedback;
+        mFeedbackRight = delay_sample_right * mParameters.feedback;
+
+        mCircularBufferWriteHead++;
+
+        wetLeft[i] = delay_sample_left;
+        wetRight[i] = delay_sample_right;
+
+        if (mCircularBufferWriteHead >= mCircularBufferLength) {
+            mCircularBufferWriteHead = 0;
+        }
+    }
+}
+
+void InfatuationEngine::processChorusBlock(const float* leftChannel, const float* rightChannel, float* wetLeft, float* wetRight, int numSamples)
+{
+    // The chorus doesn't feed back, so the whole block is written to the
+    // delay line first and read afterwards, instead of writing and reading
+    // one sample at a time. The reads see what they would have seen in that
+    // order as long as each one stays between the sample written with it
+    // and the oldest sample the block's writes leave alone. Sample i reads
+    // at most one sample past its read head (linear interpolation; High
+    // quality goes through processSamples), and the shortest chorus delay,
+    // 5 ms, keeps that behind the write of sample i. The longest, 42.5 ms
+    // with the triangle wave at full depth (its LFO output goes up to 2),
+    // is far less than MAX_DELAY_TIME minus MAX_SCRATCH_LENGTH samples, so
+    // the block never overwrites a sample still to be read. That leaves the
+    // LFO as the only per-sample work.
+
+    float* readHeadsLeft = getScratch(readHeadLeftScratch);
+    float* readHeadsRight = getScratch(readHeadRightScratch);
+
+    for (int i = 0; i < numSamples; i++) {
+
+        if (mIsRamping) {
+            applyRamps(i);
+        }
+
+        if (mLFOControlCounter == 0) {
+            updateLFOControlRate(mLFOPhase);
+        }
+
+        float delayTimeSamplesLeft;
+        float delayTimeSamplesRight;
+
+        getModulatedDelayTimes(mQuality, delayTimeSamplesLeft, delayTimeSamplesRight);
+
+        int writeHead = mCircularBufferWriteHead + i;
+
+        if (writeHead >= mCircularBufferLength) {
+            writeHead -= mCircularBufferLength;
+        }
+
+        readHeadsLeft[i] = writeHead - delayTimeSamplesLeft;
+        readHeadsRight[i] = writeHead - delayTimeSamplesRight;
+
+        if (readHeadsLeft[i] < 0) {
+            readHeadsLeft[i] += mCircularBufferLength;
+        }
+
+        if (readHeadsRight[i] < 0) {
+            readHeadsRight[i] += mCircularBufferLength;
+        }
+
+        // as in readDelayLine, a read head a hair below zero can round up to the length
+        if (readHeadsLeft[i] >= mCircularBufferLength) {
+            readHeadsLeft[i] -= mCircularBufferLength;
+        }
+
+        if (readHeadsRight[i] >= mCircularBufferLength) {
+            readHeadsRight[i] -= mCircularBufferLength;
+        }
+
+        advanceLFO();
+    }
+
+    InfatuationKernels::writeCircular(mCircularBufferLeft, mCircularBufferLength, mCircularBufferWriteHead, leftChannel, numSamples);
+    InfatuationKernels::writeCircular(mCircularBufferRight, mCircularBufferLength, mCircularBufferWriteHead, rightChannel, numSamples);
+
+    mKernels->interpolate(wetLeft, mCircularBufferLeft, mCircularBufferLength, readHeadsLeft, numSamples);
+    mKernels->interpolate(wetRight, mCircularBufferRight, mCircularBufferLength, readHeadsRight, numSamples);
+
+    mFeedbackLeft = wetLeft[numSamples - 1] * mParameters.feedback;
+    mFeedbackRight = wetRight[numSamples - 1] * mParameters.feedback;
+
+    mCircularBufferWriteHead += numSamples;
+
+    if (mCircularBufferWriteHead >= mCircularBufferLength) {
+        mCircularBufferWriteHead -= mCircularBufferLength;
+    }
+}
+
+void InfatuationEngine::processFeedbackBlock(const float* leftChannel, const float* rightChannel, float* wetLeft, float* wetRight, int numSamples)
+{
+    // The delay and flanger feed back, but a sample written now can't be read
+    // until the shortest delay time has passed. Split into sub-blocks no
+    // longer than that, every read in a sub-block sees only audio from before
+    // it, so the reads, the feedback and the writes can each be done as one
+    // pass over the sub-block. Same output as processSamples.
+
+    float* readHeadsLeft = getScratch(readHeadLeftScratch);
+    float* readHeadsRight = getScratch(readHeadRightScratch);
+    float* feedback = getScratch(feedbackScratch);
+    const float* feedbackGains = mRampValues[feedbackRamp];
+
+    // the delay times don't depend on the audio, so they can all be worked out first
+    for (int i = 0; i < numSamples; i++) {
+        if (mIsRamping) {
+            applyRamps(i);
+        }
+
+        if (mParameters.effectType == INFATUATION_DELAY) {
+            float smoothed = mDelayTimeSmoothed - 0.001 * (mDelayTimeSmoothed - mParameters.delayTime);
+
+            if (smoothed == mDelayTimeSmoothed && mRampValues[delayTimeRamp] == nullptr) {
+                // settled, it won't move again until the delay time changes
+                std::fill(readHeadsLeft + i, readHeadsLeft + numSamples, mDelayTimeInSamples);
+                std::fill(readHeadsRight + i, readHeadsRight + numSamples, mDelayTimeInSamples);
+                break;
+            }
+
+            mDelayTimeSmoothed = smoothed;
+            mDelayTimeInSamples = mSampleRate * mDelayTimeSmoothed;
+
+            readHeadsLeft[i] = mDelayTimeInSamples;
+            readHeadsRight[i] = mDelayTimeInSamples;
+        } else {
+            if (mLFOControlCounter == 0) {
+                updateLFOControlRate(mLFOPhase);
+            }
+
+            getModulatedDelayTimes(mQuality, readHeadsLeft[i], readHeadsRight[i]);
+            advanceLFO();
+        }
+    }
+
+    for (int start = 0; start < numSamples;) {
+
+        int length = getSubBlockLength(readHeadsLeft + start, readHeadsRight + start, numSamples - start);
+
+        if (length == 0) {
+            // a delay shorter than a couple of samples reads what was just written
+            mCircularBufferLeft[mCircularBufferWriteHead] = leftChannel[start] + mFeedbackLeft;
+            mCircularBufferRight[mCircularBufferWriteHead] = rightChannel[start] + mFeedbackRight;
+
+            wetLeft[start] = readDelayLine(mCircularBufferLeft, readHeadsLeft[start], 1);
+            wetRight[start] = readDelayLine(mCircularBufferRight, readHeadsRight[start], 1);
+
+            float gain = (feedbackGains != nullptr) ? feedbackGains[start] : mParameters.feedback;
+
+            mFeedbackLeft = wetLeft[start] * gain;
+            mFeedbackRight = wetRight[start] * gain;
+
+            mCircularBufferWriteHead++;
+
+            if (mCircularBufferWriteHead >= mCircularBufferLength) {
+                mCircularBufferWriteHead = 0;
+            }
+
+            start++;
+            continue;
+        }
+
+        // as in readDelayLine, written so the compiler can vectorise it
+        float bufferLength = (float)mCircularBufferLength;
+
+        for (int i = start; i < start + length; i++) {
+            int writeHead = mCircularBufferWriteHead + (i - start);
+            writeHead -= (writeHead >= mCircularBufferLength) ? mCircularBufferLength : 0;
+
+            float readHeadLeft = writeHead - readHeadsLeft[i];
+            float readHeadRight = writeHead - readHeadsRight[i];
+
+            readHeadLeft += (readHeadLeft < 0) ? bufferLength : 0.0f;
+            readHeadRight += (readHeadRight < 0) ? bufferLength : 0.0f;
+
+            readHeadsLeft[i] = (readHeadLeft >= bufferLength) ? readHeadLeft - bufferLength : readHeadLeft;
+            readHeadsRight[i] = (readHeadRight >= bufferLength) ? readHeadRight - bufferLength : readHeadRight;
+        }
+
+        mKernels->interpolate(wetLeft + start, mCircularBufferLeft, mCircularBufferLength, readHeadsLeft + start, length);
+        mKernels->interpolate(wetRight + start, mCircularBufferRight, mCircularBufferLength, readHeadsRight + start, length);
+
+        // each sample carries the feedback from the one before it
+        const float* gains = (feedbackGains != nullptr) ? feedbackGains + start : nullptr;
+
+        getFeedbackInput(feedback, leftChannel + start, wetLeft + start, mFeedbackLeft, mParameters.feedback, gains, length);
+        InfatuationKernels::writeCircular(mCircularBufferLeft, mCircularBufferLength, mCircularBufferWriteHead, feedback, length);
+
+        getFeedbackInput(feedback, rightChannel + start, wetRight + start, mFeedbackRight, mParameters.feedback, gains, length);
+        InfatuationKernels::writeCircular(mCircularBufferRight, mCircularBufferLength, mCircularBufferWriteHead, feedback, length);
+
+        float gain = (gains != nullptr) ? gains[length - 1] : mParameters.feedback;
+
+        mFeedbackLeft = wetLeft[start + length - 1] * gain;
+        mFeedbackRight = wetRight[start + length - 1] * gain;
+
+        mCircularBufferWriteHead += length;
+
+        if (mCircularBufferWriteHead >= mCircularBufferLength) {
+            mCircularBufferWriteHead -= mCircularBufferLength;
+        }
+
+        start += length;
+    }
+}
+
+int InfatuationEngine::getSubBlockLength(const float* delayTimesLeft, const float* delayTimesRight, int numSamples) const
+{
+    // Sample i of a sub-block reads two neighbouring samples, so its delay has
+    // to be over i + 1 for both to be older than the sub-block; one more
+    // sample covers the rounding of the read head. At the other end, a delay
+    // close to the whole buffer must not reach round to the sub-block's own
+    // writes. Stops at the first sample that would break either.
+
+    float longestDelay = 0;
+
+    for (int i = 0; i < numSamples; i++) {
+        float shortest = std::min(delayTimesLeft[i], delayTimesRight[i]);
+        longestDelay = std::max(longestDelay, std::max(delayTimesLeft[i], delayTimesRight[i]));
+
+        if (shortest < i + 2 || longestDelay > mCircularBufferLength - (i + 3)) {
+            return i;
+        }
+    }
+
+    return numSamples;
+}
+
+float InfatuationParams::* InfatuationEngine::getRampedField(int parameter)
+{
+    static float InfatuationParams::* const fields[numRampedParameters] = {
+        &InfatuationParams::dryWet,
+        &InfatuationParams::depth,
+        &InfatuationParams::rate,
+        &InfatuationParams::phaseOffset,
+        &InfatuationParams::feedback,
+        &InfatuationParams::delayTime,
+        &InfatuationParams::noiseLevel
+    };
+
+    return fields[parameter];
+}
+
+void InfatuationEngine::startRamp(int parameter, float start, float target, int length)
+{
+    ParameterRamp& ramp = mRamps[parameter];
+
+    ramp.isActive = true;
+    ramp.isExponential = false;
+    ramp.start = start;
+    ramp.target = target;
+    ramp.step = (target - start) / length;
+    ramp.length = length;
+    ramp.position = 0;
+
+    mParameters.*getRampedField(parameter) = start;
+}
+
+void InfatuationEngine::startExponentialRamp(int parameter, float start, float target)
+{
+    // it never gets there on its own, so it lands once it's inaudibly close
+    double settled = std::log(SMOOTHING_SETTLED / std::abs(start - target)) / std::log(mSmoothingCoefficient);
+
+    if (settled < 1) {
+        mRamps[parameter].isActive = false;
+        return;
+    }
+
+    startRamp(parameter, start, target, (int)std::min(std::ceil(settled), (double)std::numeric_limits<int>::max()));
+    mRamps[parameter].isExponential = true;
+}
+
+void InfatuationEngine::updateSmoothing()
+{
+    // counted in samples, so the glide takes the same time at any rate
+    mSmoothingLength = (int)std::lround(mSmoothingTime * mSampleRate);
+
+    if (mSmoothingLength == 0) {
+        return;
+    }
+
+    // how much of an exponential glide is left after each sample, down to
+    // SMOOTHING_REMAINDER after mSmoothingLength
+    mSmoothingCoefficient = std::pow(SMOOTHING_REMAINDER, 1.0 / mSmoothingLength);
+
+    double power = 1;
+
+    for (int i = 0; i < SMOOTHING_PERIOD; i++) {
+        power *= mSmoothingCoefficient;
+        mSmoothingPowers[i] = (float)power;
+    }
+}
+
+void InfatuationEngine::fillRamps(int numSamples)
+{
+    mIsRamping = false;
+
+    for (int p = 0; p < numRampedParameters; p++) {
+        const ParameterRamp& ramp = mRamps[p];
+
+        if (! ramp.isActive) {
+            mRampValues[p] = nullptr;
+            continue;
+        }
+
+        float* values = getScratch((ScratchChannel)(rampScratch + p));
+
+        if (ramp.isExponential) {
+            // Each SMOOTHING_PERIOD of the ramp scales the powers by what's
+            // left at its start, which only depends on the position in the
+            // ramp, so the values don't depend on how it's split into blocks
+            float distance = ramp.start - ramp.target;
+            int i = 0;
+
+            while (i < numSamples) {
+                int step = ramp.position + i;
+                int phase = step % SMOOTHING_PERIOD;
+                int length = std::min(numSamples - i, SMOOTHING_PERIOD - phase);
+                float left = (float)(distance * std::pow(mSmoothingCoefficient, (double)(step - phase)));
+
+                for (int j = 0; j < length; j++) {
+                    values[i + j] = (step + j + 1 < ramp.length) ? ramp.target + left * mSmoothingPowers[phase + j] : ramp.target;
+                }
+
+                i += length;
+            }
+        } else {
+            // worked out from the start every time, so the last step lands on the target
+            for (int i = 0; i < numSamples; i++) {
+                int step = ramp.position + i + 1;
+                values[i] = (step < ramp.length) ? ramp.start + ramp.step * step : ramp.target;
+            }
+        }
+
+        mRampValues[p] = values;
+        mIsRamping = true;
+    }
+}
+
+void InfatuationEngine::applyRamps(int i)
+{
+    for (int p = 0; p < numRampedParameters; p++) {
+        if (mRampValues[p] != nullptr) {
+            mParameters.*getRampedField(p) = mRampValues[p][i];
+        }
+    }
+}
+
+void InfatuationEngine::advanceRamps(int numSamples)
+{
+    for (int p = 0; p < numRampedParameters; p++) {
+        ParameterRamp& ramp = mRamps[p];
+
+        if (mRampValues[p] == nullptr) {
+            continue;
+        }
+
+        mParameters.*getRampedField(p) = mRampValues[p][numSamples - 1];
+        ramp.position += numSamples;
+
+        if (ramp.position >= ramp.length) {
+            ramp.isActive = false;
+        }
+
+        mRampValues[p] = nullptr;
+    }
+
+    mIsRamping = false;
+}
+
+void InfatuationEngine::advanceLFO()
+{
+    mLFOPhase += mParameters.rate / mSampleRate;
+
+    if (mLFOPhase > 1)
+    {
+        mLFOPhase -= 1;
+    }
+
+    mLFOControlCounter++;
+
+    if (mLFOControlCounter >= LFO_CONTROL_INTERVAL) {
+        mLFOControlCounter = 0;
+    }
+}
+
+double InfatuationEngine::getRightLFOPhase(double leftPhase)
+{
+    return getRightLFOPhase(mParameters, leftPhase);
+}
+
+float InfatuationEngine::getLFODelayInSamples(double phase)
+{
+    return getLFODelayInSamples(mParameters, mSampleRate, phase);
+}
+
+double InfatuationEngine::getRightLFOPhase(const InfatuationParams& parameters, double leftPhase)
+{
+    double lfoPhaseRight = leftPhase;
+
+    if (parameters.effectType == INFATUATION_CHORUS) {
+        lfoPhaseRight = leftPhase + 0.5;
+    } else if (parameters.effectType == INFATUATION_FLANGER) {
+        lfoPhaseRight = leftPhase + parameters.phaseOffset;
+    }
+
+    if (lfoPhaseRight > 1)
+    {
+        lfoPhaseRight -= 1;
+    }
+
+    return lfoPhaseRight;
+}
+
+float InfatuationEngine::getLFODelayInSamples(const InfatuationParams& parameters, double sampleRate, double phase)
+{
+    float lfoOut = 0;
+
+    if (parameters.waveType == INFATUATION_WAVE_SINE) {
+        lfoOut = std::sin(2*M_PI * phase);
+    } else if (parameters.waveType == INFATUATION_WAVE_SAW) {
+        lfoOut = 2*phase - 1;
+    } else if (parameters.waveType == INFATUATION_WAVE_TRIANGLE) {
+        lfoOut = 4*std::fabs(phase - 0.5);
+    }
+
+    lfoOut *= parameters.depth;
+
+    float lfoOutMapped = 0;
+
+    if (parameters.effectType == INFATUATION_CHORUS)
+    {
+        lfoOutMapped = mapRange(lfoOut, -1.f, 1.f, 0.005f, 0.03f);
+    } else if (parameters.effectType == INFATUATION_FLANGER)
+    {
+        lfoOutMapped = mapRange(lfoOut, -1.f, 1.f, 0.001f, 0.005f);
+    }
+
+    return sampleRate * lfoOutMapped;
+}
+
+void InfatuationEngine::updateLFOControlRate(double phase)
+{
+    // Eco quality evaluates the LFO once per LFO_CONTROL_INTERVAL samples and
+    // ramps the delay time linearly in between
+    double nextPhase = phase + LFO_CONTROL_INTERVAL * mParameters.rate / mSampleRate;
+    nextPhase -= std::floor(nextPhase);
+
+    mLFOControlDelayLeft = getLFODelayInSamples(phase);
+    mLFOControlDelayRight = getLFODelayInSamples(getRightLFOPhase(phase));
+
+    mLFOControlStepLeft = (getLFODelayInSamples(nextPhase) - mLFOControlDelayLeft) / LFO_CONTROL_INTERVAL;
+    mLFOControlStepRight = (getLFODelayInSamples(getRightLFOPhase(nextPhase)) - mLFOControlDelayRight) / LFO_CONTROL_INTERVAL;
+}
+
+void InfatuationEngine::getModulatedDelayTimes(int quality, float& outLeft, float& outRight)
+{
+    if (quality == INFATUATION_QUALITY_ECO) {
+        outLeft = mLFOControlDelayLeft + mLFOControlStepLeft * mLFOControlCounter;
+        outRight = mLFOControlDelayRight + mLFOControlStepRight * mLFOControlCounter;
+    } else {
+        outLeft = getLFODelayInSamples(mLFOPhase);
+        outRight = getLFODelayInSamples(getRightLFOPhase(mLFOPhase));
+    }
+}
+
+void InfatuationEngine::readModulatedDelay(int quality, float& outLeft, float& outRight)
+{
+    float delayTimeSamplesLeft;
+    float delayTimeSamplesRight;
+
+    getModulatedDelayTimes(quality, delayTimeSamplesLeft, delayTimeSamplesRight);
+
+    int order = (quality == INFATUATION_QUALITY_HIGH) ? 3 : 1;
+
+    outLeft = readDelayLine(mCircularBufferLeft, delayTimeSamplesLeft, order);
+    outRight = readDelayLine(mCircularBufferRight, delayTimeSamplesRight, order);
+
+    if (quality == INFATUATION_QUALITY_HIGH && mParameters.effectType == INFATUATION_CHORUS) {
+        // second chorus voice, a quarter cycle behind the first
+        double voicePhase = mLFOPhase + 0.25;
+
+        if (voicePhase > 1) {
+            voicePhase -= 1;
+        }
+
+        outLeft = 0.5f * (outLeft + readDelayLine(mCircularBufferLeft, getLFODelayInSamples(voicePhase), order));
+        outRight = 0.5f * (outRight + readDelayLine(mCircularBufferRight, getLFODelayInSamples(getRightLFOPhase(voicePhase)), order));
+    }
+}
+
+float InfatuationEngine::readDelayLine(const float* circularBuffer, float delayTimeInSamples, int order)
+{
+    float delayReadHead = mCircularBufferWriteHead - delayTimeInSamples;
+
+    if (delayReadHead < 0)
+    {
+        delayReadHead += mCircularBufferLength;
+    }
+
+    int readHead_x = (int)delayReadHead;
+    int readHead_x1 = readHead_x + 1;
+    float readHeadFloat = delayReadHead - readHead_x;
+
+    // a read head a hair below zero rounds up to the length once it's wrapped
+    if (readHead_x >= mCircularBufferLength)
+    {
+        readHead_x -= mCircularBufferLength;
+    }
+
+    if (readHead_x1 >= mCircularBufferLength)
+    {
+        readHead_x1 -= mCircularBufferLength;
+    }
+
+    if (order == 1) {
+        return linearInterpolation(circularBuffer[readHead_x], circularBuffer[readHead_x1], readHeadFloat);
+    }
+
+    int readHead_xm1 = readHead_x - 1;
+    int readHead_x2 = readHead_x1 + 1;
+
+    if (readHead_xm1 < 0) {
+        readHead_xm1 += mCircularBufferLength;
+    }
+
+    if (readHead_x2 >= mCircularBufferLength) {
+        readHead_x2 -= mCircularBufferLength;
+    }
+
+    return cubicInterpolation(circularBuffer[readHead_xm1], circularBuffer[readHead_x], circularBuffer[readHead_x1], circularBuffer[readHead_x2], readHeadFloat);
+}
+
+void InfatuationEngine::setQuality(int newQuality)
+{
+    mPreviousQuality = mQuality;
+    mQuality = newQuality;
+
+    mQualityCrossfadeLength = std::max(1, (int)(mSampleRate * QUALITY_CROSSFADE_TIME));
+    mQualityCrossfadeRemaining = mQualityCrossfadeLength;
+}
+
+float* InfatuationEngine::getScratch(ScratchChannel channel)
+{
+    return mScratchMemory.getData() + (size_t)channel * mScratchLength;
+}
+
+float InfatuationEngine::linearInterpolation(float sample_r, float sample_x1, float inPhase) {
+    return (1 - inPhase) * sample_r + inPhase * sample_x1;
+}
+
+float InfatuationEngine::cubicInterpolation(float sample_xm1, float sample_x, float sample_x1, float sample_x2, float inPhase) {
+    // 4-point, 3rd-order Hermite
+    float c1 = 0.5f * (sample_x1 - sample_xm1);
+    float c2 = sample_xm1 - 2.5f * sample_x + 2.0f * sample_x1 - 0.5f * sample_x2;
+    float c3 = 0.5f * (sample_x2 - sample_xm1) + 1.5f * (sample_x - sample_x1);
+
+    return ((c3 * inPhase + c2) * inPhase + c1) * inPhase + sample_x;
+}
+
+void InfatuationEngine::setRandomSeed(int64_t newSeed) {
+    mRandomSeed = newSeed;
+    mRandomState = (uint64_t)mRandomSeed;
+}
+
+int64_t InfatuationEngine::advanceRandomSeed(int64_t seed, int64_t numSteps) {
+    // the generator is the 48-bit LCG x' = (a * x + c) mod 2^48, so n steps
+    // can be composed by squaring the affine map (a, c) log2(n) times
+    const uint64_t mask = 0xffffffffffffULL;
+
+    uint64_t multiplier = 0x5deece66dULL;
+    uint64_t increment = 11;
+    uint64_t x = (uint64_t)seed;
+
+    while (numSteps > 0) {
+        if (numSteps & 1) {
+            x = (x * multiplier + increment) & mask;
+        }
+
+        increment = (increment * (multiplier + 1)) & mask;
+        multiplier = (multiplier * multiplier) & mask;
+        numSteps >>= 1;
+    }
+
+    return (int64_t)x;
+}
+
+void InfatuationEngine::setRenderPosition(int64_t samplePosition) {
+    // the LFO only runs in chorus and flanger mode
+    if ((mParameters.effectType == INFATUATION_CHORUS) || (mParameters.effectType == INFATUATION_FLANGER)) {
+        double cycles = (double)samplePosition * mParameters.rate / mSampleRate;
+        mLFOPhase = cycles - std::floor(cycles);
+
+        // pick the control-rate ramp up from the last control point
+        mLFOControlCounter = (int)(samplePosition % LFO_CONTROL_INTERVAL);
+
+        double controlCycles = (double)(samplePosition - mLFOControlCounter) * mParameters.rate / mSampleRate;
+        updateLFOControlRate(controlCycles - std::floor(controlCycles));
+    } else {
+        mLFOPhase = 0;
+    }
+
+    mRandomState = (uint64_t)advanceRandomSeed(mRandomSeed, samplePosition);
+
+    // the read heads are worked out from the write head, and a float delay
+    // subtracted from another index rounds differently
+    if (mCircularBufferLength > 0) {
+        mCircularBufferWriteHead = (int)(samplePosition % mCircularBufferLength);
+    }
+}
+
+bool InfatuationEngine::saveCheckpoint(const char* path, int64_t samplePosition) const {
+    if (mCircularBufferLeft == nullptr) {
+        return false;
+    }
+
+    // copyState only reads the engine when saving
+    InfatuationEngine& engine = const_cast<InfatuationEngine&>(*this);
+
+    size_t stateSize = engine.copyState(nullptr, false);
+    size_t stateOffset = alignCheckpointOffset(sizeof(CheckpointHeader));
+    size_t delayOffset = alignCheckpointOffset(stateOffset + stateSize);
+    size_t delayBytes = (size_t)mCircularBufferLength * sizeof(float);
+
+    MappedFile file;
+
+    if (! file.create(path, delayOffset + 2 * delayBytes)) {
+        return false;
+    }
+
+    char* data = static_cast<char*>(file.getData());
+
+    CheckpointHeader header {};
+    std::memcpy(header.magic, checkpointMagic, sizeof(header.magic));
+    header.version = CHECKPOINT_VERSION;
+    header.stateSize = (uint32_t)stateSize;
+    header.sampleRate = mSampleRate;
+    header.samplePosition = samplePosition;
+    header.circularBufferLength = mCircularBufferLength;
+
+    std::memcpy(data, &header, sizeof(header));
+    engine.copyState(data + stateOffset, false);
+    std::memcpy(data + delayOffset, mCircularBufferLeft, delayBytes);
+    std::memcpy(data + delayOffset + delayBytes, mCircularBufferRight, delayBytes);
+
+    return file.commit();
+}
+
+bool InfatuationEngine::loadCheckpoint(const char* path, int64_t* samplePosition) {
+    if (mCircularBufferLeft == nullptr) {
+        return false;
+    }
+
+    MappedFile file;
+
+    if (! file.open(path) || file.getSize() < sizeof(CheckpointHeader)) {
+        return false;
+    }
+
+    const char* data = static_cast<const char*>(file.getData());
+
+    CheckpointHeader header;
+    std::memcpy(&header, data, sizeof(header));
+
+    size_t stateSize = copyState(nullptr, true);
+    size_t stateOffset = alignCheckpointOffset(sizeof(CheckpointHeader));
+    size_t delayOffset = alignCheckpointOffset(stateOffset + stateSize);
+    size_t delayBytes = (size_t)mCircularBufferLength * sizeof(float);
+
+    if (std::memcmp(header.magic, checkpointMagic, sizeof(header.magic)) != 0
+        || header.version != CHECKPOINT_VERSION
+        || header.stateSize != stateSize
+        || header.sampleRate != mSampleRate
+        || header.circularBufferLength != mCircularBufferLength
+        || file.getSize() != delayOffset + 2 * delayBytes) {
+        return false;
+    }
+
+    copyState(const_cast<char*>(data) + stateOffset, true);
+    std::memcpy(mCircularBufferLeft, data + delayOffset, delayBytes);
+    std::memcpy(mCircularBufferRight, data + delayOffset + delayBytes, delayBytes);
+
+    // checkpoints are taken between blocks, when no ramp values are pending
+    for (int p = 0; p < numRampedParameters; p++) {
+        mRampValues[p] = nullptr;
+    }
+
+    mIsRamping = false;
+    updateSmoothing();
+
+    if (samplePosition != nullptr) {
+        *samplePosition = header.samplePosition;
+    }
+
+    return true;
+}
+
+size_t InfatuationEngine::copyState(char* state, bool isLoading) {
+    // Everything process() carries from one block to the next besides the
+    // delay lines, copied into state or back out of it. With a null state it
+    // only adds up the size.
+    size_t size = 0;
+
+    auto copy = [&](void* member, size_t numBytes) {
+        if (state != nullptr) {
+            if (isLoading) {
+                std::memcpy(member, state + size, numBytes);
+            } else {
+                std::memcpy(state + size, member, numBytes);
+            }
+        }
+
+        size += numBytes;
+    };
+
+    copy(&mParameters, sizeof(mParameters));
+    copy(&mHasProcessed, sizeof(mHasProcessed));
+    copy(&mIsDelayLineClear, sizeof(mIsDelayLineClear));
+
+    copy(&mLFOPhase, sizeof(mLFOPhase));
+    copy(&mFeedbackLeft, sizeof(mFeedbackLeft));
+    copy(&mFeedbackRight, sizeof(mFeedbackRight));
+    copy(&mDelayTimeInSamples, sizeof(mDelayTimeInSamples));
+    copy(&mDelayTimeSmoothed, sizeof(mDelayTimeSmoothed));
+
+    copy(&mLFOControlCounter, sizeof(mLFOControlCounter));
+    copy(&mLFOControlDelayLeft, sizeof(mLFOControlDelayLeft));
+    copy(&mLFOControlDelayRight, sizeof(mLFOControlDelayRight));
+    copy(&mLFOControlStepLeft, sizeof(mLFOControlStepLeft));
+    copy(&mLFOControlStepRight, sizeof(mLFOControlStepRight));
+
+    copy(mRamps, sizeof(mRamps));
+    copy(&mSmoothingShape, sizeof(mSmoothingShape));
+    copy(&mSmoothingTime, sizeof(mSmoothingTime));
+
+    copy(&mQuality, sizeof(mQuality));
+    copy(&mPreviousQuality, sizeof(mPreviousQuality));
+    copy(&mQualityCrossfadeLength, sizeof(mQualityCrossfadeLength));
+    copy(&mQualityCrossfadeRemaining, sizeof(mQualityCrossfadeRemaining));
+
+    copy(&mCircularBufferWriteHead, sizeof(mCircularBufferWriteHead));
+    copy(&mRandomState, sizeof(mRandomState));
+    copy(&mRandomSeed, sizeof(mRandomSeed));
+
+    return size;
+}
+
+int64_t InfatuationEngine::getStateMemoryInSamples(float errorBound) const {
+    float longestDelayInSamples = 0;
+    float feedback = mParameters.feedback;
+
+    if (mParameters.effectType == INFATUATION_DELAY) {
+        longestDelayInSamples = mParameters.delayTime * (float)mSampleRate;
+    } else {
+        // every wave shape peaks at one of these phases (the saw just before
+        // the end of the cycle), and the delay grows with the LFO output, so
+        // the longest the current wave and depth can reach is among them
+        static const double extremePhases[] = { 0.0, 0.25, 0.5, 0.75, 1.0 };
+
+        for (double phase : extremePhases) {
+            longestDelayInSamples = std::max(longestDelayInSamples, getLFODelayInSamples(mParameters, mSampleRate, phase));
+        }
+
+        // the chorus doesn't write its feedback back into the delay line
+        if (mParameters.effectType == INFATUATION_CHORUS) {
+            feedback = 0;
+        }
+    }
+
+    // every pass through the delay line scales what's left by the feedback
+    int numRepeats = 1;
+
+    if (feedback > 0) {
+        numRepeats += (int)std::ceil(std::log(errorBound) / std::log(feedback));
+    }
+
+    return (int64_t)std::ceil(longestDelayInSamples) * numRepeats + 2;
+}
+
+double InfatuationEngine::getSampleRate() const
+{
+    return mSampleRate;
+}
+
+int InfatuationEngine::getQuality() const
+{
+    return mQuality;
+}
+
+InfatuationKernels::Variant InfatuationEngine::getKernelVariant() const
+{
+    return mKernels->variant;
+}
+
+const DSPBuffer& InfatuationEngine::getDelayMemory() const
+{
+    return mDelayMemory;
+}
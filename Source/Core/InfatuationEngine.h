@@ -0,0 +1,256 @@
+/*
+  ==============================================================================
+
+    InfatuationEngine.h
+
+    The delay, chorus, flanger and noise engines, with no JUCE dependency.
+    The plugin wraps one of these, render workers can use it directly or
+    through the C interface in InfatuationCore.h.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <cstdint>
+#include "DSPBuffer.h"
+#include "DSPKernels.h"
+#include "InfatuationCore.h"
+
+#define MAX_DELAY_TIME 2
+#define DEFAULT_RANDOM_SEED 0x1F47
+
+#define LFO_CONTROL_INTERVAL 32
+#define QUALITY_CROSSFADE_TIME 0.01
+
+#define MAX_SCRATCH_LENGTH 4096
+
+#define SMOOTHING_REMAINDER 0.01
+#define SMOOTHING_SETTLED 1.0e-5f
+#define SMOOTHING_PERIOD 64
+
+#define CHECKPOINT_VERSION 1
+
+//==============================================================================
+/**
+*/
+class InfatuationEngine
+{
+public:
+    InfatuationEngine();
+    ~InfatuationEngine();
+
+    // Allocates the delay lines for sampleRate and resets everything. Not for
+    // the audio thread. Returns false if the memory couldn't be allocated.
+    bool prepare(double sampleRate, int maxBlockSize);
+
+    // Clears the delay lines and restarts the LFO and the noise generator.
+    void reset();
+
+    // Changes of quality are crossfaded, except before the first block after
+    // a reset, when the delay time and quality are taken as they are.
+    //
+    // With a rampLength, the continuous parameters (dry/wet, depth, rate,
+    // phase offset, feedback, delay time and noise level) move in a straight
+    // line from where they are to their new values over that many samples,
+    // one step per sample, and reach them on the last; the rest change at
+    // once. Without one, a value that a ramp is already heading for lets it
+    // carry on, so the same parameters can be set again every block, and
+    // other changes glide as set by setSmoothing().
+    void setParameters(const InfatuationParams& newParameters, int rampLength = 0);
+    const InfatuationParams& getParameters() const;
+
+    // Changes of dry/wet, depth, rate, phase offset, feedback and noise level
+    // made without a rampLength glide over time seconds at any sample rate:
+    // in a straight line with INFATUATION_SMOOTHING_LINEAR, or with
+    // INFATUATION_SMOOTHING_EXPONENTIAL quickly at first and within
+    // SMOOTHING_REMAINDER of the change after time. The delay time keeps its
+    // own glide. Either shape gives the same output at any block size.
+    // Off by default; set it before prepare() or between blocks.
+    void setSmoothing(int shape, double time);
+
+    // Whether the delay lines and scratch memory are locked into RAM, which
+    // they are by default. An offline render has no deadline to keep and
+    // can leave them to be paged like any other memory. Not for the audio
+    // thread.
+    void setMemoryLocking(bool shouldLock);
+
+    // inLeft and inRight feed the delay lines. outLeft and outRight hold the
+    // dry signal on entry and have the wet signal and noise mixed into them;
+    // they may be the same buffers as the inputs.
+    //
+    // If wetOutLeft or wetOutRight is given, that channel's wet signal and
+    // noise are written to it as well, in the same pass as the mix. This is
+    // what the outputs would hold with dryWet at 1, so one engine can feed
+    // both a blended bus and a send. The wet outputs mustn't overlap the others.
+    void process(const float* inLeft, const float* inRight, float* outLeft, float* outRight, int numSamples,
+                 float* wetOutLeft = nullptr, float* wetOutRight = nullptr);
+
+    float linearInterpolation(float sample_r, float sample_x1, float inPhase);
+    float cubicInterpolation(float sample_xm1, float sample_x, float sample_x1, float sample_x2, float inPhase);
+
+    // The noise generator is reseeded with this value on every reset, so two
+    // renders of the same input produce the same output.
+    void setRandomSeed(int64_t newSeed);
+
+    // Returns the state of the noise generator seeded with seed after
+    // numSteps values, without generating the values in between.
+    static int64_t advanceRandomSeed(int64_t seed, int64_t numSteps);
+
+    // Moves the LFO phase, the noise generator and the delay line's write head
+    // to where they would be after samplePosition samples of playback since
+    // reset. What the delay line holds is not touched; it has to be warmed up
+    // by processing some audio.
+    void setRenderPosition(int64_t samplePosition);
+
+    // Writes everything process() depends on, the delay lines included, to a
+    // memory-mapped file at path, so a long render can stop here and carry
+    // on later or on another machine. samplePosition is kept with it for the
+    // caller. The file only replaces an earlier one at path once it is
+    // complete. Call between blocks; not for the audio thread.
+    bool saveCheckpoint(const char* path, int64_t samplePosition) const;
+
+    // Restores a checkpoint into an engine prepared at the same sample rate,
+    // which then continues sample for sample as the saved one would have.
+    // Every kernel variant gives the scalar result, so the CPU it runs on
+    // doesn't matter. Returns false and leaves the engine as it was if the
+    // file is missing, isn't a checkpoint from this version or was saved at
+    // another sample rate.
+    bool loadCheckpoint(const char* path, int64_t* samplePosition = nullptr);
+
+    // Number of samples after which the delay line and feedback path have
+    // forgotten their input to within errorBound, for the current parameters.
+    int64_t getStateMemoryInSamples(float errorBound) const;
+
+    // The LFO shapes, shared with the batch engine so the two stay identical
+    static double getRightLFOPhase(const InfatuationParams& parameters, double leftPhase);
+    static float getLFODelayInSamples(const InfatuationParams& parameters, double sampleRate, double phase);
+
+    double getSampleRate() const;
+    int getQuality() const;
+    InfatuationKernels::Variant getKernelVariant() const;
+    const DSPBuffer& getDelayMemory() const;
+
+private:
+
+    void processSamples(const float* leftChannel, const float* rightChannel, float* wetLeft, float* wetRight, int numSamples);
+    void processChorusBlock(const float* leftChannel, const float* rightChannel, float* wetLeft, float* wetRight, int numSamples);
+    void processFeedbackBlock(const float* leftChannel, const float* rightChannel, float* wetLeft, float* wetRight, int numSamples);
+    int getSubBlockLength(const float* delayTimesLeft, const float* delayTimesRight, int numSamples) const;
+    void mixSegment(float* out, float* wetOut, const float* wet, const float* noise, int numSamples);
+    void advanceLFO();
+
+    double getRightLFOPhase(double leftPhase);
+    float getLFODelayInSamples(double phase);
+    void updateLFOControlRate(double phase);
+    void getModulatedDelayTimes(int quality, float& outLeft, float& outRight);
+    void readModulatedDelay(int quality, float& outLeft, float& outRight);
+    float readDelayLine(const float* circularBuffer, float delayTimeInSamples, int order);
+
+    void setQuality(int newQuality);
+
+    size_t copyState(char* state, bool isLoading);
+
+    enum RampedParameter
+    {
+        dryWetRamp,
+        depthRamp,
+        rateRamp,
+        phaseOffsetRamp,
+        feedbackRamp,
+        delayTimeRamp,
+        noiseLevelRamp,
+        numRampedParameters
+    };
+
+    struct ParameterRamp
+    {
+        bool isActive;
+        bool isExponential;
+        float start;
+        float target;
+
+        // after n samples, start + step * n for a linear ramp and target +
+        // (start - target) * coefficient^n for an exponential one, until the
+        // target is reached after length
+        float step;
+        int length;
+        int position;   // samples of the ramp already processed
+    };
+
+    static float InfatuationParams::* getRampedField(int parameter);
+    void startRamp(int parameter, float start, float target, int length);
+    void startExponentialRamp(int parameter, float start, float target);
+    void updateSmoothing();
+    void fillRamps(int numSamples);
+    void applyRamps(int i);
+    void advanceRamps(int numSamples);
+
+    enum ScratchChannel
+    {
+        wetLeftScratch,
+        wetRightScratch,
+        noiseScratch,
+        readHeadLeftScratch,
+        readHeadRightScratch,
+        feedbackScratch,
+        rampScratch,
+        numScratchChannels = rampScratch + numRampedParameters
+    };
+
+    float* getScratch(ScratchChannel channel);
+
+    InfatuationParams mParameters;
+    double mSampleRate;
+    bool mHasProcessed;
+    bool mIsDelayLineClear;
+
+    double mLFOPhase;
+
+    float mFeedbackLeft;
+    float mFeedbackRight;
+
+    float mDelayTimeInSamples;
+    float mDelayTimeSmoothed;
+
+    int mLFOControlCounter;
+    float mLFOControlDelayLeft;
+    float mLFOControlDelayRight;
+    float mLFOControlStepLeft;
+    float mLFOControlStepRight;
+
+    // mParameters holds where each ramp has got to, and the ramp values for
+    // the segment being processed are in scratch, null for the still ones
+    ParameterRamp mRamps[numRampedParameters];
+    const float* mRampValues[numRampedParameters];
+    bool mIsRamping;
+
+    int mSmoothingShape;
+    double mSmoothingTime;
+    int mSmoothingLength;
+    double mSmoothingCoefficient;
+
+    // coefficient^(i + 1), the powers within one SMOOTHING_PERIOD
+    float mSmoothingPowers[SMOOTHING_PERIOD];
+
+    int mQuality;
+    int mPreviousQuality;
+    int mQualityCrossfadeLength;
+    int mQualityCrossfadeRemaining;
+
+    int mCircularBufferLength;
+    int mCircularBufferWriteHead;
+    float* mCircularBufferLeft;
+    float* mCircularBufferRight;
+    DSPBuffer mDelayMemory;
+
+    const InfatuationKernels::KernelTable* mKernels;
+    DSPBuffer mScratchMemory;
+    int mScratchLength;
+
+    uint64_t mRandomState;
+    int64_t mRandomSeed;
+
+    InfatuationEngine(const InfatuationEngine&) = delete;
+    InfatuationEngine& operator=(const InfatuationEngine&) = delete;
+};
@@ -0,0 +1,241 @@
+/*
+  ==============================================================================
+
+    MappedFile.cpp
+
+  ==============================================================================
+*/
+
+#include "MappedFile.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+
+#if defined (_WIN32)
+ #include <windows.h>
+#else
+ #include <fcntl.h>
+ #include <sys/mman.h>
+ #include <sys/stat.h>
+ #include <unistd.h>
+#endif
+
+#if ! defined (_WIN32)
+// Gives the file numBytes of real disk blocks, not a hole, so a full disk
+// fails here instead of raising SIGBUS when the mapping is written.
+static bool allocateFile (int file, size_t numBytes)
+{
+   #if defined (__APPLE__)
+    fstore_t store = { F_ALLOCATECONTIG | F_ALLOCATEALL, F_PEOFPOSMODE, 0, (off_t) numBytes, 0 };
+
+    if (fcntl (file, F_PREALLOCATE, &store) != 0)
+    {
+        store.fst_flags = F_ALLOCATEALL;
+
+        if (fcntl (file, F_PREALLOCATE, &store) != 0)
+            return false;
+    }
+
+    return ftruncate (file, (off_t) numBytes) == 0;
+   #else
+    int result;
+
+    do
+    {
+        result = posix_fallocate (file, 0, (off_t) numBytes);
+    }
+    while (result == EINTR);
+
+    return result == 0;
+   #endif
+}
+
+// Flushes the directory holding path, so a file just renamed into it keeps
+// its new name after a crash.
+static bool syncDirectory (const std::string& path)
+{
+    size_t separator = path.find_last_of ('/');
+    std::string directory = (separator == std::string::npos) ? "." : (separator == 0 ? "/" : path.substr (0, separator));
+
+    int file = ::open (directory.c_str(), O_RDONLY);
+
+    if (file < 0)
+        return false;
+
+    bool wasSynced = fsync (file) == 0;
+    ::close (file);
+    return wasSynced;
+}
+#endif
+
+//==============================================================================
+MappedFile::MappedFile()
+{
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool MappedFile::create (const char* path, size_t numBytes)
+{
+    close();
+
+    if (path == nullptr || numBytes == 0)
+        return false;
+
+    mPath = path;
+    mTemporaryPath = mPath + ".tmp";
+
+   #if defined (_WIN32)
+    mFile = CreateFileA (mTemporaryPath.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+    if (mFile == INVALID_HANDLE_VALUE)
+    {
+        mFile = nullptr;
+        return false;
+    }
+
+    mMapping = CreateFileMappingA (mFile, nullptr, PAGE_READWRITE, (DWORD) ((uint64_t) numBytes >> 32), (DWORD) numBytes, nullptr);
+    mData = (mMapping != nullptr) ? MapViewOfFile (mMapping, FILE_MAP_WRITE, 0, 0, numBytes) : nullptr;
+   #else
+    mFile = ::open (mTemporaryPath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+    if (mFile < 0)
+        return false;
+
+    if (allocateFile (mFile, numBytes))
+    {
+        void* address = mmap (nullptr, numBytes, PROT_READ | PROT_WRITE, MAP_SHARED, mFile, 0);
+        mData = (address != MAP_FAILED) ? address : nullptr;
+    }
+   #endif
+
+    mSize = numBytes;
+    mIsWritable = true;
+
+    if (mData == nullptr)
+    {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+bool MappedFile::commit()
+{
+    if (mData == nullptr || ! mIsWritable)
+        return false;
+
+   #if defined (_WIN32)
+    bool wasFlushed = FlushViewOfFile (mData, mSize) != 0 && FlushFileBuffers (mFile) != 0;
+   #else
+    bool wasFlushed = msync (mData, mSize, MS_SYNC) == 0;
+   #endif
+
+    // close() would throw the temporary file away, so let go of it first
+    std::string path = mPath, temporaryPath = mTemporaryPath;
+    mTemporaryPath.clear();
+    close();
+
+    if (wasFlushed)
+    {
+       #if defined (_WIN32)
+        if (MoveFileExA (temporaryPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0)
+            return true;
+       #else
+        if (rename (temporaryPath.c_str(), path.c_str()) == 0)
+            return syncDirectory (path);
+       #endif
+    }
+
+    std::remove (temporaryPath.c_str());
+    return false;
+}
+
+bool MappedFile::open (const char* path)
+{
+    close();
+
+    if (path == nullptr)
+        return false;
+
+   #if defined (_WIN32)
+    mFile = CreateFileA (path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+    if (mFile == INVALID_HANDLE_VALUE)
+    {
+        mFile = nullptr;
+        return false;
+    }
+
+    LARGE_INTEGER size;
+
+    if (GetFileSizeEx (mFile, &size) && size.QuadPart > 0)
+    {
+        mSize = (size_t) size.QuadPart;
+        mMapping = CreateFileMappingA (mFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        mData = (mMapping != nullptr) ? MapViewOfFile (mMapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    }
+   #else
+    mFile = ::open (path, O_RDONLY);
+
+    if (mFile < 0)
+        return false;
+
+    struct stat status;
+
+    if (fstat (mFile, &status) == 0 && status.st_size > 0)
+    {
+        mSize = (size_t) status.st_size;
+        void* address = mmap (nullptr, mSize, PROT_READ, MAP_PRIVATE, mFile, 0);
+        mData = (address != MAP_FAILED) ? address : nullptr;
+    }
+   #endif
+
+    if (mData == nullptr)
+    {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void MappedFile::close()
+{
+   #if defined (_WIN32)
+    if (mData != nullptr)
+        UnmapViewOfFile (mData);
+
+    if (mMapping != nullptr)
+        CloseHandle (mMapping);
+
+    if (mFile != nullptr)
+        CloseHandle (mFile);
+
+    mMapping = nullptr;
+    mFile = nullptr;
+   #else
+    if (mData != nullptr)
+        munmap (mData, mSize);
+
+    if (mFile >= 0)
+        ::close (mFile);
+
+    mFile = -1;
+   #endif
+
+    // a file that was never committed is thrown away
+    if (! mTemporaryPath.empty())
+        std::remove (mTemporaryPath.c_str());
+
+    mData = nullptr;
+    mSize = 0;
+    mIsWritable = false;
+    mPath.clear();
+    mTemporaryPath.clear();
+}
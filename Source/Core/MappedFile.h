@@ -0,0 +1,63 @@
+/*
+  ==============================================================================
+
+    MappedFile.h
+
+    A file mapped into memory, for engine checkpoints. Writing goes to a
+    temporary file next to the real one that only takes its place once it
+    has been flushed to disk, so a crash or preemption half way through a
+    save leaves the previous checkpoint as it was.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+//==============================================================================
+/**
+*/
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+    // Maps a new numBytes file for writing, to be moved to path by commit().
+    // Any previous mapping is closed first, and an uncommitted one discarded.
+    // The disk space is allocated here, so this returns false if it runs out.
+    bool create (const char* path, size_t numBytes);
+
+    // Flushes the writes to disk, unmaps the file and moves it to the path
+    // given to create(), replacing whatever was there, then flushes the
+    // directory so the move itself survives a crash.
+    bool commit();
+
+    // Maps an existing file read-only.
+    bool open (const char* path);
+
+    void close();
+
+    void* getData() const noexcept      { return mData; }
+    size_t getSize() const noexcept     { return mSize; }
+
+private:
+    void* mData = nullptr;
+    size_t mSize = 0;
+    bool mIsWritable = false;
+
+    std::string mPath;
+    std::string mTemporaryPath;
+
+   #if defined (_WIN32)
+    void* mFile = nullptr;
+    void* mMapping = nullptr;
+   #else
+    int mFile = -1;
+   #endif
+
+    MappedFile (const MappedFile&) = delete;
+    MappedFile& operator= (const MappedFile&) = delete;
+};
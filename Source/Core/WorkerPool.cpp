@@ -0,0 +1,220 @@
+/*
+  ==============================================================================
+
+    WorkerPool.cpp
+
+  ==============================================================================
+*/
+
+#include "WorkerPool.h"
+#include "DSPPlatform.h"
+
+#include <algorithm>
+#include <chrono>
+
+#if defined (__APPLE__)
+ #include <dispatch/dispatch.h>
+ #include <pthread.h>
+#elif defined (_WIN32)
+ #include <windows.h>
+#else
+ #include <pthread.h>
+ #include <semaphore.h>
+#endif
+
+//==============================================================================
+struct WorkerPool::Semaphore
+{
+   #if defined (__APPLE__)
+    Semaphore()         { semaphore = dispatch_semaphore_create (0); }
+    ~Semaphore()        { dispatch_release (semaphore); }
+    void post()         { dispatch_semaphore_signal (semaphore); }
+    void wait()         { dispatch_semaphore_wait (semaphore, DISPATCH_TIME_FOREVER); }
+
+    dispatch_semaphore_t semaphore;
+   #elif defined (_WIN32)
+    Semaphore()         { semaphore = CreateSemaphore (nullptr, 0, 0x7fffffff, nullptr); }
+    ~Semaphore()        { CloseHandle (semaphore); }
+    void post()         { ReleaseSemaphore (semaphore, 1, nullptr); }
+    void wait()         { WaitForSingleObject (semaphore, INFINITE); }
+
+    HANDLE semaphore;
+   #else
+    Semaphore()         { sem_init (&semaphore, 0, 0); }
+    ~Semaphore()        { sem_destroy (&semaphore); }
+    void post()         { sem_post (&semaphore); }
+    void wait()         { while (sem_wait (&semaphore) != 0) {} }
+
+    sem_t semaphore;
+   #endif
+};
+
+static inline void pause() noexcept
+{
+   #if INFATUATION_INTEL
+    _mm_pause();
+   #else
+    std::this_thread::yield();
+   #endif
+}
+
+static bool setRealtimePriority (std::thread& thread)
+{
+   #if defined (_WIN32)
+    return SetThreadPriority (thread.native_handle(), THREAD_PRIORITY_TIME_CRITICAL) != 0;
+   #else
+    sched_param parameters {};
+    parameters.sched_priority = WORKER_REALTIME_PRIORITY;
+
+    // needs RLIMIT_RTPRIO or CAP_SYS_NICE on Linux, hosts usually grant one of them
+    return pthread_setschedparam (thread.native_handle(), SCHED_FIFO, &parameters) == 0;
+   #endif
+}
+
+//==============================================================================
+WorkerPool::WorkerPool()
+{
+}
+
+WorkerPool::~WorkerPool()
+{
+    stop();
+}
+
+void WorkerPool::start (int numWorkers)
+{
+    stop();
+
+    // a worker without a core of its own only gets in the caller's way
+    int numCores = (int) std::thread::hardware_concurrency();
+
+    if (numCores > 0)
+        numWorkers = std::min (numWorkers, numCores - 1);
+
+    if (numWorkers <= 0)
+        return;
+
+    mWakeUp = new Semaphore();
+    mShouldExit = false;
+    mHasRealtimePriority = true;
+
+    for (int i = 0; i < numWorkers; ++i)
+    {
+        mThreads.emplace_back ([this] { workerLoop(); });
+
+        if (! setRealtimePriority (mThreads.back()))
+            mHasRealtimePriority = false;
+    }
+}
+
+void WorkerPool::stop()
+{
+    if (mThreads.empty())
+        return;
+
+    mShouldExit = true;
+
+    for (size_t i = 0; i < mThreads.size(); ++i)
+        mWakeUp->post();
+
+    for (auto& thread : mThreads)
+        thread.join();
+
+    mThreads.clear();
+    mHasRealtimePriority = false;
+
+    delete mWakeUp;
+    mWakeUp = nullptr;
+}
+
+void WorkerPool::run (Task task, void* context, int numTasks) noexcept
+{
+    if (numTasks <= 0)
+        return;
+
+    mNumBlocks.fetch_add (1, std::memory_order_relaxed);
+
+    if (mThreads.empty())
+    {
+        for (int i = 0; i < numTasks; ++i)
+            task (context, i);
+
+        mNumInlineBlocks.fetch_add (1, std::memory_order_relaxed);
+        return;
+    }
+
+    // every task of the last block has finished, so nobody is reading these
+    mTask = task;
+    mContext = context;
+    mNumTasksDone.store (0, std::memory_order_relaxed);
+    mNumTasksByWorkers.store (0, std::memory_order_relaxed);
+
+    ++mGeneration;
+    mNextTask.store (((uint64_t) mGeneration << 32) | (uint32_t) numTasks);
+
+    // pairs with the sleeper's increment then re-check in workerLoop, so at
+    // worst a worker gets an extra wake-up, never a missed one
+    int numSleeping = mNumSleeping.load();
+
+    for (int i = 0; i < numSleeping; ++i)
+        mWakeUp->post();
+
+    while (runNextTask (false)) {}
+
+    while (mNumTasksDone.load (std::memory_order_acquire) < numTasks)
+        pause();
+
+    if (mNumTasksByWorkers.load (std::memory_order_relaxed) == 0)
+        mNumInlineBlocks.fetch_add (1, std::memory_order_relaxed);
+}
+
+bool WorkerPool::runNextTask (bool isWorker) noexcept
+{
+    uint64_t next = mNextTask.load (std::memory_order_acquire);
+
+    while ((uint32_t) next != 0)
+    {
+        // handed out from the top down, so the count doubles as the index
+        if (mNextTask.compare_exchange_weak (next, next - 1, std::memory_order_acq_rel, std::memory_order_acquire))
+        {
+            mTask (mContext, (int) (uint32_t) next - 1);
+
+            if (isWorker)
+                mNumTasksByWorkers.fetch_add (1, std::memory_order_relaxed);
+
+            mNumTasksDone.fetch_add (1, std::memory_order_release);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void WorkerPool::workerLoop()
+{
+    auto spinStart = std::chrono::steady_clock::now();
+    auto spinTime = std::chrono::duration<double> (WORKER_SPIN_TIME);
+
+    while (! mShouldExit.load (std::memory_order_relaxed))
+    {
+        if (runNextTask (true))
+        {
+            spinStart = std::chrono::steady_clock::now();
+            continue;
+        }
+
+        if (std::chrono::steady_clock::now() - spinStart < spinTime)
+        {
+            pause();
+            continue;
+        }
+
+        mNumSleeping.fetch_add (1);
+
+        if ((uint32_t) mNextTask.load() == 0 && ! mShouldExit.load())
+            mWakeUp->wait();
+
+        mNumSleeping.fetch_sub (1);
+        spinStart = std::chrono::steady_clock::now();
+    }
+}
@@ -0,0 +1,90 @@
+/*
+  ==============================================================================
+
+    WorkerPool.h
+
+    A few real-time threads that help the audio thread through a block made
+    of independent tasks, such as the channel pairs of a large bus. run()
+    forks the tasks and returns once they are all done, without taking a
+    lock: tasks are handed out from one atomic counter that the calling
+    thread draws from as well.
+
+    That makes it deadline-aware by construction. Workers that wake late
+    just find fewer tasks left, and if none wake before the caller gets to
+    the last task the block runs entirely inline. The caller only ever
+    waits for a task a worker has already started.
+
+    Idle workers spin for a short while after each block, then sleep on a
+    semaphore that run() only posts to when someone is actually asleep.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#define WORKER_SPIN_TIME 0.0002
+#define WORKER_REALTIME_PRIORITY 70
+
+//==============================================================================
+/**
+*/
+class WorkerPool
+{
+public:
+    using Task = void (*) (void* context, int taskIndex);
+
+    WorkerPool();
+    ~WorkerPool();
+
+    // Starts numWorkers threads, at most one fewer than there are cores, at
+    // real-time priority where the OS lets us. Stops any running ones first.
+    // Not for the audio thread.
+    void start (int numWorkers);
+    void stop();
+
+    int getNumWorkers() const noexcept          { return (int) mThreads.size(); }
+    bool hasRealtimePriority() const noexcept   { return mHasRealtimePriority; }
+
+    // Calls task (context, i) once for each i below numTasks, spread over the
+    // workers and the calling thread, and returns when all of them are done.
+    // One caller at a time.
+    void run (Task task, void* context, int numTasks) noexcept;
+
+    // Blocks in which no worker got to a task before the caller had taken the
+    // last one, so everything ran on the calling thread.
+    uint64_t getNumInlineBlocks() const noexcept  { return mNumInlineBlocks.load (std::memory_order_relaxed); }
+    uint64_t getNumBlocks() const noexcept        { return mNumBlocks.load (std::memory_order_relaxed); }
+
+private:
+    struct Semaphore;
+
+    void workerLoop();
+    bool runNextTask (bool isWorker) noexcept;
+
+    std::vector<std::thread> mThreads;
+    Semaphore* mWakeUp = nullptr;
+    bool mHasRealtimePriority = false;
+
+    // generation in the top half, tasks left to hand out in the bottom half,
+    // so a worker still on the previous block can't claim a task from this one
+    std::atomic<uint64_t> mNextTask { 0 };
+    std::atomic<int> mNumTasksDone { 0 };
+    std::atomic<int> mNumTasksByWorkers { 0 };
+    std::atomic<int> mNumSleeping { 0 };
+    std::atomic<bool> mShouldExit { false };
+
+    Task mTask = nullptr;
+    void* mContext = nullptr;
+    uint32_t mGeneration = 0;
+
+    std::atomic<uint64_t> mNumBlocks { 0 };
+    std::atomic<uint64_t> mNumInlineBlocks { 0 };
+
+    WorkerPool (const WorkerPool&) = delete;
+    WorkerPool& operator= (const WorkerPool&) = delete;
+};
@@ -0,0 +1,242 @@
+/*
+  ==============================================================================
+
+    FlightRecorder.cpp
+
+  ==============================================================================
+*/
+
+#include "FlightRecorder.h"
+
+static_assert ((FLIGHT_RECORDER_SIZE & (FLIGHT_RECORDER_SIZE - 1)) == 0, "FLIGHT_RECORDER_SIZE must be a power of two");
+
+//==============================================================================
+// One thread for every instance in the process, polling for dump requests so
+// the audio thread never has to signal anything.
+class FlightRecorder::DumpThread  : public juce::Thread
+{
+public:
+    DumpThread() : juce::Thread ("Infatuation flight recorder")
+    {
+        startThread();
+    }
+
+    ~DumpThread() override
+    {
+        stopThread (1000);
+    }
+
+    void addRecorder (FlightRecorder* recorder)
+    {
+        const juce::ScopedLock sl (mLock);
+        mRecorders.add (recorder);
+    }
+
+    void removeRecorder (FlightRecorder* recorder)
+    {
+        const juce::ScopedLock sl (mLock);
+        mRecorders.removeFirstMatchingValue (recorder);
+    }
+
+    void run() override
+    {
+        while (! threadShouldExit())
+        {
+            wait (100);
+
+            const juce::ScopedLock sl (mLock);
+
+            for (auto* recorder : mRecorders)
+                recorder->dumpIfRequested();
+        }
+    }
+
+private:
+    juce::CriticalSection mLock;
+    juce::Array<FlightRecorder*> mRecorders;
+};
+
+//==============================================================================
+FlightRecorder::FlightRecorder()
+{
+    mDumpDirectory = juce::File::getSpecialLocation (juce::File::tempDirectory);
+    mDumpThread->addRecorder (this);
+}
+
+FlightRecorder::~FlightRecorder()
+{
+    mDumpThread->removeRecorder (this);
+}
+
+void FlightRecorder::prepare()
+{
+    if (mIsPrepared)
+        return;
+
+    // write the whole ring once so its pages aren't first touched on the audio thread
+    juce::zeromem (mEvents, sizeof (mEvents));
+    mIsPrepared = true;
+}
+
+void FlightRecorder::record (juce::int64 ticks, EventType type, int intValue, float floatValue) noexcept
+{
+    auto index = mNumEventsWritten.load (std::memory_order_relaxed);
+    auto& event = mEvents[index & (FLIGHT_RECORDER_SIZE - 1)];
+
+    event.ticks = ticks;
+    event.type = type;
+    event.intValue = intValue;
+    event.floatValue = floatValue;
+
+    mNumEventsWritten.store (index + 1, std::memory_order_release);
+}
+
+void FlightRecorder::recordBlockStart (juce::int64 ticks, int numSamples) noexcept
+{
+    record (ticks, blockStartEvent, numSamples, 0);
+}
+
+void FlightRecorder::recordBlockEnd (juce::int64 ticks, int numSamples, float load) noexcept
+{
+    record (ticks, blockEndEvent, numSamples, load);
+}
+
+void FlightRecorder::recordEffectType (juce::int64 ticks, int typeID) noexcept
+{
+    record (ticks, effectTypeEvent, typeID, 0);
+}
+
+void FlightRecorder::recordWaveType (juce::int64 ticks, int waveTypeID) noexcept
+{
+    record (ticks, waveTypeEvent, waveTypeID, 0);
+}
+
+void FlightRecorder::recordParameter (juce::int64 ticks, int parameterIndex, float normalisedValue) noexcept
+{
+    record (ticks, parameterEvent, parameterIndex, normalisedValue);
+}
+
+void FlightRecorder::recordOverrun (juce::int64 ticks, float load) noexcept
+{
+    record (ticks, overrunEvent, 0, load);
+
+    auto interval = (juce::int64) (FLIGHT_RECORDER_DUMP_INTERVAL * juce::Time::getHighResolutionTicksPerSecond());
+
+    if (ticks - mLastAutomaticDumpTicks > interval)
+    {
+        mLastAutomaticDumpTicks = ticks;
+        requestDump();
+    }
+}
+
+void FlightRecorder::requestDump() noexcept
+{
+    mDumpRequested = true;
+}
+
+void FlightRecorder::setDumpDirectory (const juce::File& directory)
+{
+    const juce::ScopedLock sl (mDumpDirectoryLock);
+    mDumpDirectory = directory;
+}
+
+//==============================================================================
+std::vector<FlightRecorder::Event> FlightRecorder::getEvents() const
+{
+    auto end = mNumEventsWritten.load (std::memory_order_acquire);
+    auto start = end > FLIGHT_RECORDER_SIZE ? end - FLIGHT_RECORDER_SIZE : 0;
+
+    std::vector<Event> events;
+    events.reserve ((size_t) (end - start));
+
+    for (auto i = start; i < end; ++i)
+        events.push_back (mEvents[i & (FLIGHT_RECORDER_SIZE - 1)]);
+
+    // Anything the audio thread lapped while we were copying, including the
+    // slot it may be halfway through writing, can't be trusted
+    auto endAfterCopy = mNumEventsWritten.load (std::memory_order_acquire);
+    auto firstValid = endAfterCopy + 1 > FLIGHT_RECORDER_SIZE ? endAfterCopy + 1 - FLIGHT_RECORDER_SIZE : 0;
+
+    if (firstValid > start)
+        events.erase (events.begin(), events.begin() + (std::ptrdiff_t) juce::jmin (firstValid - start, (juce::uint64) events.size()));
+
+    return events;
+}
+
+juce::String FlightRecorder::createChromeTraceJSON() const
+{
+    juce::String json ("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    bool isFirst = true;
+
+    for (auto& event : getEvents())
+    {
+        auto timestamp = juce::String (juce::Time::highResolutionTicksToSeconds (event.ticks) * 1.0e6, 3);
+        juce::String line;
+
+        switch (event.type)
+        {
+            case blockStartEvent:
+                line << "{\"name\":\"processBlock\",\"ph\":\"B\",\"ts\":" << timestamp
+                     << ",\"pid\":1,\"tid\":1,\"args\":{\"numSamples\":" << event.intValue << "}}";
+                break;
+
+            case blockEndEvent:
+                line << "{\"name\":\"processBlock\",\"ph\":\"E\",\"ts\":" << timestamp
+                     << ",\"pid\":1,\"tid\":1,\"args\":{\"load\":" << event.floatValue << "}}";
+                break;
+
+            case effectTypeEvent:
+                line << "{\"name\":\"effect type " << event.intValue << "\",\"ph\":\"i\",\"s\":\"t\",\"ts\":" << timestamp
+                     << ",\"pid\":1,\"tid\":1}";
+                break;
+
+            case waveTypeEvent:
+                line << "{\"name\":\"wave type " << event.intValue << "\",\"ph\":\"i\",\"s\":\"t\",\"ts\":" << timestamp
+                     << ",\"pid\":1,\"tid\":1}";
+                break;
+
+            case parameterEvent:
+                line << "{\"name\":\"parameter " << event.intValue << "\",\"ph\":\"C\",\"ts\":" << timestamp
+                     << ",\"pid\":1,\"args\":{\"value\":" << event.floatValue << "}}";
+                break;
+
+            case overrunEvent:
+                line << "{\"name\":\"overrun\",\"ph\":\"i\",\"s\":\"g\",\"ts\":" << timestamp
+                     << ",\"pid\":1,\"tid\":1,\"args\":{\"load\":" << event.floatValue << "}}";
+                break;
+
+            default:
+                continue;
+        }
+
+        if (! isFirst)
+            json << ",\n";
+
+        json << line;
+        isFirst = false;
+    }
+
+    json << "\n]}\n";
+    return json;
+}
+
+void FlightRecorder::dumpIfRequested()
+{
+    if (! mDumpRequested.exchange (false))
+        return;
+
+    juce::File directory;
+
+    {
+        const juce::ScopedLock sl (mDumpDirectoryLock);
+        directory = mDumpDirectory;
+    }
+
+    auto fileName = "Infatuation-" + juce::Time::getCurrentTime().formatted ("%Y%m%d-%H%M%S")
+                      + "-" + juce::String::toHexString ((juce::pointer_sized_int) this) + ".json";
+
+    auto file = directory.getChildFile (fileName);
+
+    if (! file.replaceWithText (createChromeTraceJSON()))
+        DBG ("Couldn't write flight recorder dump to " << file.getFullPathName());
+}
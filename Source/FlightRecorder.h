@@ -0,0 +1,94 @@
+/*
+  ==============================================================================
+
+    FlightRecorder.h
+
+    A fixed-size, lock-free ring of small events written by processBlock, so
+    that when an instance glitches we can see what it was doing just before.
+    The ring is dumped as Chrome trace JSON (which Perfetto's UI also opens)
+    from a shared background thread, either on request or automatically
+    after a block overruns its real-time budget.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#define FLIGHT_RECORDER_SIZE 4096
+#define FLIGHT_RECORDER_DUMP_INTERVAL 10.0
+
+//==============================================================================
+/**
+*/
+class FlightRecorder
+{
+public:
+    enum EventType
+    {
+        blockStartEvent,
+        blockEndEvent,
+        effectTypeEvent,
+        waveTypeEvent,
+        parameterEvent,
+        overrunEvent
+    };
+
+    struct Event
+    {
+        juce::int64 ticks;
+        juce::int32 type;
+        juce::int32 intValue;   // numSamples, the new type or the parameter index
+        float floatValue;       // block load or the new normalised parameter value
+    };
+
+    FlightRecorder();
+    ~FlightRecorder();
+
+    // Faults in the ring's pages, the first time it's called, so instances
+    // that are never played don't pay for them. Not for the audio thread.
+    void prepare();
+
+    // Audio thread only. Each of these is a handful of stores.
+    void recordBlockStart (juce::int64 ticks, int numSamples) noexcept;
+    void recordBlockEnd (juce::int64 ticks, int numSamples, float load) noexcept;
+    void recordEffectType (juce::int64 ticks, int typeID) noexcept;
+    void recordWaveType (juce::int64 ticks, int waveTypeID) noexcept;
+    void recordParameter (juce::int64 ticks, int parameterIndex, float normalisedValue) noexcept;
+
+    // Also asks for a dump, at most once every FLIGHT_RECORDER_DUMP_INTERVAL seconds.
+    void recordOverrun (juce::int64 ticks, float load) noexcept;
+
+    // Safe from any thread: the dump itself happens on the background thread.
+    void requestDump() noexcept;
+
+    // Where the dumps go, the temp directory by default. Not for the audio thread.
+    void setDumpDirectory (const juce::File& directory);
+
+    // Snapshot of the ring, oldest first. Not for the audio thread.
+    std::vector<Event> getEvents() const;
+    juce::String createChromeTraceJSON() const;
+
+private:
+    class DumpThread;
+    friend class DumpThread;
+
+    void record (juce::int64 ticks, EventType type, int intValue, float floatValue) noexcept;
+    void dumpIfRequested();
+
+    Event mEvents[FLIGHT_RECORDER_SIZE];
+    std::atomic<juce::uint64> mNumEventsWritten { 0 };
+
+    bool mIsPrepared = false;
+
+    std::atomic<bool> mDumpRequested { false };
+    juce::int64 mLastAutomaticDumpTicks = 0;
+
+    juce::File mDumpDirectory;
+    juce::CriticalSection mDumpDirectoryLock;
+
+    juce::SharedResourcePointer<DumpThread> mDumpThread;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FlightRecorder)
+};
@@ -0,0 +1,485 @@
+/*
+  ==============================================================================
+
+    OfflineRenderer.cpp
+
+  ==============================================================================
+*/
+
+#include "OfflineRenderer.h"
+
+#include <algorithm>
+#include <limits>
+
+struct OfflineRenderer::Chunk
+{
+    juce::int64 start;
+    juce::int64 end;
+    juce::int64 preRollLength;
+
+    // the last samples of the pre-roll, to check against the previous chunk
+    juce::AudioBuffer<float> preRollTail;
+};
+
+struct OfflineRenderer::AutomationLane
+{
+    int parameterIndex;
+    bool isStepped;
+
+    // in time order, with normalised values
+    juce::Array<juce::int64> times;
+    juce::Array<float> values;
+
+    void add (juce::int64 time, float value)
+    {
+        // after any breakpoints at the same time, so two in a row make a jump
+        auto index = (int) (std::upper_bound (times.begin(), times.end(), time) - times.begin());
+
+        times.insert (index, time);
+        values.insert (index, value);
+    }
+
+    float getValueAt (juce::int64 sample) const
+    {
+        auto next = (int) (std::upper_bound (times.begin(), times.end(), sample) - times.begin());
+
+        if (next == 0)
+            return values.getFirst();
+
+        if (next == times.size() || isStepped)
+            return values[next - 1];
+
+        double fraction = (double) (sample - times[next - 1]) / (double) (times[next] - times[next - 1]);
+        return values[next - 1] + (float) fraction * (values[next] - values[next - 1]);
+    }
+
+    // The first sample after position where the lane stops following one
+    // straight line from the sample before position. A continuous lane turns
+    // the sample after a breakpoint, or at it for a jump; a stepped one changes
+    // at the breakpoint itself.
+    juce::int64 getNextSplit (juce::int64 position) const
+    {
+        juce::int64 next = std::numeric_limits<juce::int64>::max();
+
+        if (isStepped)
+        {
+            auto index = (int) (std::upper_bound (times.begin(), times.end(), position) - times.begin());
+            return (index < times.size()) ? times[index] : next;
+        }
+
+        // breakpoints before position split at or before it, and those more
+        // than a sample after the first one left can't split any earlier
+        auto first = (int) (std::lower_bound (times.begin(), times.end(), position) - times.begin());
+
+        for (int i = first; i < times.size() && times[i] <= times[first] + 1; ++i)
+        {
+            bool isJump = i > 0 && times[i - 1] == times[i];
+            juce::int64 split = isJump ? times[i] : times[i] + 1;
+
+            if (split > position)
+                next = juce::jmin (next, split);
+        }
+
+        return next;
+    }
+};
+
+//==============================================================================
+OfflineRenderer::OfflineRenderer (double sampleRate, int samplesPerBlock)
+    : mSampleRate (sampleRate), mSamplesPerBlock (samplesPerBlock)
+{
+    mRandomSeed = DEFAULT_RANDOM_SEED;
+    mErrorBound = 1.0e-4f;
+
+    mMeasuredError = 0;
+    mNumChunksUsed = 0;
+}
+
+OfflineRenderer::~OfflineRenderer()
+{
+}
+
+void OfflineRenderer::setState (const juce::MemoryBlock& state)
+{
+    mState = state;
+}
+
+void OfflineRenderer::setRandomSeed (juce::int64 newSeed)
+{
+    mRandomSeed = newSeed;
+}
+
+void OfflineRenderer::setErrorBound (float newErrorBound)
+{
+    mErrorBound = newErrorBound;
+}
+
+juce::Result OfflineRenderer::setAutomation (const juce::String& curves)
+{
+    clearAutomation();
+
+    // only for their IDs and ranges, which are the same for every instance
+    auto parameters = InfatuationAudioProcessor::createParameters();
+
+    juce::Result result = juce::Result::ok();
+
+    if (curves.trimStart().startsWithChar ('{'))
+    {
+        juce::var parsed;
+        result = juce::JSON::parse (curves, parsed);
+
+        if (result.wasOk() && parsed.getDynamicObject() == nullptr)
+            result = juce::Result::fail ("Expected an object with an array of [time, value] pairs for each parameter");
+
+        if (result.wasOk())
+        {
+            for (auto& lane : parsed.getDynamicObject()->getProperties())
+            {
+                if (! lane.value.isArray())
+                {
+                    result = juce::Result::fail (lane.name.toString() + ": expected an array of [time, value] pairs");
+                    break;
+                }
+
+                for (auto& breakpoint : *lane.value.getArray())
+                {
+                    if (! breakpoint.isArray() || breakpoint.size() != 2)
+                        result = juce::Result::fail (lane.name.toString() + ": expected an array of [time, value] pairs");
+                    else
+                        result = addBreakpoint (parameters, lane.name.toString(), breakpoint[0], breakpoint[1]);
+
+                    if (result.failed())
+                        break;
+                }
+
+                if (result.failed())
+                    break;
+            }
+        }
+    }
+    else
+    {
+        juce::StringArray lines;
+        lines.addLines (curves);
+
+        for (int i = 0; i < lines.size() && result.wasOk(); ++i)
+        {
+            juce::String line = lines[i].trim();
+
+            if (line.isEmpty() || line.startsWithChar ('#'))
+                continue;
+
+            auto fields = juce::StringArray::fromTokens (line, ",", "\"");
+            fields.trim();
+
+            if (fields.size() != 3)
+            {
+                result = juce::Result::fail ("Line " + juce::String (i + 1) + ": expected time,parameter,value");
+                break;
+            }
+
+            // a header line, or a time that isn't a number
+            if (! fields[0].containsOnly ("0123456789.+-eE"))
+            {
+                if (mAutomation.isEmpty())
+                    continue;
+
+                result = juce::Result::fail ("Line " + juce::String (i + 1) + ": bad time " + fields[0]);
+                break;
+            }
+
+            result = addBreakpoint (parameters, fields[1], fields[0].getDoubleValue(), fields[2].getDoubleValue());
+        }
+    }
+
+    if (result.failed())
+        clearAutomation();
+
+    return result;
+}
+
+void OfflineRenderer::clearAutomation()
+{
+    mAutomation.clear();
+}
+
+juce::Result OfflineRenderer::addBreakpoint (const Parameters& parameters, const juce::String& parameterID, double time, double value)
+{
+    for (int index = 0; index < (int) parameters.size(); ++index)
+    {
+        auto* parameter = parameters[(size_t) index].get();
+
+        if (parameter->paramID != parameterID)
+            continue;
+
+        AutomationLane* lane = nullptr;
+
+        for (auto* existing : mAutomation)
+            if (existing->parameterIndex == index)
+                lane = existing;
+
+        if (lane == nullptr)
+        {
+            lane = mAutomation.add (new AutomationLane());
+            lane->parameterIndex = index;
+            lane->isStepped = dynamic_cast<juce::AudioParameterInt*> (parameter) != nullptr;
+        }
+
+        auto sample = (juce::int64) std::llround (juce::jmax (0.0, time) * mSampleRate);
+        lane->add (sample, parameter->convertTo0to1 ((float) value));
+
+        return juce::Result::ok();
+    }
+
+    return juce::Result::fail ("No parameter called " + parameterID);
+}
+
+bool OfflineRenderer::isAutomated (int parameterIndex) const
+{
+    for (auto* lane : mAutomation)
+        if (lane->parameterIndex == parameterIndex)
+            return true;
+
+    return false;
+}
+
+juce::int64 OfflineRenderer::startAutomationSegment (InfatuationAudioProcessor& processor, juce::int64 position)
+{
+    // every lane follows a straight line from the sample before position up
+    // to the next split, so one ramp to the values just before it is exact
+    juce::int64 next = std::numeric_limits<juce::int64>::max();
+
+    for (auto* lane : mAutomation)
+        next = juce::jmin (next, lane->getNextSplit (position));
+
+    // ramp lengths are ints
+    next = juce::jmin (next, position + std::numeric_limits<int>::max());
+
+    auto& parameters = processor.getParameters();
+
+    for (auto* lane : mAutomation)
+    {
+        float value = lane->isStepped ? lane->getValueAt (position) : lane->getValueAt (next - 1);
+        parameters.getUnchecked (lane->parameterIndex)->setValueNotifyingHost (value);
+    }
+
+    processor.setParameterRamp ((int) (next - position));
+    return next;
+}
+
+float OfflineRenderer::getMeasuredError() const
+{
+    return mMeasuredError;
+}
+
+int OfflineRenderer::getNumChunksUsed() const
+{
+    return mNumChunksUsed;
+}
+
+//==============================================================================
+std::unique_ptr<InfatuationAudioProcessor> OfflineRenderer::createProcessor (juce::int64 position)
+{
+    // an offline processor doesn't open a stats segment or lock its memory
+    auto processor = std::make_unique<InfatuationAudioProcessor>();
+    processor->setNonRealtime (true);
+
+    if (mState.getSize() > 0)
+        processor->setStateInformation (mState.getData(), (int) mState.getSize());
+
+    // the first segment ramps from here, as if the sample before had been played
+    auto& parameters = processor->getParameters();
+
+    for (auto* lane : mAutomation)
+        parameters.getUnchecked (lane->parameterIndex)->setValueNotifyingHost (lane->getValueAt (position - 1));
+
+    processor->setRandomSeed (mRandomSeed);
+    processor->setPlayConfigDetails (2, 2, mSampleRate, mSamplesPerBlock);
+    processor->prepareToPlay (mSampleRate, mSamplesPerBlock);
+
+    return processor;
+}
+
+juce::Result OfflineRenderer::render (const juce::AudioBuffer<float>& input, juce::AudioBuffer<float>& output, int numThreads)
+{
+    if (input.getNumChannels() != 2)
+        return juce::Result::fail ("Infatuation renders stereo input only");
+
+    // AudioBuffer lengths are ints, so no render is longer than INT_MAX
+    // samples and every position fits the int offsets the copies take. The
+    // chunk arithmetic is 64-bit so that lengths near the limit can't
+    // overflow it.
+    juce::int64 numSamples = input.getNumSamples();
+    output.setSize (2, input.getNumSamples(), false, false, true);
+
+    if (numThreads <= 0)
+        numThreads = juce::SystemStats::getNumCpus();
+
+    // Everything older than the state memory has decayed below the error
+    // bound, the extra verify length is compared against the previous chunk
+    juce::int64 memory = getStateMemory();
+    juce::int64 verifyLength = juce::jmin (memory, (juce::int64) mSamplesPerBlock);
+    juce::int64 preRollLength = memory + verifyLength;
+
+    juce::int64 chunkLength = juce::jmax ((numSamples + numThreads - 1) / numThreads, preRollLength * 4);
+    int numChunks = (int) ((numSamples + chunkLength - 1) / chunkLength);
+
+    mMeasuredError = 0;
+
+    // the LFO phase at the start of a chunk assumes a steady rate and type
+    bool canSplit = ! isAutomated (InfatuationAudioProcessor::rateIndex) && ! isAutomated (InfatuationAudioProcessor::typeIDIndex);
+
+    if (numChunks <= 1 || ! canSplit)
+    {
+        renderSerially (input, output);
+        return juce::Result::ok();
+    }
+
+    juce::OwnedArray<Chunk> chunks;
+
+    for (int c = 0; c < numChunks; ++c)
+    {
+        auto* chunk = chunks.add (new Chunk());
+        chunk->start = c * chunkLength;
+        chunk->end = juce::jmin (chunk->start + chunkLength, numSamples);
+        chunk->preRollLength = (c == 0) ? 0 : preRollLength;
+        chunk->preRollTail.setSize (2, (int) verifyLength);
+    }
+
+    juce::WaitableEvent finished;
+    std::atomic<int> numChunksLeft (numChunks);
+
+    {
+        juce::ThreadPool pool (juce::jmin (numThreads, numChunks));
+
+        for (auto* chunk : chunks)
+        {
+            pool.addJob ([this, chunk, &input, &output, &numChunksLeft, &finished]
+            {
+                renderChunk (*chunk, input, output);
+
+                if (--numChunksLeft == 0)
+                    finished.signal();
+            });
+        }
+
+        finished.wait();
+    }
+
+    // The end of each pre-roll overlaps the end of the chunk before it, so the
+    // difference there is the error left at the join
+    for (int c = 1; c < numChunks; ++c)
+    {
+        auto* chunk = chunks[c];
+        int overlapStart = (int) (chunk->start - verifyLength);
+
+        for (int channel = 0; channel < 2; ++channel)
+        {
+            const float* expected = output.getReadPointer (channel, overlapStart);
+            const float* actual = chunk->preRollTail.getReadPointer (channel);
+
+            for (int i = 0; i < (int) verifyLength; ++i)
+                mMeasuredError = juce::jmax (mMeasuredError, std::abs (actual[i] - expected[i]));
+        }
+    }
+
+    if (mMeasuredError > mErrorBound)
+    {
+        mMeasuredError = 0;
+        renderSerially (input, output);
+        return juce::Result::ok();
+    }
+
+    mNumChunksUsed = numChunks;
+    return juce::Result::ok();
+}
+
+juce::int64 OfflineRenderer::getStateMemory()
+{
+    auto processor = createProcessor();
+    juce::int64 memory = processor->getStateMemoryInSamples (mErrorBound);
+
+    // more feedback or a longer delay only ever lengthens the memory, so the
+    // highest value each lane reaches gives the longest it can get
+    auto& parameters = processor->getParameters();
+
+    for (auto* lane : mAutomation)
+    {
+        float highest = 0;
+
+        for (auto value : lane->values)
+            highest = juce::jmax (highest, value);
+
+        parameters.getUnchecked (lane->parameterIndex)->setValueNotifyingHost (highest);
+    }
+
+    if (! mAutomation.isEmpty())
+        memory = juce::jmax (memory, processor->getStateMemoryInSamples (mErrorBound));
+
+    return memory;
+}
+
+void OfflineRenderer::renderChunk (Chunk& chunk, const juce::AudioBuffer<float>& input, juce::AudioBuffer<float>& output)
+{
+    juce::int64 position = chunk.start - chunk.preRollLength;
+    juce::int64 tailStart = chunk.start - chunk.preRollTail.getNumSamples();
+
+    auto processor = createProcessor (position);
+    processor->setRenderPosition (position);
+
+    juce::AudioBuffer<float> block (2, mSamplesPerBlock);
+    juce::MidiBuffer midi;
+
+    juce::int64 segmentEnd = mAutomation.isEmpty() ? std::numeric_limits<juce::int64>::max() : position;
+
+    while (position < chunk.end)
+    {
+        if (position == segmentEnd)
+            segmentEnd = startAutomationSegment (*processor, position);
+
+        juce::int64 blockEnd = juce::jmin (position + mSamplesPerBlock, chunk.end, segmentEnd);
+
+        // don't let a block straddle the end of the pre-roll
+        if (position < chunk.start)
+            blockEnd = juce::jmin (blockEnd, chunk.start);
+
+        int numSamples = (int) (blockEnd - position);
+        block.setSize (2, numSamples, false, false, true);
+
+        for (int channel = 0; channel < 2; ++channel)
+            block.copyFrom (channel, 0, input, channel, (int) position, numSamples);
+
+        processor->processBlock (block, midi);
+
+        for (int channel = 0; channel < 2; ++channel)
+        {
+            if (position >= chunk.start)
+            {
+                output.copyFrom (channel, (int) position, block, channel, 0, numSamples);
+            }
+            else
+            {
+                for (int i = 0; i < numSamples; ++i)
+                {
+                    juce::int64 tailIndex = position + i - tailStart;
+
+                    if (tailIndex >= 0)
+                        chunk.preRollTail.setSample (channel, (int) tailIndex, block.getSample (channel, i));
+                }
+            }
+        }
+
+        position = blockEnd;
+    }
+}
+
+void OfflineRenderer::renderSerially (const juce::AudioBuffer<float>& input, juce::AudioBuffer<float>& output)
+{
+    Chunk whole;
+    whole.start = 0;
+    whole.end = input.getNumSamples();
+    whole.preRollLength = 0;
+
+    renderChunk (whole, input, output);
+    mNumChunksUsed = 1;
+}
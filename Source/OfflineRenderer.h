@@ -0,0 +1,95 @@
+/*
+  ==============================================================================
+
+    OfflineRenderer.h
+
+    Renders long files through Infatuation on all cores. The input is split
+    into chunks, each chunk gets its own processor which is warmed up with a
+    pre-roll of the audio before it, and the results are stitched together.
+    The processors are prepared as non-realtime, so they neither lock their
+    delay memory nor publish stats.
+
+    Parameters can be automated. Blocks are only split at breakpoints, and
+    in between the engine ramps the parameters sample by sample, so the
+    render is sample-accurate at any block size.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+
+//==============================================================================
+/**
+*/
+class OfflineRenderer
+{
+public:
+    OfflineRenderer (double sampleRate, int samplesPerBlock = 512);
+    ~OfflineRenderer();
+
+    // Parameters for the render, as written by getStateInformation.
+    void setState (const juce::MemoryBlock& state);
+    void setRandomSeed (juce::int64 newSeed);
+
+    // Largest difference allowed between a chunk's pre-roll and the output of
+    // the chunk before it. Anything above this falls back to a serial render.
+    void setErrorBound (float newErrorBound);
+
+    // Automation for the render, replacing any set before. Each parameter, by
+    // its ID ("rate", "delaytime", ...), gets breakpoints at times in seconds
+    // with values in the parameter's own range. The continuous parameters
+    // move in straight lines between breakpoints and the choices step at
+    // them; both hold their first and last values before and after. Either
+    // CSV, one "time,parameter,value" line per breakpoint, or JSON of the
+    // form { "parameter": [[time, value], ...], ... }.
+    //
+    // Automating the rate or effect type renders serially, since the LFO
+    // phase at the start of a chunk can't be worked out for those.
+    juce::Result setAutomation (const juce::String& curves);
+    void clearAutomation();
+
+    // Renders a stereo input into output (resized to match). numThreads <= 0
+    // uses every core.
+    juce::Result render (const juce::AudioBuffer<float>& input, juce::AudioBuffer<float>& output, int numThreads = 0);
+
+    // Largest stitching error measured by the last render, 0 if it was serial.
+    float getMeasuredError() const;
+
+    // Chunks the last render's output came from. 1 means it was rendered
+    // serially: the input was too short to split, the rate or effect type
+    // was automated, or the chunk joins were further apart than the error
+    // bound and the split render was thrown away.
+    int getNumChunksUsed() const;
+
+private:
+    struct Chunk;
+    struct AutomationLane;
+
+    using Parameters = std::vector<std::unique_ptr<juce::RangedAudioParameter>>;
+
+    juce::Result addBreakpoint (const Parameters& parameters, const juce::String& parameterID, double time, double value);
+    bool isAutomated (int parameterIndex) const;
+    juce::int64 startAutomationSegment (InfatuationAudioProcessor& processor, juce::int64 position);
+    juce::int64 getStateMemory();
+
+    std::unique_ptr<InfatuationAudioProcessor> createProcessor (juce::int64 position = 0);
+    void renderChunk (Chunk& chunk, const juce::AudioBuffer<float>& input, juce::AudioBuffer<float>& output);
+    void renderSerially (const juce::AudioBuffer<float>& input, juce::AudioBuffer<float>& output);
+
+    double mSampleRate;
+    int mSamplesPerBlock;
+
+    juce::MemoryBlock mState;
+    juce::int64 mRandomSeed;
+    float mErrorBound;
+
+    juce::OwnedArray<AutomationLane> mAutomation;
+
+    float mMeasuredError;
+    int mNumChunksUsed;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (OfflineRenderer)
+};
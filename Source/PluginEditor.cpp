@@ -13,203 +13,43 @@
 InfatuationAudioProcessorEditor::InfatuationAudioProcessorEditor (InfatuationAudioProcessor& p)
     : AudioProcessorEditor (&p), audioProcessor (p)
 {
-    // Make sure that before the constructor has finished, you've set the
-    // editor's size to whatever you need it to be.
-    setSize (500, 400);
-    
     auto& params = processor.getParameters();
     
-    mDryWetLabel.setBounds(25, 25, 100, 30);
-    mDryWetLabel.setText("Dry/Wet", juce::dontSendNotification);
-    mDryWetLabel.setJustificationType(juce::Justification::centred);
-    addAndMakeVisible (mDryWetLabel);
-    
-    juce::AudioParameterFloat* dryWetParameter = (juce::AudioParameterFloat*)params.getUnchecked(0);
-    
-    mDryWetSlider.setBounds(25, 55, 100, 100);
-    mDryWetSlider.setSliderStyle(juce::Slider::SliderStyle::RotaryVerticalDrag);
-    mDryWetSlider.setTextBoxStyle(juce::Slider::TextEntryBoxPosition::NoTextBox, true, 0, 0);
-    mDryWetSlider.setRange(dryWetParameter->range.start, dryWetParameter->range.end);
-    mDryWetSlider.setValue(*dryWetParameter);
-    addAndMakeVisible(mDryWetSlider);
-    
-    mDryWetSlider.onValueChange = [this, dryWetParameter] { *dryWetParameter = mDryWetSlider.getValue(); };
-    mDryWetSlider.onDragStart = [dryWetParameter] { dryWetParameter -> beginChangeGesture(); };
-    mDryWetSlider.onDragEnd = [dryWetParameter] { dryWetParameter -> endChangeGesture(); };
-    
-    mDepthLabel.setBounds(125, 25, 100, 30);
-    mDepthLabel.setText("Depth", juce::dontSendNotification);
-    mDepthLabel.setJustificationType(juce::Justification::centred);
-    addAndMakeVisible (mDepthLabel);
-    
-    juce::AudioParameterFloat* depthParameter = (juce::AudioParameterFloat*)params.getUnchecked(1);
-    
-    mDepthSlider.setBounds(125, 55, 100, 100);
-    mDepthSlider.setSliderStyle(juce::Slider::SliderStyle::RotaryVerticalDrag);
-    mDepthSlider.setTextBoxStyle(juce::Slider::TextEntryBoxPosition::NoTextBox, true, 0, 0);
-    mDepthSlider.setRange(depthParameter->range.start, depthParameter->range.end);
-    mDepthSlider.setValue(*depthParameter);
-    addAndMakeVisible(mDepthSlider);
-    
-    mDepthSlider.onValueChange = [this, depthParameter] { *depthParameter = mDepthSlider.getValue(); };
-    mDepthSlider.onDragStart = [depthParameter] { depthParameter -> beginChangeGesture(); };
-    mDepthSlider.onDragEnd = [depthParameter] { depthParameter -> endChangeGesture(); };
-    
-    mRateLabel.setBounds(225, 25, 100, 30);
-    mRateLabel.setText("Speed", juce::dontSendNotification);
-    mRateLabel.setJustificationType(juce::Justification::centred);
-    addAndMakeVisible (mRateLabel);
-    
-    juce::AudioParameterFloat* rateParameter = (juce::AudioParameterFloat*)params.getUnchecked(2);
-    
-    mRateSlider.setBounds(225, 55, 100, 100);
-    mRateSlider.setSliderStyle(juce::Slider::SliderStyle::RotaryVerticalDrag);
-    mRateSlider.setTextBoxStyle(juce::Slider::TextEntryBoxPosition::NoTextBox, true, 0, 0);
-    mRateSlider.setRange(rateParameter->range.start, rateParameter->range.end);
-    mRateSlider.setValue(*rateParameter);
-    addAndMakeVisible(mRateSlider);
-    
-    mRateSlider.onValueChange = [this, rateParameter] { *rateParameter = mRateSlider.getValue(); };
-    mRateSlider.onDragStart = [rateParameter] { rateParameter -> beginChangeGesture(); };
-    mRateSlider.onDragEnd = [rateParameter] { rateParameter -> endChangeGesture(); };
-    
-    mPhaseOffsetLabel.setBounds(325, 25, 100, 30);
-    mPhaseOffsetLabel.setText("Phase", juce::dontSendNotification);
-    mPhaseOffsetLabel.setJustificationType(juce::Justification::centred);
-    addAndMakeVisible (mPhaseOffsetLabel);
-    
-    juce::AudioParameterFloat* phaseOffsetParameter = (juce::AudioParameterFloat*)params.getUnchecked(3);
-    
-    mPhaseOffsetSlider.setBounds(325, 55, 100, 100);
-    mPhaseOffsetSlider.setSliderStyle(juce::Slider::SliderStyle::RotaryVerticalDrag);
-    mPhaseOffsetSlider.setTextBoxStyle(juce::Slider::TextEntryBoxPosition::NoTextBox, true, 0, 0);
-    mPhaseOffsetSlider.setRange(phaseOffsetParameter->range.start, phaseOffsetParameter->range.end);
-    mPhaseOffsetSlider.setValue(*phaseOffsetParameter);
-    addAndMakeVisible(mPhaseOffsetSlider);
-    
-    mPhaseOffsetSlider.onValueChange = [this, phaseOffsetParameter] { *phaseOffsetParameter = mPhaseOffsetSlider.getValue(); };
-    mPhaseOffsetSlider.onDragStart = [phaseOffsetParameter] { phaseOffsetParameter -> beginChangeGesture(); };
-    mPhaseOffsetSlider.onDragEnd = [phaseOffsetParameter] { phaseOffsetParameter -> endChangeGesture(); };
-    
-    mFeedbackLabel.setText("Feedback", juce::dontSendNotification);
-    mFeedbackLabel.setJustificationType(juce::Justification::centred);
-    addAndMakeVisible (mFeedbackLabel);
-    
-    juce::AudioParameterFloat* feedbackParameter = (juce::AudioParameterFloat*)params.getUnchecked(4);
-    
-    mFeedbackSlider.setSliderStyle(juce::Slider::SliderStyle::RotaryVerticalDrag);
-    mFeedbackSlider.setTextBoxStyle(juce::Slider::TextEntryBoxPosition::NoTextBox, true, 0, 0);
-    mFeedbackSlider.setRange(feedbackParameter->range.start, feedbackParameter->range.end);
-    mFeedbackSlider.setValue(*feedbackParameter);
-    addAndMakeVisible(mFeedbackSlider);
-    
-    mFeedbackSlider.onValueChange = [this, feedbackParameter] { *feedbackParameter = mFeedbackSlider.getValue(); };
-    mFeedbackSlider.onDragStart = [feedbackParameter] { feedbackParameter -> beginChangeGesture(); };
-    mFeedbackSlider.onDragEnd = [feedbackParameter] { feedbackParameter -> endChangeGesture(); };
-    
-    mTypeLabel.setText("Effect Type", juce::dontSendNotification);
-    mTypeLabel.setJustificationType(juce::Justification::centred);
-    addAndMakeVisible (mTypeLabel);
-    
-    juce::AudioParameterInt* typeParameter = (juce::AudioParameterInt*)params.getUnchecked(5);
-    juce::AudioParameterInt* typeIDParam = (juce::AudioParameterInt*)params.getUnchecked(6);
-    
-    mType.addItem("Delay", 1);
-    mType.addItem("Chorus", 2);
-    mType.addItem("Flanger", 3);
-    addAndMakeVisible(mType);
-    
-    mType.onChange = [this, typeParameter, typeIDParam] {
-        typeParameter->beginChangeGesture();
-        *typeParameter = mType.getSelectedItemIndex();
-        *typeIDParam = mType.getSelectedId();
-        mSliderID = mType.getSelectedId();
-        typeParameter->endChangeGesture();
-    };
-    
-    mType.setSelectedItemIndex(*typeParameter);
-    
-    mDelayTimeLabel.setBounds(125, 25, 100, 30);
-    mDelayTimeLabel.setText("Delay Time", juce::dontSendNotification);
-    mDelayTimeLabel.setJustificationType(juce::Justification::centred);
-    addAndMakeVisible (mDelayTimeLabel);
-    
-    juce::AudioParameterFloat* delayTimeParameter = (juce::AudioParameterFloat*)params.getUnchecked(7);
-    
-    mDelayTimeSlider.setBounds(125, 55, 100, 100);
-    mDelayTimeSlider.setSliderStyle(juce::Slider::SliderStyle::RotaryVerticalDrag);
-    mDelayTimeSlider.setTextBoxStyle(juce::Slider::TextEntryBoxPosition::NoTextBox, true, 0, 0);
-    mDelayTimeSlider.setRange(delayTimeParameter->range.start, delayTimeParameter->range.end);
-    mDelayTimeSlider.setValue(*delayTimeParameter);
-    addAndMakeVisible(mDelayTimeSlider);
-    
-    mDelayTimeSlider.onValueChange = [this, delayTimeParameter] { *delayTimeParameter = mDelayTimeSlider.getValue(); };
-    mDelayTimeSlider.onDragStart = [delayTimeParameter] { delayTimeParameter -> beginChangeGesture(); };
-    mDelayTimeSlider.onDragEnd = [delayTimeParameter] { delayTimeParameter -> endChangeGesture(); };
-    
-    mNoiseLevelLabel.setText("Noise Level", juce::dontSendNotification);
-    mNoiseLevelLabel.setJustificationType(juce::Justification::centred);
-    addAndMakeVisible (mNoiseLevelLabel);
-    
-    juce::AudioParameterFloat* noiseLevelParameter = (juce::AudioParameterFloat*)params.getUnchecked(8);
-    
-    mNoiseLevelSlider.setSliderStyle(juce::Slider::SliderStyle::LinearHorizontal);
-    mNoiseLevelSlider.setTextBoxStyle(juce::Slider::TextEntryBoxPosition::NoTextBox, true, 0, 0);
-    mNoiseLevelSlider.setRange(noiseLevelParameter->range.start, noiseLevelParameter->range.end);
-    mNoiseLevelSlider.setValue(*noiseLevelParameter);
-    addAndMakeVisible(mNoiseLevelSlider);
-    
-    mNoiseLevelSlider.onValueChange = [this, noiseLevelParameter] { *noiseLevelParameter = mNoiseLevelSlider.getValue(); };
-    mNoiseLevelSlider.onDragStart = [noiseLevelParameter] { noiseLevelParameter -> beginChangeGesture(); };
-    mNoiseLevelSlider.onDragEnd = [noiseLevelParameter] { noiseLevelParameter -> endChangeGesture(); };
-    
-    mWaveTypeLabel.setText("Wave Type", juce::dontSendNotification);
-    mWaveTypeLabel.setJustificationType(juce::Justification::centred);
-    addAndMakeVisible (mWaveTypeLabel);
-    
-    juce::AudioParameterInt* waveTypeParameter = (juce::AudioParameterInt*)params.getUnchecked(9);
-    juce::AudioParameterInt* waveTypeIDParam = (juce::AudioParameterInt*)params.getUnchecked(10);
-    
-    mWaveType.addItem("Sin", 1);
-    mWaveType.addItem("Saw", 2);
-    mWaveType.addItem("Triangle", 3);
-    addAndMakeVisible(mWaveType);
+    getLookAndFeel().setColour (juce::Slider::thumbColourId, juce::Colours::steelblue);
+    getLookAndFeel().setColour (juce::Slider::trackColourId, juce::Colours::lightpink);
+    getLookAndFeel().setColour (juce::Slider::backgroundColourId, juce::Colours::whitesmoke);
     
-    mWaveType.onChange = [this, waveTypeParameter, waveTypeIDParam] {
-        waveTypeParameter->beginChangeGesture();
-        *waveTypeParameter = mWaveType.getSelectedItemIndex();
-        *waveTypeIDParam = mWaveType.getSelectedId();
-        mWaveSliderID = mWaveType.getSelectedId();
-        waveTypeParameter->endChangeGesture();
-    };
+    // everything is read below, so only changes from here on need catching up with
+    audioProcessor.takeDirtyParameters();
+    mDeferredParameters = 0;
     
-    mWaveType.setSelectedItemIndex(*waveTypeParameter);
+    // the combo boxes show the ID parameters, so the host's session decides
+    // what's selected and opening the editor doesn't write anything back
+    mSliderID = *(juce::AudioParameterInt*)params.getUnchecked(InfatuationAudioProcessor::typeIDIndex);
+    mWaveSliderID = *(juce::AudioParameterInt*)params.getUnchecked(InfatuationAudioProcessor::waveTypeIDIndex);
+    mNoiseSliderID = *(juce::AudioParameterInt*)params.getUnchecked(InfatuationAudioProcessor::noiseTypeIDIndex);
+    mQualityID = *(juce::AudioParameterInt*)params.getUnchecked(InfatuationAudioProcessor::qualityIDIndex);
     
-    mNoiseTypeLabel.setText("Noise Type", juce::dontSendNotification);
-    mNoiseTypeLabel.setJustificationType(juce::Justification::centred);
-    addAndMakeVisible (mNoiseTypeLabel);
+    setUpSlider(mDryWetLabel, mDryWetSlider, "Dry/Wet", InfatuationAudioProcessor::dryWetIndex, juce::Slider::SliderStyle::RotaryVerticalDrag);
+    mDryWetLabel.setBounds(25, 25, 100, 30);
+    mDryWetSlider.setBounds(25, 55, 100, 100);
     
-    juce::AudioParameterInt* noiseTypeParameter = (juce::AudioParameterInt*)params.getUnchecked(11);
-    juce::AudioParameterInt* noiseTypeIDParam = (juce::AudioParameterInt*)params.getUnchecked(12);
+    setUpComboBox(mTypeLabel, mType, "Effect Type", { "Delay", "Chorus", "Flanger" }, InfatuationAudioProcessor::typeIndex, mSliderID, [this] { updateEffectControls(); });
     
-    mNoiseType.addItem("Type 1", 1);
-    mNoiseType.addItem("Type 2", 2);
-    mNoiseType.addItem("Type 3", 3);
-    addAndMakeVisible(mNoiseType);
+    setUpSlider(mNoiseLevelLabel, mNoiseLevelSlider, "Noise Level", InfatuationAudioProcessor::noiseLevelIndex, juce::Slider::SliderStyle::LinearHorizontal);
+    setUpComboBox(mNoiseTypeLabel, mNoiseType, "Noise Type", { "Type 1", "Type 2", "Type 3" }, InfatuationAudioProcessor::noiseTypeIndex, mNoiseSliderID);
+    setUpComboBox(mQualityLabel, mQuality, "Quality", { "Eco", "Standard", "High", "Auto" }, InfatuationAudioProcessor::qualityIndex, mQualityID);
     
-    mNoiseType.onChange = [this, noiseTypeParameter, noiseTypeIDParam] {
-        noiseTypeParameter->beginChangeGesture();
-        *noiseTypeParameter = mNoiseType.getSelectedItemIndex();
-        *noiseTypeIDParam = mNoiseType.getSelectedId();
-        mNoiseSliderID = mNoiseType.getSelectedId();
-        noiseTypeParameter->endChangeGesture();
-    };
+    // Make sure that before the constructor has finished, you've set the
+    // editor's size to whatever you need it to be.
+    updateEffectControls();
     
-    mNoiseType.setSelectedItemIndex(*noiseTypeParameter);
+    startTimerHz(EDITOR_REFRESH_RATE);
 }
 
 InfatuationAudioProcessorEditor::~InfatuationAudioProcessorEditor()
 {
+    stopTimer();
 }
 
 //==============================================================================
@@ -218,138 +58,10 @@ void InfatuationAudioProcessorEditor::paint (juce::Graphics& g)
     // (Our component is opaque, so we must completely fill the background with a solid colour)
     g.fillAll(juce::Colours::skyblue);
     
-    mDryWetLabel.setColour(juce::Label::textColourId, juce::Colours::dimgrey);
-    mDepthLabel.setColour(juce::Label::textColourId, juce::Colours::dimgrey);
-    mRateLabel.setColour(juce::Label::textColourId, juce::Colours::dimgrey);
-    mPhaseOffsetLabel.setColour(juce::Label::textColourId, juce::Colours::dimgrey);
-    mFeedbackLabel.setColour(juce::Label::textColourId, juce::Colours::dimgrey);
-    mDelayTimeLabel.setColour(juce::Label::textColourId, juce::Colours::dimgrey);
-    mNoiseLevelLabel.setColour(juce::Label::textColourId, juce::Colours::dimgrey);
-    mWaveTypeLabel.setColour(juce::Label::textColourId, juce::Colours::dimgrey);
-    mTypeLabel.setColour(juce::Label::textColourId, juce::Colours::dimgrey);
-    mNoiseTypeLabel.setColour(juce::Label::textColourId, juce::Colours::dimgrey);
+    g.setColour (juce::Colours::pink);
+    juce::Line<float> line (25, 245, getWidth() - 25, 245);
+    g.drawLine (line, 3.0f);
     
-    getLookAndFeel().setColour (juce::Slider::thumbColourId, juce::Colours::steelblue);
-    getLookAndFeel().setColour (juce::Slider::trackColourId, juce::Colours::lightpink);
-    getLookAndFeel().setColour (juce::Slider::backgroundColourId, juce::Colours::whitesmoke);
-
-   if (mSliderID == 2)
-   {
-       setSize (350, 420);
-       
-       mDryWetLabel.setVisible(true);
-       mDepthLabel.setVisible(true);
-       mRateLabel.setVisible(true);
-       mPhaseOffsetLabel.setVisible(false);
-       mFeedbackLabel.setVisible(false);
-       mDelayTimeLabel.setVisible(false);
-       mNoiseLevelSlider.setVisible(true);
-       mWaveTypeLabel.setVisible(true);
-       
-       mDryWetSlider.setVisible(true);
-       mDepthSlider.setVisible(true);
-       mRateSlider.setVisible(true);
-       mPhaseOffsetSlider.setVisible(false);
-       mFeedbackSlider.setVisible(false);
-       mDelayTimeSlider.setVisible(false);
-       mNoiseLevelSlider.setVisible(true);
-       mWaveType.setVisible(true);
-       
-       mTypeLabel.setBounds(60, 155, 100, 30);
-       mType.setBounds(60, 185, 100, 30);
-       
-       mWaveTypeLabel.setBounds(190, 155, 100, 30);
-       mWaveType.setBounds(190, 185, 100, 30);
-       
-       g.setColour (juce::Colours::pink);
-       juce::Line<float> line1 (25, 245, 325, 245);
-       g.drawLine (line1, 3.0f);
-
-       mNoiseTypeLabel.setBounds(125, 270, 100, 30);
-       mNoiseType.setBounds(125, 300, 100, 30);
-       
-       mNoiseLevelLabel.setBounds(125, 335, 100, 30);
-       mNoiseLevelSlider.setBounds(25, 365, 300, 30);
-       
-   } else if (mSliderID == 3)
-   {
-       setSize (550, 380);
-       g.setColour (juce::Colours::orangered);
-       
-       mDryWetLabel.setVisible(true);
-       mDepthLabel.setVisible(true);
-       mRateLabel.setVisible(true);
-       mPhaseOffsetLabel.setVisible(true);
-       mFeedbackLabel.setVisible(true);
-       mDelayTimeLabel.setVisible(false);
-       mWaveTypeLabel.setVisible(true);
-       
-       mDryWetSlider.setVisible(true);
-       mDepthSlider.setVisible(true);
-       mRateSlider.setVisible(true);
-       mPhaseOffsetSlider.setVisible(true);
-       mFeedbackSlider.setVisible(true);
-       mDelayTimeSlider.setVisible(false);
-       mNoiseLevelSlider.setVisible(true);
-       mWaveType.setVisible(true);
-       
-       mFeedbackLabel.setBounds(425, 25, 100, 30);
-       mFeedbackSlider.setBounds(425, 55, 100, 100);
-       
-       mWaveTypeLabel.setBounds(300, 155, 100, 30);
-       mWaveType.setBounds(300, 185, 100, 30);
-       
-       mTypeLabel.setBounds(150, 155, 100, 30);
-       mType.setBounds(150, 185, 100, 30);
-       
-       g.setColour (juce::Colours::pink);
-       juce::Line<float> line2 (25, 245, 525, 245);
-       g.drawLine (line2, 3.0f);
-       
-       mNoiseTypeLabel.setBounds(50, 270, 100, 30);
-       mNoiseType.setBounds(50, 300, 100, 30);
-       
-       mNoiseLevelLabel.setBounds(200, 270, 300, 30);
-       mNoiseLevelSlider.setBounds(200, 300, 300, 30);
-       
-   } else if (mSliderID == 1)
-   {
-       setSize (350, 420);
-       g.setColour (juce::Colours::green);
-       
-       mDryWetLabel.setVisible(true);
-       mDepthLabel.setVisible(false);
-       mRateLabel.setVisible(false);
-       mPhaseOffsetLabel.setVisible(false);
-       mFeedbackLabel.setVisible(true);
-       mDelayTimeLabel.setVisible(true);
-       mWaveTypeLabel.setVisible(false);
-       
-       mDryWetSlider.setVisible(true);
-       mDepthSlider.setVisible(false);
-       mRateSlider.setVisible(false);
-       mPhaseOffsetSlider.setVisible(false);
-       mFeedbackSlider.setVisible(true);
-       mDelayTimeSlider.setVisible(true);
-       mNoiseLevelSlider.setVisible(true);
-       mWaveType.setVisible(false);
-       
-       mFeedbackLabel.setBounds(225, 25, 100, 30);
-       mFeedbackSlider.setBounds(225, 55, 100, 100);
-       
-       mTypeLabel.setBounds(125, 155, 100, 30);
-       mType.setBounds(125, 185, 100, 30);
-       
-       g.setColour (juce::Colours::pink);
-       juce::Line<float> line (25, 245, 325, 245);
-       g.drawLine (line, 3.0f);
-       
-       mNoiseTypeLabel.setBounds(125, 270, 100, 30);
-       mNoiseType.setBounds(125, 300, 100, 30);
-       
-       mNoiseLevelLabel.setBounds(125, 335, 100, 30);
-       mNoiseLevelSlider.setBounds(25, 365, 300, 30);
-   }
     g.setFont (15.0f);
 }
 
@@ -358,3 +70,200 @@ void InfatuationAudioProcessorEditor::resized()
     // This is generally where you'll want to lay out the positions of any
     // subcomponents in your editor..
 }
+
+void InfatuationAudioProcessorEditor::timerCallback()
+{
+    // a slider that was being dragged last frame still has to catch up
+    juce::uint32 dirtyParameters = audioProcessor.takeDirtyParameters() | mDeferredParameters;
+    mDeferredParameters = 0;
+    
+    if (dirtyParameters == 0) {
+        return;
+    }
+    
+    auto& params = processor.getParameters();
+    
+    auto isDirty = [dirtyParameters] (int parameterIndex) { return (dirtyParameters & (1u << parameterIndex)) != 0; };
+    auto getID = [&params] (int parameterIndex) { return (int)*(juce::AudioParameterInt*)params.getUnchecked(parameterIndex); };
+    
+    updateSlider(&mDryWetSlider, InfatuationAudioProcessor::dryWetIndex, dirtyParameters);
+    updateSlider(mDepthSlider.get(), InfatuationAudioProcessor::depthIndex, dirtyParameters);
+    updateSlider(mRateSlider.get(), InfatuationAudioProcessor::rateIndex, dirtyParameters);
+    updateSlider(mPhaseOffsetSlider.get(), InfatuationAudioProcessor::phaseOffsetIndex, dirtyParameters);
+    updateSlider(mFeedbackSlider.get(), InfatuationAudioProcessor::feedbackIndex, dirtyParameters);
+    updateSlider(mDelayTimeSlider.get(), InfatuationAudioProcessor::delayTimeIndex, dirtyParameters);
+    updateSlider(&mNoiseLevelSlider, InfatuationAudioProcessor::noiseLevelIndex, dirtyParameters);
+    
+    if (isDirty(InfatuationAudioProcessor::waveTypeIDIndex)) {
+        mWaveSliderID = getID(InfatuationAudioProcessor::waveTypeIDIndex);
+        
+        if (mWaveType != nullptr) {
+            mWaveType->setSelectedId(mWaveSliderID, juce::dontSendNotification);
+        }
+    }
+    
+    if (isDirty(InfatuationAudioProcessor::noiseTypeIDIndex)) {
+        mNoiseSliderID = getID(InfatuationAudioProcessor::noiseTypeIDIndex);
+        mNoiseType.setSelectedId(mNoiseSliderID, juce::dontSendNotification);
+    }
+    
+    if (isDirty(InfatuationAudioProcessor::qualityIDIndex)) {
+        mQualityID = getID(InfatuationAudioProcessor::qualityIDIndex);
+        mQuality.setSelectedId(mQualityID, juce::dontSendNotification);
+    }
+    
+    if (isDirty(InfatuationAudioProcessor::typeIDIndex) && getID(InfatuationAudioProcessor::typeIDIndex) != mSliderID) {
+        mSliderID = getID(InfatuationAudioProcessor::typeIDIndex);
+        mType.setSelectedId(mSliderID, juce::dontSendNotification);
+        updateEffectControls();
+    }
+}
+
+void InfatuationAudioProcessorEditor::updateSlider(juce::Slider* slider, int parameterIndex, juce::uint32 dirtyParameters)
+{
+    // sliders made later read the parameter then
+    if (slider == nullptr || (dirtyParameters & (1u << parameterIndex)) == 0) {
+        return;
+    }
+    
+    // the one being dragged is the one setting it, but the host may have
+    // moved it too, so it's caught up once the drag ends
+    if (slider->isMouseButtonDown()) {
+        mDeferredParameters |= 1u << parameterIndex;
+        return;
+    }
+    
+    juce::AudioParameterFloat* parameter = (juce::AudioParameterFloat*)processor.getParameters().getUnchecked(parameterIndex);
+    slider->setValue(*parameter, juce::dontSendNotification);
+}
+
+void InfatuationAudioProcessorEditor::updateEffectControls()
+{
+    bool isDelay = (mSliderID == 1);
+    bool isChorus = (mSliderID == 2);
+    bool isFlanger = (mSliderID == 3);
+    
+    showRotarySlider(mDepthLabel, mDepthSlider, "Depth", InfatuationAudioProcessor::depthIndex, ! isDelay, 125);
+    showRotarySlider(mRateLabel, mRateSlider, "Speed", InfatuationAudioProcessor::rateIndex, ! isDelay, 225);
+    showRotarySlider(mPhaseOffsetLabel, mPhaseOffsetSlider, "Phase", InfatuationAudioProcessor::phaseOffsetIndex, isFlanger, 325);
+    showRotarySlider(mFeedbackLabel, mFeedbackSlider, "Feedback", InfatuationAudioProcessor::feedbackIndex, ! isChorus, isFlanger ? 425 : 225);
+    showRotarySlider(mDelayTimeLabel, mDelayTimeSlider, "Delay Time", InfatuationAudioProcessor::delayTimeIndex, isDelay, 125);
+    
+    if (mWaveType == nullptr && ! isDelay) {
+        mWaveTypeLabel = std::make_unique<juce::Label>();
+        mWaveType = std::make_unique<juce::ComboBox>();
+        setUpComboBox(*mWaveTypeLabel, *mWaveType, "Wave Type", { "Sin", "Saw", "Triangle" }, InfatuationAudioProcessor::waveTypeIndex, mWaveSliderID);
+    }
+    
+    if (mWaveType != nullptr) {
+        mWaveTypeLabel->setVisible(! isDelay);
+        mWaveType->setVisible(! isDelay);
+        
+        mWaveTypeLabel->setBounds(isFlanger ? 300 : 190, 155, 100, 30);
+        mWaveType->setBounds(isFlanger ? 300 : 190, 185, 100, 30);
+    }
+    
+    if (isFlanger)
+    {
+        setSize (550, 410);
+        
+        mTypeLabel.setBounds(150, 155, 100, 30);
+        mType.setBounds(150, 185, 100, 30);
+        
+        mNoiseTypeLabel.setBounds(50, 270, 100, 30);
+        mNoiseType.setBounds(50, 300, 100, 30);
+        
+        mNoiseLevelLabel.setBounds(200, 270, 300, 30);
+        mNoiseLevelSlider.setBounds(200, 300, 300, 30);
+        
+        mQualityLabel.setBounds(50, 335, 100, 30);
+        mQuality.setBounds(50, 365, 100, 30);
+    } else
+    {
+        setSize (350, 485);
+        
+        mTypeLabel.setBounds(isDelay ? 125 : 60, 155, 100, 30);
+        mType.setBounds(isDelay ? 125 : 60, 185, 100, 30);
+        
+        mNoiseTypeLabel.setBounds(125, 270, 100, 30);
+        mNoiseType.setBounds(125, 300, 100, 30);
+        
+        mNoiseLevelLabel.setBounds(125, 335, 100, 30);
+        mNoiseLevelSlider.setBounds(25, 365, 300, 30);
+        
+        mQualityLabel.setBounds(125, 400, 100, 30);
+        mQuality.setBounds(125, 430, 100, 30);
+    }
+    
+    repaint();
+}
+
+void InfatuationAudioProcessorEditor::setUpLabel(juce::Label& label, const juce::String& text)
+{
+    label.setText(text, juce::dontSendNotification);
+    label.setJustificationType(juce::Justification::centred);
+    label.setColour(juce::Label::textColourId, juce::Colours::dimgrey);
+    addAndMakeVisible (label);
+}
+
+void InfatuationAudioProcessorEditor::setUpSlider(juce::Label& label, juce::Slider& slider, const juce::String& text, int parameterIndex, juce::Slider::SliderStyle style)
+{
+    setUpLabel(label, text);
+    
+    juce::AudioParameterFloat* parameter = (juce::AudioParameterFloat*)processor.getParameters().getUnchecked(parameterIndex);
+    
+    slider.setSliderStyle(style);
+    slider.setTextBoxStyle(juce::Slider::TextEntryBoxPosition::NoTextBox, true, 0, 0);
+    slider.setRange(parameter->range.start, parameter->range.end);
+    slider.setValue(*parameter);
+    addAndMakeVisible(slider);
+    
+    slider.onValueChange = [&slider, parameter] { *parameter = slider.getValue(); };
+    slider.onDragStart = [parameter] { parameter -> beginChangeGesture(); };
+    slider.onDragEnd = [parameter] { parameter -> endChangeGesture(); };
+}
+
+void InfatuationAudioProcessorEditor::setUpComboBox(juce::Label& label, juce::ComboBox& comboBox, const juce::String& text, const juce::StringArray& items, int parameterIndex, int& selectedID, std::function<void()> onSelected)
+{
+    setUpLabel(label, text);
+    
+    // each choice has an index parameter with its ID parameter right after it
+    auto& params = processor.getParameters();
+    juce::AudioParameterInt* parameter = (juce::AudioParameterInt*)params.getUnchecked(parameterIndex);
+    juce::AudioParameterInt* IDParam = (juce::AudioParameterInt*)params.getUnchecked(parameterIndex + 1);
+    
+    comboBox.addItemList(items, 1);
+    comboBox.setSelectedId(*IDParam, juce::dontSendNotification);
+    addAndMakeVisible(comboBox);
+    
+    comboBox.onChange = [&comboBox, &selectedID, parameter, IDParam, onSelected] {
+        parameter->beginChangeGesture();
+        *parameter = comboBox.getSelectedItemIndex();
+        *IDParam = comboBox.getSelectedId();
+        selectedID = comboBox.getSelectedId();
+        parameter->endChangeGesture();
+        
+        if (onSelected != nullptr) {
+            onSelected();
+        }
+    };
+}
+
+void InfatuationAudioProcessorEditor::showRotarySlider(std::unique_ptr<juce::Label>& label, std::unique_ptr<juce::Slider>& slider, const juce::String& text, int parameterIndex, bool shouldShow, int x)
+{
+    if (slider == nullptr) {
+        if (! shouldShow) {
+            return;
+        }
+        
+        label = std::make_unique<juce::Label>();
+        slider = std::make_unique<juce::Slider>();
+        setUpSlider(*label, *slider, text, parameterIndex, juce::Slider::SliderStyle::RotaryVerticalDrag);
+    }
+    
+    label->setVisible(shouldShow);
+    slider->setVisible(shouldShow);
+    
+    label->setBounds(x, 25, 100, 30);
+    slider->setBounds(x, 55, 100, 100);
+}
@@ -11,10 +11,14 @@
 #include <JuceHeader.h>
 #include "PluginProcessor.h"
 
+// how often the controls catch up with the parameters, about once a frame
+#define EDITOR_REFRESH_RATE 60
+
 //==============================================================================
 /**
 */
-class InfatuationAudioProcessorEditor  : public juce::AudioProcessorEditor
+class InfatuationAudioProcessorEditor  : public juce::AudioProcessorEditor,
+                                         private juce::Timer
 {
 public:
     InfatuationAudioProcessorEditor (InfatuationAudioProcessor&);
@@ -25,36 +29,60 @@ public:
     void resized() override;
 
 private:
+    // Brings the controls of every parameter the processor has marked as
+    // changed up to date, however many times each changed since last frame
+    void timerCallback() override;
+    void updateSlider(juce::Slider* slider, int parameterIndex, juce::uint32 dirtyParameters);
+    
+    // Shows the controls of the selected effect type, making any it hasn't
+    // needed before, and lays the window out for it
+    void updateEffectControls();
+    
+    void setUpLabel(juce::Label& label, const juce::String& text);
+    void setUpSlider(juce::Label& label, juce::Slider& slider, const juce::String& text, int parameterIndex, juce::Slider::SliderStyle style);
+    void setUpComboBox(juce::Label& label, juce::ComboBox& comboBox, const juce::String& text, const juce::StringArray& items, int parameterIndex, int& selectedID, std::function<void()> onSelected = nullptr);
+    void showRotarySlider(std::unique_ptr<juce::Label>& label, std::unique_ptr<juce::Slider>& slider, const juce::String& text, int parameterIndex, bool shouldShow, int x);
+    
     // This reference is provided as a quick way for your editor to
     // access the processor object that created it.
     InfatuationAudioProcessor& audioProcessor;
     
     juce::Slider mDryWetSlider;
-    juce::Slider mDepthSlider;
-    juce::Slider mRateSlider;
-    juce::Slider mPhaseOffsetSlider;
-    juce::Slider mFeedbackSlider;
-    juce::Slider mDelayTimeSlider;
     juce::Slider mNoiseLevelSlider;
     
     juce::ComboBox mType;
-    juce::ComboBox mWaveType;
     juce::ComboBox mNoiseType;
+    juce::ComboBox mQuality;
     
     juce::Label mDryWetLabel;
-    juce::Label mDepthLabel;
-    juce::Label mRateLabel;
-    juce::Label mPhaseOffsetLabel;
-    juce::Label mFeedbackLabel;
-    juce::Label mDelayTimeLabel;
     juce::Label mNoiseLevelLabel;
     juce::Label mTypeLabel;
-    juce::Label mWaveTypeLabel;
     juce::Label mNoiseTypeLabel;
+    juce::Label mQualityLabel;
+    
+    // only some effect types use these, so they're made when first shown
+    std::unique_ptr<juce::Slider> mDepthSlider;
+    std::unique_ptr<juce::Slider> mRateSlider;
+    std::unique_ptr<juce::Slider> mPhaseOffsetSlider;
+    std::unique_ptr<juce::Slider> mFeedbackSlider;
+    std::unique_ptr<juce::Slider> mDelayTimeSlider;
+    
+    std::unique_ptr<juce::ComboBox> mWaveType;
+    
+    std::unique_ptr<juce::Label> mDepthLabel;
+    std::unique_ptr<juce::Label> mRateLabel;
+    std::unique_ptr<juce::Label> mPhaseOffsetLabel;
+    std::unique_ptr<juce::Label> mFeedbackLabel;
+    std::unique_ptr<juce::Label> mDelayTimeLabel;
+    std::unique_ptr<juce::Label> mWaveTypeLabel;
     
     int mSliderID;
     int mWaveSliderID;
     int mNoiseSliderID;
+    int mQualityID;
+    
+    // dirty parameters whose sliders were being dragged, kept for a later frame
+    juce::uint32 mDeferredParameters;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (InfatuationAudioProcessorEditor)
 };
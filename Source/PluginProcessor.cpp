@@ -8,54 +8,93 @@
 
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
+#include "RealtimeSafetyChecker.h"
 
 //==============================================================================
 InfatuationAudioProcessor::InfatuationAudioProcessor()
      : AudioProcessor (BusesProperties()
                        .withInput  ("Input",  juce::AudioChannelSet::stereo(), true)
-                       .withOutput ("Output", juce::AudioChannelSet::stereo(), true))
-{
-    addParameter(mDryWetParameter = new juce::AudioParameterFloat("drywet", "Dry Wet", 0.0, 1.0, 0.5));
-    addParameter(mDepthParameter = new juce::AudioParameterFloat("depth", "Depth", 0.0, 1.0, 0.5));
-    addParameter(mRateParameter = new juce::AudioParameterFloat("rate", "Rate", 0.0, 1.0, 0.5));
-    addParameter(mPhaseOffsetParameter = new juce::AudioParameterFloat("phaseoffset", "Phase Offset", 0.0, 1.0, 0.5));
-    addParameter(mFeedbackParameter = new juce::AudioParameterFloat("feedback", "Feedback", 0, 0.98, 0.5));
-    addParameter(mTypeParameter = new juce::AudioParameterInt("type", "Type", 0, 1, 0));
-    addParameter(mTypeIDParam = new juce::AudioParameterInt("typeID", "TypeID", 1, 3, 1));
-    addParameter(mDelayTimeParameter = new juce::AudioParameterFloat("delaytime", "Delay Time", 0.01, MAX_DELAY_TIME, 1.0));
-    addParameter(mNoiseLevelParameter = new juce::AudioParameterFloat("noiselevel", "Noise Level", 0.00, 1.00, 0));
-    addParameter(mWaveTypeParameter = new juce::AudioParameterInt("waveType", "Wave Type", 0, 1, 0));
-    addParameter(mWaveTypeIDParam = new juce::AudioParameterInt("waveTypeID", "Wave TypeID", 1, 3, 1));
-    addParameter(mNoiseTypeParameter = new juce::AudioParameterInt("noiseType", "Noise Type", 0, 1, 0));
-    addParameter(mNoiseTypeIDParam = new juce::AudioParameterInt("noiseTypeID", "Noise TypeID", 1, 3, 1));
-    
-    mDelayTimeSmoothed = 0;
-    mCircularBufferLeft = nullptr;
-    mCircularBufferRight = nullptr;
-    mCircularBufferWriteHead = 0;
-    mCircularBufferLength = 0;
-    mDelayTimeInSamples = 0;
-    mDelayReadHead = 0;
-    
-    mFeedbackLeft = 0;
-    mFeedbackRight = 0;
-    
-    mLFOPhase = 0;
-    mDryWet = 0.5;
+                       .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
+                       .withOutput ("Wet",    juce::AudioChannelSet::stereo(), false))
+{
+    for (auto& parameter : createParameters()) {
+        addParameter(parameter.release());
+    }
+    
+    static_assert(numParameters <= 32, "the dirty-parameter mask has a bit per parameter");
+    jassert(getParameters().size() == numParameters);
+    
+    auto& parameters = getParameters();
+    mDryWetParameter = static_cast<juce::AudioParameterFloat*>(parameters[dryWetIndex]);
+    mDepthParameter = static_cast<juce::AudioParameterFloat*>(parameters[depthIndex]);
+    mRateParameter = static_cast<juce::AudioParameterFloat*>(parameters[rateIndex]);
+    mPhaseOffsetParameter = static_cast<juce::AudioParameterFloat*>(parameters[phaseOffsetIndex]);
+    mFeedbackParameter = static_cast<juce::AudioParameterFloat*>(parameters[feedbackIndex]);
+    mTypeParameter = static_cast<juce::AudioParameterInt*>(parameters[typeIndex]);
+    mTypeIDParam = static_cast<juce::AudioParameterInt*>(parameters[typeIDIndex]);
+    mDelayTimeParameter = static_cast<juce::AudioParameterFloat*>(parameters[delayTimeIndex]);
+    mNoiseLevelParameter = static_cast<juce::AudioParameterFloat*>(parameters[noiseLevelIndex]);
+    mWaveTypeParameter = static_cast<juce::AudioParameterInt*>(parameters[waveTypeIndex]);
+    mWaveTypeIDParam = static_cast<juce::AudioParameterInt*>(parameters[waveTypeIDIndex]);
+    mNoiseTypeParameter = static_cast<juce::AudioParameterInt*>(parameters[noiseTypeIndex]);
+    mNoiseTypeIDParam = static_cast<juce::AudioParameterInt*>(parameters[noiseTypeIDIndex]);
+    mQualityParameter = static_cast<juce::AudioParameterInt*>(parameters[qualityIndex]);
+    mQualityIDParam = static_cast<juce::AudioParameterInt*>(parameters[qualityIDIndex]);
+    
+    for (auto* parameter : getParameters()) {
+        parameter->addListener(this);
+    }
+    
+    mAutoQuality = standardQuality;
+    mBlockLoad = 0;
+    mLowLoadTime = 0;
+    
+    mRecordedTypeID = 0;
+    mRecordedWaveTypeID = 0;
+    
+    mNumWorkerThreads = 0;
+    mBusChannels = nullptr;
+    mWetChannels = nullptr;
+    mBusNumChannels = 0;
+    mBusNumSamples = 0;
+    mRandomSeed = DEFAULT_RANDOM_SEED;
+    mParameterRampLength = 0;
+    
+    for (int i = 0; i < RECORDED_PARAMETER_COUNT; i++) {
+        mRecordedParameterValues[i] = -1;
+    }
 }
 
 InfatuationAudioProcessor::~InfatuationAudioProcessor()
 {
-    if (mCircularBufferLeft != nullptr) {
-        delete[] mCircularBufferLeft;
-        mCircularBufferLeft = nullptr;
-    }
-    if (mCircularBufferRight != nullptr) {
-        delete[] mCircularBufferRight;
-        mCircularBufferRight = nullptr;
+    for (auto* parameter : getParameters()) {
+        parameter->removeListener(this);
     }
 }
 
+std::vector<std::unique_ptr<juce::RangedAudioParameter>> InfatuationAudioProcessor::createParameters()
+{
+    std::vector<std::unique_ptr<juce::RangedAudioParameter>> parameters;
+    
+    parameters.push_back(std::make_unique<juce::AudioParameterFloat>("drywet", "Dry Wet", 0.0, 1.0, 0.5));
+    parameters.push_back(std::make_unique<juce::AudioParameterFloat>("depth", "Depth", 0.0, 1.0, 0.5));
+    parameters.push_back(std::make_unique<juce::AudioParameterFloat>("rate", "Rate", 0.0, 1.0, 0.5));
+    parameters.push_back(std::make_unique<juce::AudioParameterFloat>("phaseoffset", "Phase Offset", 0.0, 1.0, 0.5));
+    parameters.push_back(std::make_unique<juce::AudioParameterFloat>("feedback", "Feedback", 0, 0.98, 0.5));
+    parameters.push_back(std::make_unique<juce::AudioParameterInt>("type", "Type", 0, 1, 0));
+    parameters.push_back(std::make_unique<juce::AudioParameterInt>("typeID", "TypeID", 1, 3, 1));
+    parameters.push_back(std::make_unique<juce::AudioParameterFloat>("delaytime", "Delay Time", 0.01, MAX_DELAY_TIME, 1.0));
+    parameters.push_back(std::make_unique<juce::AudioParameterFloat>("noiselevel", "Noise Level", 0.00, 1.00, 0));
+    parameters.push_back(std::make_unique<juce::AudioParameterInt>("waveType", "Wave Type", 0, 1, 0));
+    parameters.push_back(std::make_unique<juce::AudioParameterInt>("waveTypeID", "Wave TypeID", 1, 3, 1));
+    parameters.push_back(std::make_unique<juce::AudioParameterInt>("noiseType", "Noise Type", 0, 1, 0));
+    parameters.push_back(std::make_unique<juce::AudioParameterInt>("noiseTypeID", "Noise TypeID", 1, 3, 1));
+    parameters.push_back(std::make_unique<juce::AudioParameterInt>("quality", "Quality", 0, 3, 1));
+    parameters.push_back(std::make_unique<juce::AudioParameterInt>("qualityID", "QualityID", 1, 4, 2));
+    
+    return parameters;
+}
+
 //==============================================================================
 const juce::String InfatuationAudioProcessor::getName() const
 {
@@ -121,39 +160,67 @@ void InfatuationAudioProcessor::changeProgramName (int index, const juce::String
 //==============================================================================
 void InfatuationAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
+    // Use this method as the place to do any pre-playback
+    // initialisation that you need..
     
-    mLFOPhase = 0;
+    // auto starts from standard and works its way up or down from there,
+    // except offline, where it stays on high (see updateBlockLoad)
+    mAutoQuality = isNonRealtime() ? highQuality : standardQuality;
+    mBlockLoad = 0;
+    mLowLoadTime = 0;
     
-    mDelayTimeInSamples = sampleRate * *mDelayTimeParameter;
-    mCircularBufferLength = sampleRate * MAX_DELAY_TIME;
+    // a bus wider than stereo gets an engine for each further channel pair
+    int numChannels = getTotalNumInputChannels();
+    int numPairs = (numChannels > 2) ? (numChannels + 1) / 2 : 1;
     
-    // Use this method as the place to do any pre-playback
-    // initialisation that you need..
-
-    if (mCircularBufferLeft != nullptr ) {
-      delete [] mCircularBufferLeft;
-      mCircularBufferLeft = nullptr;
-   }
+    // kept when the layout hasn't changed, their delay memory with them
+    if (mPairEngines.size() != numPairs - 1) {
+        mPairEngines.clear();
+        
+        for (int pair = 1; pair < numPairs; pair++) {
+            mPairEngines.add(new InfatuationEngine())->setRandomSeed(mRandomSeed + pair);
+        }
+    }
+    
+    mOddChannelScratch.setSize(1, (numChannels > 2 && numChannels % 2 == 1) ? juce::jmax(1, samplesPerBlock) : 0);
     
-    if (mCircularBufferLeft == nullptr ) {
-        mCircularBufferLeft = new float[(int)mCircularBufferLength];
+    // knob moves and block-rate automation glide rather than click, and an
+    // offline render leaves the delay memory unlocked
+    bool isRealtime = ! isNonRealtime();
+    
+    mEngine.setSmoothing(INFATUATION_SMOOTHING_LINEAR, PARAMETER_SMOOTHING_TIME);
+    mEngine.setMemoryLocking(isRealtime);
+    
+    for (auto* engine : mPairEngines) {
+        engine->setSmoothing(INFATUATION_SMOOTHING_LINEAR, PARAMETER_SMOOTHING_TIME);
+        engine->setMemoryLocking(isRealtime);
     }
     
-    juce::zeromem(mCircularBufferLeft, mCircularBufferLength * sizeof(float));
+    updateEngineParameters();
+    mEngine.prepare(sampleRate, samplesPerBlock);
     
-    if (mCircularBufferRight != nullptr ) {
-        delete [] mCircularBufferRight;
-        mCircularBufferRight = nullptr;
+    for (auto* engine : mPairEngines) {
+        engine->prepare(sampleRate, samplesPerBlock);
     }
-         
-    if (mCircularBufferRight == nullptr ) {
-        mCircularBufferRight = new float[(int)mCircularBufferLength];
+    
+    updateWorkerPool();
+    
+    // left until now so that instances which never play don't pay for them,
+    // and nobody watches the stats of an offline render
+    mFlightRecorder.prepare();
+    
+    if (isRealtime) {
+        mStatsPublisher.open();
     }
     
-   juce:: zeromem(mCircularBufferRight, mCircularBufferLength * sizeof(float));
+    // every channel pair's engine has its own delay memory
+    juce::uint64 delayBufferBytes = mEngine.getDelayMemory().getNumBytesAllocated();
     
-    mCircularBufferWriteHead = 0;
-    mDelayTimeSmoothed = *mDelayTimeParameter;
+    for (auto* engine : mPairEngines) {
+        delayBufferBytes += engine->getDelayMemory().getNumBytesAllocated();
+    }
+    
+    mStatsPublisher.setDelayBufferBytes(delayBufferBytes);
 }
 
 void InfatuationAudioProcessor::releaseResources()
@@ -164,9 +231,26 @@ void InfatuationAudioProcessor::releaseResources()
 
 bool InfatuationAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const
 {
+    // the wet bus is optional, but when it's on it has a channel for each main output
+    if (layouts.outputBuses.size() > 1) {
+        auto wetChannelSet = layouts.getChannelSet(false, 1);
+        
+        if (! wetChannelSet.isDisabled() && wetChannelSet != layouts.getMainOutputChannelSet()) {
+            return false;
+        }
+    }
+    
     if (layouts.getMainInputChannelSet() == juce::AudioChannelSet::stereo() &&
         layouts.getMainOutputChannelSet() == juce::AudioChannelSet::stereo()) {
         return true;
+    }
+    
+    // wider buses, ambisonics for instance, are processed in channel pairs
+    int numChannels = layouts.getMainInputChannelSet().size();
+    
+    if (layouts.getMainInputChannelSet() == layouts.getMainOutputChannelSet() &&
+        numChannels > 2 && numChannels <= MAX_BUS_CHANNELS) {
+        return true;
     } else {
         return false;
     }
@@ -174,9 +258,18 @@ bool InfatuationAudioProcessor::isBusesLayoutSupported (const BusesLayout& layou
 
 void InfatuationAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
+    RealtimeSafetyChecker::ScopedRealtimeRegion realtimeRegion;
     juce::ScopedNoDenormals noDenormals;
     auto totalNumInputChannels  = getTotalNumInputChannels();
-    auto totalNumOutputChannels = getTotalNumOutputChannels();
+    auto totalNumOutputChannels = getMainBusNumOutputChannels();
+    
+    juce::int64 blockStartTicks = juce::Time::getHighResolutionTicks();
+    
+    bool countPageFaults = mCountPageFaults.load(std::memory_order_relaxed);
+    juce::int64 pageFaultsAtStart = countPageFaults ? DSPBuffer::getThreadPageFaults() : 0;
+    
+    mFlightRecorder.recordBlockStart(blockStartTicks, buffer.getNumSamples());
+    recordParameterChanges(blockStartTicks);
 
     // In case we have more outputs than inputs, this code clears any output
     // channels that didn't contain input data, (because these aren't
@@ -184,170 +277,254 @@ void InfatuationAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer,
     // This is here to avoid people getting screaming feedback
     // when they first compile a plugin, but obviously you don't need to keep
     // this code if your algorithm always overwrites all the output channels.
+    // The wet bus is always written in full, so only the main bus is cleared.
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear (i, 0, buffer.getNumSamples());
     
-    float* leftChannel = buffer.getWritePointer(0);
-    float* rightChannel = buffer.getWritePointer(0);
+    updateEngineParameters(mParameterRampLength);
+    mParameterRampLength = 0;
+    
+    mBusChannels = buffer.getArrayOfWritePointers();
+    mBusNumChannels = getMainBusNumOutputChannels();
+    mBusNumSamples = buffer.getNumSamples();
     
-    float noise;
+    // the wet bus's channels follow the main bus's in the buffer
+    auto* wetBus = getBus(false, 1);
     
-    if (*mNoiseTypeIDParam == 1) {
-        noise = (mRandom.nextFloat()) * *mNoiseLevelParameter;
-    } else if (*mNoiseTypeIDParam == 2) {
-        noise = (mRandom.nextFloat() * 2.0f - 1.0f) * *mNoiseLevelParameter;
-    } else if (*mNoiseTypeIDParam == 3) {
-        noise = (mRandom.nextFloat() * 0.5f - 0.25f) * *mNoiseLevelParameter;
+    if (wetBus != nullptr && wetBus->isEnabled()) {
+        mWetChannels = mBusChannels + wetBus->getChannelIndexInProcessBlockBuffer(0);
+    } else {
+        mWetChannels = nullptr;
     }
     
-    for (int i = 0; i < buffer.getNumSamples(); i++) {
-        
-        // LFO/phase starts
+    if (mPairEngines.isEmpty()) {
+        processChannelPair(0);
+    } else {
+        mWorkerPool.run(processChannelPairTask, this, 1 + mPairEngines.size());
+    }
+    
+    juce::int64 blockEndTicks = juce::Time::getHighResolutionTicks();
+    
+    if (buffer.getNumSamples() > 0) {
+        // fraction of the real-time budget for this block that we used up
+        double seconds = juce::Time::highResolutionTicksToSeconds(blockEndTicks - blockStartTicks);
+        double budget = buffer.getNumSamples() / getSampleRate();
+        float load = (float)(seconds / budget);
         
-        float delay_sample_left;
-        float delay_sample_right;
+        updateBlockLoad(load, budget);
         
-        if ((*mTypeIDParam == 2) || (*mTypeIDParam == 3)) {
-            
-            float lfoOutLeft;
-            if (*mWaveTypeIDParam == 1) {
-                lfoOutLeft = sin(2*M_PI * mLFOPhase);
-            } else if (*mWaveTypeIDParam == 2) {
-                lfoOutLeft = 2*mLFOPhase - 1;
-            } else if (*mWaveTypeIDParam == 3) {
-                lfoOutLeft = 4*fabs(mLFOPhase - 0.5);
-            }
-            
-            float lfoPhaseRight;
-            
-            if (*mTypeIDParam == 2) {
-                lfoPhaseRight = mLFOPhase + 0.5;
-            } else if (*mTypeIDParam == 3) {
-                lfoPhaseRight = mLFOPhase + *mPhaseOffsetParameter;
-            }
-            
-            if (lfoPhaseRight > 1)
-            {
-                lfoPhaseRight -= 1;
-            }
-            
-            float lfoOutRight;
-            if (*mWaveTypeIDParam == 1) {
-                lfoOutRight = sin(2*M_PI * lfoPhaseRight);
-            } else if (*mWaveTypeIDParam == 2) {
-                lfoOutRight = 2*lfoPhaseRight - 1;
-            } else if (*mWaveTypeIDParam == 3) {
-                lfoOutRight = 4*fabs(lfoPhaseRight - 0.5);
-            }
-            
-            lfoOutLeft *= *mDepthParameter;
-            lfoOutRight *= *mDepthParameter;
-            
-            float lfoOutMappedLeft = 0;
-            float lfoOutMappedRight = 0;
-            
-            if (*mTypeIDParam == 2)
-            {
-                lfoOutMappedLeft = juce::jmap((float)lfoOutLeft, -1.f, 1.f, 0.005f, 0.03f);
-                lfoOutMappedRight = juce::jmap((float)lfoOutRight, -1.f, 1.f, 0.005f, 0.03f);
-            } else if (*mTypeIDParam == 3)
-            {
-                lfoOutMappedLeft = juce::jmap((float)lfoOutLeft, -1.f, 1.f, 0.001f, 0.005f);
-                lfoOutMappedRight = juce::jmap((float)lfoOutRight, -1.f, 1.f, 0.001f, 0.005f);
-            }
-            
-            float delayTimeSamplesLeft = getSampleRate() * lfoOutMappedLeft;
-            float delayTimeSamplesRight = getSampleRate() * lfoOutMappedRight;
-            
-            mLFOPhase += *mRateParameter / getSampleRate();
-            
-            if (mLFOPhase > 1)
-            {
-                mLFOPhase -= 1;
-            }
-            
-            if (*mTypeIDParam == 2)
-            {
-                mCircularBufferLeft[mCircularBufferWriteHead] = leftChannel[i];
-                mCircularBufferRight[mCircularBufferWriteHead] = rightChannel[i];
-            } else if (*mTypeIDParam == 3) {
-                mCircularBufferLeft[mCircularBufferWriteHead] = leftChannel[i] + mFeedbackLeft;
-                mCircularBufferRight[mCircularBufferWriteHead] = rightChannel[i] + mFeedbackRight;
-            }
-            
-            float delayReadHeadLeft = mCircularBufferWriteHead - delayTimeSamplesLeft;
-            
-            if (delayReadHeadLeft < 0)
-            {
-                delayReadHeadLeft += mCircularBufferLength;
-            }
-            
-            float delayReadHeadRight = mCircularBufferWriteHead - delayTimeSamplesRight;
-            
-            if (delayReadHeadRight < 0)
-            {
-                delayReadHeadRight += mCircularBufferLength;
-            }
-            
-            int readHeadLeft_x = (int)delayReadHeadLeft;
-            int readHeadLeft_x1 = readHeadLeft_x + 1;
-            float readHeadFloatLeft = delayReadHeadLeft - readHeadLeft_x;
-            
-            if (readHeadLeft_x1 >= mCircularBufferLength)
-            {
-                readHeadLeft_x1 -= mCircularBufferLength;
-            }
-            
-            int readHeadRight_x = (int)delayReadHeadRight;
-            int readHeadRight_x1 = readHeadRight_x + 1;
-            float readHeadFloatRight = delayReadHeadRight - readHeadRight_x;
-            
-            if (readHeadRight_x1 >= mCircularBufferLength)
-            {
-                readHeadRight_x1 -= mCircularBufferLength;
-            }
-            
-            delay_sample_left = linearInterpolation(mCircularBufferLeft[readHeadLeft_x], mCircularBufferLeft[readHeadLeft_x1], readHeadFloatLeft);
-            delay_sample_right = linearInterpolation(mCircularBufferRight[readHeadRight_x], mCircularBufferRight[readHeadRight_x1], readHeadFloatRight);
-        } else if (*mTypeIDParam == 1)
-        {
-            mDelayTimeSmoothed = mDelayTimeSmoothed - 0.001 * (mDelayTimeSmoothed - *mDelayTimeParameter);
-            mDelayTimeInSamples = getSampleRate() * mDelayTimeSmoothed;
-            
-            mCircularBufferLeft[mCircularBufferWriteHead] = leftChannel[i] + mFeedbackLeft;
-            mCircularBufferRight[mCircularBufferWriteHead] = rightChannel[i] + mFeedbackRight;
-            
-            mDelayReadHead = mCircularBufferWriteHead - mDelayTimeInSamples;
-            
-            if (mDelayReadHead < 0) {
-                mDelayReadHead += mCircularBufferLength;
-            }
-            
-            int readHead_x = (int)mDelayReadHead;
-            int readHead_x1 = readHead_x + 1;
-            float readHeadFloat = mDelayReadHead - readHead_x;
-            
-            if (readHead_x1 >= mCircularBufferLength) {
-                readHead_x1 -= mCircularBufferLength;
-            }
-            
-            delay_sample_left = linearInterpolation(mCircularBufferLeft[readHead_x], mCircularBufferLeft[readHead_x1], readHeadFloat);
-            delay_sample_right = linearInterpolation(mCircularBufferRight[readHead_x], mCircularBufferRight[readHead_x1], readHeadFloat);
-        }
+        mFlightRecorder.recordBlockEnd(blockEndTicks, buffer.getNumSamples(), load);
         
-        // same as Infatuation
+        bool isIdle = buffer.getMagnitude(0, buffer.getNumSamples()) < IDLE_THRESHOLD;
+        mStatsPublisher.recordBlock((juce::uint64)(seconds * 1.0e9), load > 1.0f, *mTypeIDParam, isIdle);
         
-        mFeedbackLeft = delay_sample_left * *mFeedbackParameter;
-        mFeedbackRight = delay_sample_right * *mFeedbackParameter;
+        if (load > 1.0f) {
+            mFlightRecorder.recordOverrun(blockEndTicks, load);
+        }
+    }
+    
+    if (countPageFaults) {
+        mPageFaultsInProcessBlock.fetch_add(DSPBuffer::getThreadPageFaults() - pageFaultsAtStart, std::memory_order_relaxed);
+    }
+}
+
+void InfatuationAudioProcessor::processChannelPair(int pair)
+{
+    InfatuationEngine& engine = (pair == 0) ? mEngine : *mPairEngines.getUnchecked(pair - 1);
+    int left = 2 * pair;
+    int right = left + 1;
+    
+    // the wet bus is written by the same pass that mixes the main bus
+    if (mBusNumChannels == 2) {
+        // the left input feeds both delay lines, as it always has
+        engine.process(mBusChannels[0], mBusChannels[0], mBusChannels[0], mBusChannels[1], mBusNumSamples,
+                       getWetChannel(0), getWetChannel(1));
+    } else if (right < mBusNumChannels) {
+        engine.process(mBusChannels[left], mBusChannels[right], mBusChannels[left], mBusChannels[right], mBusNumSamples,
+                       getWetChannel(left), getWetChannel(right));
+    } else if (left < mBusNumChannels) {
+        // the odd channel out runs as a mono pair and its right output is dropped
+        float* scratch = mOddChannelScratch.getWritePointer(0);
+        int scratchLength = mOddChannelScratch.getNumSamples();
         
-        mCircularBufferWriteHead++;
+        for (int start = 0; start < mBusNumSamples; start += scratchLength) {
+            int length = juce::jmin(scratchLength, mBusNumSamples - start);
+            float* channel = mBusChannels[left] + start;
+            float* wetChannel = getWetChannel(left);
+            
+            juce::FloatVectorOperations::copy(scratch, channel, length);
+            engine.process(channel, channel, channel, scratch, length, (wetChannel != nullptr) ? wetChannel + start : nullptr);
+        }
+    }
+}
+
+float* InfatuationAudioProcessor::getWetChannel(int channel) const
+{
+    return (mWetChannels != nullptr) ? mWetChannels[channel] : nullptr;
+}
+
+void InfatuationAudioProcessor::processChannelPairTask(void* processor, int pair)
+{
+    // this may be a worker thread, which has its own floating-point modes
+    RealtimeSafetyChecker::ScopedRealtimeRegion realtimeRegion;
+    juce::ScopedNoDenormals noDenormals;
+    
+    static_cast<InfatuationAudioProcessor*>(processor)->processChannelPair(pair);
+}
+
+void InfatuationAudioProcessor::setNumWorkerThreads(int numWorkers)
+{
+    mNumWorkerThreads = juce::jlimit(0, MAX_WORKER_THREADS, numWorkers);
+    updateWorkerPool();
+}
+
+int InfatuationAudioProcessor::getNumWorkerThreads() const
+{
+    return mNumWorkerThreads;
+}
+
+juce::int64 InfatuationAudioProcessor::getNumInlineBlocks() const
+{
+    return (juce::int64)mWorkerPool.getNumInlineBlocks();
+}
+
+void InfatuationAudioProcessor::updateWorkerPool()
+{
+    // the audio thread takes a pair itself, so more workers than the other pairs would sit idle
+    int numWorkers = juce::jmin(mNumWorkerThreads, mPairEngines.size());
+    
+    if (numWorkers == mWorkerPool.getNumWorkers()) {
+        return;
+    }
+    
+    // holding the callback lock keeps processBlock out while the threads change
+    bool wasSuspended = isSuspended();
+    suspendProcessing(true);
+    
+    mWorkerPool.start(numWorkers);
+    
+    if (! wasSuspended) {
+        suspendProcessing(false);
+    }
+}
+
+void InfatuationAudioProcessor::recordParameterChanges(juce::int64 ticks)
+{
+    if (*mTypeIDParam != mRecordedTypeID) {
+        mRecordedTypeID = *mTypeIDParam;
+        mFlightRecorder.recordEffectType(ticks, mRecordedTypeID);
+    }
+    
+    if (*mWaveTypeIDParam != mRecordedWaveTypeID) {
+        mRecordedWaveTypeID = *mWaveTypeIDParam;
+        mFlightRecorder.recordWaveType(ticks, mRecordedWaveTypeID);
+    }
+    
+    auto& params = getParameters();
+    
+    for (int i = 0; i < juce::jmin(params.size(), (int)RECORDED_PARAMETER_COUNT); i++) {
+        float value = params.getUnchecked(i)->getValue();
         
-        buffer.setSample(0, i, (buffer.getSample(0, i) * (1 - *mDryWetParameter) + delay_sample_left * *mDryWetParameter) + noise);
-        buffer.setSample(1, i, (buffer.getSample(1, i) * (1 - *mDryWetParameter) + delay_sample_right * *mDryWetParameter) + noise);
+        if (value != mRecordedParameterValues[i]) {
+            mRecordedParameterValues[i] = value;
+            mFlightRecorder.recordParameter(ticks, i, value);
+        }
+    }
+}
+
+juce::uint32 InfatuationAudioProcessor::takeDirtyParameters()
+{
+    return mDirtyParameters.exchange(0, std::memory_order_acquire);
+}
+
+void InfatuationAudioProcessor::parameterValueChanged(int parameterIndex, float newValue)
+{
+    // a single atomic or, so it's safe wherever the host calls it from
+    mDirtyParameters.fetch_or(1u << parameterIndex, std::memory_order_release);
+}
+
+void InfatuationAudioProcessor::parameterGestureChanged(int parameterIndex, bool gestureIsStarting)
+{
+}
+
+FlightRecorder& InfatuationAudioProcessor::getFlightRecorder()
+{
+    return mFlightRecorder;
+}
+
+void InfatuationAudioProcessor::setPageFaultCounting(bool shouldCount)
+{
+    mCountPageFaults.store(shouldCount, std::memory_order_relaxed);
+}
+
+juce::int64 InfatuationAudioProcessor::getNumPageFaultsInProcessBlock() const
+{
+    return mPageFaultsInProcessBlock.load(std::memory_order_relaxed);
+}
+
+void InfatuationAudioProcessor::resetPageFaultCount()
+{
+    mPageFaultsInProcessBlock.store(0, std::memory_order_relaxed);
+}
+
+void InfatuationAudioProcessor::updateEngineParameters(int rampLength)
+{
+    InfatuationParams parameters;
+    
+    parameters.effectType = *mTypeIDParam;
+    parameters.waveType = *mWaveTypeIDParam;
+    parameters.noiseType = *mNoiseTypeIDParam;
+    parameters.quality = (*mQualityIDParam == autoQuality) ? mAutoQuality : (int)*mQualityIDParam;
+    
+    parameters.dryWet = *mDryWetParameter;
+    parameters.depth = *mDepthParameter;
+    parameters.rate = *mRateParameter;
+    parameters.phaseOffset = *mPhaseOffsetParameter;
+    parameters.feedback = *mFeedbackParameter;
+    parameters.delayTime = *mDelayTimeParameter;
+    parameters.noiseLevel = *mNoiseLevelParameter;
+    
+    mEngine.setParameters(parameters, rampLength);
+    
+    for (auto* engine : mPairEngines) {
+        engine->setParameters(parameters, rampLength);
+    }
+}
+
+void InfatuationAudioProcessor::updateBlockLoad(float load, double budget)
+{
+    // an offline render has no deadline to keep and has to come out the same
+    // every time, in every chunk, so the wall-clock load doesn't pick a tier
+    if (isNonRealtime()) {
+        mAutoQuality = highQuality;
+        return;
+    }
+    
+    mBlockLoad = mBlockLoad + 0.1f * (load - mBlockLoad);
+    
+    if (*mQualityIDParam != autoQuality) {
+        // switching to Auto carries on from the tier that was last picked
+        mAutoQuality = *mQualityIDParam;
+        mLowLoadTime = 0;
+        return;
+    }
+    
+    // step down straight away before the host starts dropping out, but only
+    // step back up once the load has stayed low for a while
+    
+    if (mBlockLoad > AUTO_QUALITY_MAX_LOAD && mAutoQuality > ecoQuality) {
+        mAutoQuality--;
+        mBlockLoad = 0;
+        mLowLoadTime = 0;
+    } else if (mBlockLoad < AUTO_QUALITY_MIN_LOAD && mAutoQuality < highQuality) {
+        mLowLoadTime += budget;
         
-        if (mCircularBufferWriteHead >= mCircularBufferLength) {
-            mCircularBufferWriteHead = 0;
+        if (mLowLoadTime > AUTO_QUALITY_HOLD_TIME) {
+            mAutoQuality++;
+            mLowLoadTime = 0;
         }
+    } else {
+        mLowLoadTime = 0;
     }
 }
 
@@ -379,6 +556,9 @@ void InfatuationAudioProcessor::getStateInformation (juce::MemoryBlock& destData
     xml->setAttribute("WaveTypeID", *mWaveTypeIDParam);
     xml->setAttribute("NoiseType", *mNoiseTypeParameter);
     xml->setAttribute("NoiseTypeID", *mNoiseTypeIDParam);
+    xml->setAttribute("Quality", *mQualityParameter);
+    xml->setAttribute("QualityID", *mQualityIDParam);
+    xml->setAttribute("WorkerThreads", mNumWorkerThreads);
     
     copyXmlToBinary(*xml, destData);
 }
@@ -403,6 +583,10 @@ void InfatuationAudioProcessor::setStateInformation (const void* data, int sizeI
         *mWaveTypeIDParam = xml->getIntAttribute("WaveTypeID");
         *mNoiseTypeParameter = xml->getIntAttribute("NoiseType");
         *mNoiseTypeIDParam = xml->getIntAttribute("NoiseTypeID");
+        *mQualityParameter = xml->getIntAttribute("Quality", standardQuality - 1);
+        *mQualityIDParam = xml->getIntAttribute("QualityID", standardQuality);
+        
+        setNumWorkerThreads(xml->getIntAttribute("WorkerThreads", 0));
     }
 }
 
@@ -413,6 +597,34 @@ juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
     return new InfatuationAudioProcessor();
 }
 
-float InfatuationAudioProcessor::linearInterpolation(float sample_r, float sample_x1, float inPhase) {
-    return (1 - inPhase) * sample_r + inPhase * sample_x1;
+void InfatuationAudioProcessor::setRandomSeed(juce::int64 newSeed) {
+    mRandomSeed = newSeed;
+    mEngine.setRandomSeed(newSeed);
+    
+    // each further pair gets its own noise
+    for (int pair = 1; pair <= mPairEngines.size(); pair++) {
+        mPairEngines.getUnchecked(pair - 1)->setRandomSeed(newSeed + pair);
+    }
+}
+
+juce::int64 InfatuationAudioProcessor::advanceRandomSeed(juce::int64 seed, juce::int64 numSteps) {
+    return InfatuationEngine::advanceRandomSeed(seed, numSteps);
+}
+
+void InfatuationAudioProcessor::setRenderPosition(juce::int64 samplePosition) {
+    updateEngineParameters();
+    mEngine.setRenderPosition(samplePosition);
+    
+    for (auto* engine : mPairEngines) {
+        engine->setRenderPosition(samplePosition);
+    }
+}
+
+juce::int64 InfatuationAudioProcessor::getStateMemoryInSamples(float errorBound) {
+    updateEngineParameters();
+    return mEngine.getStateMemoryInSamples(errorBound);
+}
+
+void InfatuationAudioProcessor::setParameterRamp(int numSamples) {
+    mParameterRampLength = juce::jmax(0, numSamples);
 }
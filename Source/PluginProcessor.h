@@ -9,13 +9,28 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "Core/InfatuationEngine.h"
+#include "Core/WorkerPool.h"
+#include "FlightRecorder.h"
+#include "StatsPublisher.h"
 
-#define MAX_DELAY_TIME 2
+#define AUTO_QUALITY_MAX_LOAD 0.25f
+#define AUTO_QUALITY_MIN_LOAD 0.05f
+#define AUTO_QUALITY_HOLD_TIME 2.0
+
+#define PARAMETER_SMOOTHING_TIME 0.02
+
+#define RECORDED_PARAMETER_COUNT 16
+#define IDLE_THRESHOLD 1.0e-6f
+
+#define MAX_BUS_CHANNELS 64
+#define MAX_WORKER_THREADS 8
 
 //==============================================================================
 /**
 */
-class InfatuationAudioProcessor  : public juce::AudioProcessor
+class InfatuationAudioProcessor  : public juce::AudioProcessor,
+                                   private juce::AudioProcessorParameter::Listener
 {
 public:
     //==============================================================================
@@ -55,11 +70,114 @@ public:
     void getStateInformation (juce::MemoryBlock& destData) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
     
-    float linearInterpolation(float sample_r, float sample_x1, float inPhase);
+    // Values of the qualityID parameter. Eco runs the LFO at control rate,
+    // High uses cubic interpolation and a second chorus voice, Auto moves
+    // between the three depending on how much of the block budget we use,
+    // or stays on High when the processor is set to non-realtime.
+    enum QualityID
+    {
+        ecoQuality = 1,
+        standardQuality,
+        highQuality,
+        autoQuality
+    };
+    
+    // Positions in getParameters(). Each choice has an index parameter with
+    // its ID parameter straight after it.
+    enum ParameterIndex
+    {
+        dryWetIndex,
+        depthIndex,
+        rateIndex,
+        phaseOffsetIndex,
+        feedbackIndex,
+        typeIndex,
+        typeIDIndex,
+        delayTimeIndex,
+        noiseLevelIndex,
+        waveTypeIndex,
+        waveTypeIDIndex,
+        noiseTypeIndex,
+        noiseTypeIDIndex,
+        qualityIndex,
+        qualityIDIndex,
+        numParameters
+    };
+    
+    // The parameters in getParameters() order, for reading their IDs and
+    // ranges without creating a processor.
+    static std::vector<std::unique_ptr<juce::RangedAudioParameter>> createParameters();
+    
+    // Bit i is set once parameter i changes, whoever changed it (host
+    // automation, setStateInformation or the editor), and cleared by this
+    // call. Any number of changes between two calls show up as one bit, so
+    // the editor can poll it once a frame instead of being sent a message
+    // for every change.
+    juce::uint32 takeDirtyParameters();
+    
+    // The noise generator is reseeded with this value on every prepareToPlay,
+    // so two renders of the same input produce the same output.
+    void setRandomSeed(juce::int64 newSeed);
+    
+    // Returns the state of the noise generator seeded with seed after
+    // numSteps values, without generating the values in between.
+    static juce::int64 advanceRandomSeed(juce::int64 seed, juce::int64 numSteps);
+    
+    // Moves the LFO phase, the noise generator and the delay line's write head
+    // to where they would be after samplePosition samples of playback since
+    // prepareToPlay. What the delay line holds is not touched; it has to be
+    // warmed up by processing some audio.
+    void setRenderPosition(juce::int64 samplePosition);
+    
+    // Number of samples after which the delay line and feedback path have
+    // forgotten their input to within errorBound, for the current parameters.
+    juce::int64 getStateMemoryInSamples(float errorBound);
+    
+    // For rendering automation offline. The next processBlock moves the
+    // continuous parameters in a straight line from their values in the last
+    // block to their current ones over numSamples samples, instead of jumping
+    // at its start; the ramp carries on through the blocks after it. Call it
+    // from the thread that calls processBlock.
+    void setParameterRamp(int numSamples);
+    
+    // What the audio thread did recently, for dumping after a glitch.
+    FlightRecorder& getFlightRecorder();
+    
+    // Counts the page faults the audio thread takes inside processBlock, so
+    // the pre-faulted delay memory can be checked on a real host. Off by
+    // default, since reading the fault counters costs a system call per block.
+    // Only Linux reports faults per thread; elsewhere the count stays at 0.
+    void setPageFaultCounting(bool shouldCount);
+    juce::int64 getNumPageFaultsInProcessBlock() const;
+    void resetPageFaultCount();
+    
+    // Buses wider than stereo run one engine per channel pair. With worker
+    // threads set, the pairs are shared between them and the audio thread
+    // each block; 0 (the default) processes every pair on the audio thread.
+    // Starts or stops threads, so not for the audio thread.
+    void setNumWorkerThreads(int numWorkers);
+    int getNumWorkerThreads() const;
+    
+    // Blocks in which the workers were too late to take any of the pairs.
+    juce::int64 getNumInlineBlocks() const;
     
 
 private:
     
+    // Copies the parameter values into the engine, with Auto quality
+    // resolved to the tier the load monitor has picked
+    void updateEngineParameters(int rampLength = 0);
+    void updateWorkerPool();
+    void processChannelPair(int pair);
+    float* getWetChannel(int channel) const;
+    static void processChannelPairTask(void* processor, int pair);
+    void updateBlockLoad(float load, double budget);
+    void recordParameterChanges(juce::int64 ticks);
+    
+    // called on whichever thread changed the value, the audio thread included
+    void parameterValueChanged(int parameterIndex, float newValue) override;
+    void parameterGestureChanged(int parameterIndex, bool gestureIsStarting) override;
+    
     juce::AudioParameterFloat* mDryWetParameter;
     juce::AudioParameterFloat* mDepthParameter;
     juce::AudioParameterFloat* mRateParameter;
@@ -74,23 +192,36 @@ private:
     juce::AudioParameterInt* mWaveTypeIDParam;
     juce::AudioParameterInt* mNoiseTypeParameter;
     juce::AudioParameterInt* mNoiseTypeIDParam;
+    juce::AudioParameterInt* mQualityParameter;
+    juce::AudioParameterInt* mQualityIDParam;
     
-    float mDryWet;
-    float mLFOPhase;
+    InfatuationEngine mEngine;
     
-    float mFeedbackLeft;
-    float mFeedbackRight;
+    // the pairs after the first on a wide bus, and the block being processed,
+    // with the wet bus's channels if it's enabled
+    juce::OwnedArray<InfatuationEngine> mPairEngines;
+    WorkerPool mWorkerPool;
+    int mNumWorkerThreads;
+    float* const* mBusChannels;
+    float* const* mWetChannels;
+    int mBusNumChannels;
+    int mBusNumSamples;
+    juce::AudioBuffer<float> mOddChannelScratch;
+    juce::int64 mRandomSeed;
+    int mParameterRampLength;
     
-    float mDelayReadHead;
-    float mDelayTimeInSamples;
-    float mDelayTimeSmoothed;
-
-    int mCircularBufferLength;
-    int mCircularBufferWriteHead;
-    float* mCircularBufferLeft;
-    float* mCircularBufferRight;
+    int mAutoQuality;
+    float mBlockLoad;
+    double mLowLoadTime;
     
-    juce::Random mRandom;
+    FlightRecorder mFlightRecorder;
+    StatsPublisher mStatsPublisher;
+    std::atomic<bool> mCountPageFaults { false };
+    std::atomic<juce::int64> mPageFaultsInProcessBlock { 0 };
+    std::atomic<juce::uint32> mDirtyParameters { 0 };
+    int mRecordedTypeID;
+    int mRecordedWaveTypeID;
+    float mRecordedParameterValues[RECORDED_PARAMETER_COUNT];
     
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (InfatuationAudioProcessor)
@@ -0,0 +1,257 @@
+/*
+  ==============================================================================
+
+    RealtimeSafetyChecker.cpp
+
+  ==============================================================================
+*/
+
+#include "RealtimeSafetyChecker.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+
+#if INFATUATION_REALTIME_CHECKS && defined (__linux__)
+ #include <dlfcn.h>
+ #include <execinfo.h>
+ #include <pthread.h>
+ #include <semaphore.h>
+ #include <unistd.h>
+ #include <time.h>
+#endif
+
+namespace RealtimeSafetyChecker
+{
+    static std::atomic<int> numViolations { 0 };
+    static std::atomic<bool> abortOnViolation { false };
+
+    int getNumViolations() noexcept
+    {
+        return numViolations.load();
+    }
+
+    void resetViolations() noexcept
+    {
+        numViolations = 0;
+    }
+
+    void setAbortOnViolation (bool shouldAbort) noexcept
+    {
+        abortOnViolation = shouldAbort;
+    }
+}
+
+#if INFATUATION_REALTIME_CHECKS && ! defined (__linux__)
+
+namespace RealtimeSafetyChecker
+{
+    // nothing to interpose on this platform, the regions are just counted
+    static thread_local int realtimeDepth = 0;
+
+    void enterRealtimeRegion() noexcept     { ++realtimeDepth; }
+    void exitRealtimeRegion() noexcept      { --realtimeDepth; }
+}
+
+#elif INFATUATION_REALTIME_CHECKS && defined (__linux__)
+
+extern "C"
+{
+    // glibc's own entry points, so forwarding malloc doesn't need dlsym,
+    // which allocates
+    void* __libc_malloc (size_t);
+    void* __libc_calloc (size_t, size_t);
+    void* __libc_realloc (void*, size_t);
+    void __libc_free (void*);
+}
+
+namespace RealtimeSafetyChecker
+{
+    // initial-exec TLS, so reading these from inside malloc can't allocate
+    static __thread int realtimeDepth __attribute__ ((tls_model ("initial-exec")));
+    static __thread bool isReporting __attribute__ ((tls_model ("initial-exec")));
+
+    // The real functions behind the replacements. They are looked up once
+    // while the program loads, not on first use: a function-local static
+    // would take the C++ runtime's initialisation guard, which can itself
+    // lock a mutex, from inside pthread_mutex_lock.
+    struct RealFunctions
+    {
+        int (*mutexLock) (pthread_mutex_t*);
+        int (*condWait) (pthread_cond_t*, pthread_mutex_t*);
+        int (*semWait) (sem_t*);
+        int (*nanoSleep) (const struct timespec*, struct timespec*);
+        int (*microSleep) (useconds_t);
+        ssize_t (*readFile) (int, void*, size_t);
+        ssize_t (*writeFile) (int, const void*, size_t);
+    };
+
+    static RealFunctions real;
+
+    static void resolveRealFunctions() noexcept
+    {
+        real.mutexLock = (decltype (real.mutexLock)) dlsym (RTLD_NEXT, "pthread_mutex_lock");
+        real.condWait = (decltype (real.condWait)) dlsym (RTLD_NEXT, "pthread_cond_wait");
+        real.semWait = (decltype (real.semWait)) dlsym (RTLD_NEXT, "sem_wait");
+        real.nanoSleep = (decltype (real.nanoSleep)) dlsym (RTLD_NEXT, "nanosleep");
+        real.microSleep = (decltype (real.microSleep)) dlsym (RTLD_NEXT, "usleep");
+        real.readFile = (decltype (real.readFile)) dlsym (RTLD_NEXT, "read");
+        real.writeFile = (decltype (real.writeFile)) dlsym (RTLD_NEXT, "write");
+    }
+
+    // Runs before main and before this executable's static constructors.
+    // The libraries it loads initialise earlier still, so a replacement
+    // called from one of them resolves the functions itself; that can only
+    // happen during startup, never on the audio thread.
+    __attribute__ ((constructor (101))) static void installChecker() noexcept
+    {
+        if (real.writeFile == nullptr)
+            resolveRealFunctions();
+
+        // backtrace() loads libgcc the first time it runs, which allocates
+        void* frame;
+        backtrace (&frame, 1);
+    }
+
+    static inline const RealFunctions& getRealFunctions() noexcept
+    {
+        if (__builtin_expect (real.writeFile == nullptr, 0))
+            resolveRealFunctions();
+
+        return real;
+    }
+
+    void enterRealtimeRegion() noexcept
+    {
+        ++realtimeDepth;
+    }
+
+    void exitRealtimeRegion() noexcept
+    {
+        --realtimeDepth;
+    }
+
+    static inline bool isViolation() noexcept
+    {
+        return realtimeDepth > 0 && ! isReporting;
+    }
+
+    static void reportViolation (const char* functionName) noexcept
+    {
+        isReporting = true;
+        ++numViolations;
+
+        static const char prefix[] = "Infatuation: ";
+        static const char suffix[] = " called on the audio thread\n";
+
+        auto& functions = getRealFunctions();
+        functions.writeFile (STDERR_FILENO, prefix, sizeof (prefix) - 1);
+        functions.writeFile (STDERR_FILENO, functionName, strlen (functionName));
+        functions.writeFile (STDERR_FILENO, suffix, sizeof (suffix) - 1);
+
+        void* frames[64];
+        int numFrames = backtrace (frames, 64);
+        backtrace_symbols_fd (frames, numFrames, STDERR_FILENO);
+
+        if (abortOnViolation)
+            abort();
+
+        isReporting = false;
+    }
+}
+
+//==============================================================================
+using namespace RealtimeSafetyChecker;
+
+extern "C"
+{
+    void* malloc (size_t size) noexcept
+    {
+        if (isViolation())
+            reportViolation ("malloc");
+
+        return __libc_malloc (size);
+    }
+
+    void* calloc (size_t numElements, size_t elementSize) noexcept
+    {
+        if (isViolation())
+            reportViolation ("calloc");
+
+        return __libc_calloc (numElements, elementSize);
+    }
+
+    void* realloc (void* pointer, size_t size) noexcept
+    {
+        if (isViolation())
+            reportViolation ("realloc");
+
+        return __libc_realloc (pointer, size);
+    }
+
+    void free (void* pointer) noexcept
+    {
+        if (pointer != nullptr && isViolation())
+            reportViolation ("free");
+
+        __libc_free (pointer);
+    }
+
+    int pthread_mutex_lock (pthread_mutex_t* mutex) noexcept
+    {
+        if (isViolation())
+            reportViolation ("pthread_mutex_lock");
+
+        return getRealFunctions().mutexLock (mutex);
+    }
+
+    int pthread_cond_wait (pthread_cond_t* condition, pthread_mutex_t* mutex)
+    {
+        if (isViolation())
+            reportViolation ("pthread_cond_wait");
+
+        return getRealFunctions().condWait (condition, mutex);
+    }
+
+    int sem_wait (sem_t* semaphore)
+    {
+        if (isViolation())
+            reportViolation ("sem_wait");
+
+        return getRealFunctions().semWait (semaphore);
+    }
+
+    int nanosleep (const struct timespec* duration, struct timespec* remaining)
+    {
+        if (isViolation())
+            reportViolation ("nanosleep");
+
+        return getRealFunctions().nanoSleep (duration, remaining);
+    }
+
+    int usleep (useconds_t microseconds)
+    {
+        if (isViolation())
+            reportViolation ("usleep");
+
+        return getRealFunctions().microSleep (microseconds);
+    }
+
+    ssize_t read (int fileDescriptor, void* destination, size_t numBytes)
+    {
+        if (isViolation())
+            reportViolation ("read");
+
+        return getRealFunctions().readFile (fileDescriptor, destination, numBytes);
+    }
+
+    ssize_t write (int fileDescriptor, const void* source, size_t numBytes)
+    {
+        if (isViolation())
+            reportViolation ("write");
+
+        return getRealFunctions().writeFile (fileDescriptor, source, numBytes);
+    }
+}
+
+#endif
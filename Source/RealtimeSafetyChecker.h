@@ -0,0 +1,58 @@
+/*
+  ==============================================================================
+
+    RealtimeSafetyChecker.h
+
+    Debug aid that catches allocations, locks and blocking system calls made
+    from inside processBlock. Build with INFATUATION_REALTIME_CHECKS=1 to turn
+    it on; otherwise everything here compiles away.
+
+    On Linux the checker replaces malloc, calloc, realloc, free,
+    pthread_mutex_lock, pthread_cond_wait, sem_wait, nanosleep, usleep, read
+    and write. operator new and delete go through malloc and free, so they
+    are caught too. A call made while the calling thread is inside a
+    ScopedRealtimeRegion is counted and reported with a stack trace.
+
+    The replacements only take effect in executables that link this file
+    directly. infatuation-startup builds with the checks on and fails if its
+    first blocks make any such call, and infatuation-test runs every engine
+    block of the core inside a region. A plugin that a host dlopens can't
+    override the host's malloc; preload a build with the checks enabled
+    instead. Nothing here depends on JUCE, so the core's tools can use it.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#ifndef INFATUATION_REALTIME_CHECKS
+ #define INFATUATION_REALTIME_CHECKS 0
+#endif
+
+namespace RealtimeSafetyChecker
+{
+   #if INFATUATION_REALTIME_CHECKS
+    void enterRealtimeRegion() noexcept;
+    void exitRealtimeRegion() noexcept;
+   #else
+    inline void enterRealtimeRegion() noexcept {}
+    inline void exitRealtimeRegion() noexcept {}
+   #endif
+
+    // Number of violations seen since the last reset, on any thread.
+    int getNumViolations() noexcept;
+    void resetViolations() noexcept;
+
+    // Abort on the first violation instead of just reporting it, so a
+    // regression takes the test binary down with the offending stack.
+    void setAbortOnViolation (bool shouldAbort) noexcept;
+
+    struct ScopedRealtimeRegion
+    {
+        ScopedRealtimeRegion() noexcept     { enterRealtimeRegion(); }
+        ~ScopedRealtimeRegion() noexcept    { exitRealtimeRegion(); }
+
+        ScopedRealtimeRegion (const ScopedRealtimeRegion&) = delete;
+        ScopedRealtimeRegion& operator= (const ScopedRealtimeRegion&) = delete;
+    };
+}
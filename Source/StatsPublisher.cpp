@@ -0,0 +1,112 @@
+/*
+  ==============================================================================
+
+    StatsPublisher.cpp
+
+  ==============================================================================
+*/
+
+#include "StatsPublisher.h"
+
+#if JUCE_LINUX || JUCE_MAC
+ #include <fcntl.h>
+ #include <sys/mman.h>
+ #include <unistd.h>
+#endif
+
+//==============================================================================
+StatsPublisher::StatsPublisher()
+{
+}
+
+StatsPublisher::~StatsPublisher()
+{
+   #if JUCE_LINUX || JUCE_MAC
+    if (mSegment != nullptr)
+    {
+        munmap (mSegment, sizeof (InfatuationStatsSegment));
+        shm_unlink (mName.toRawUTF8());
+    }
+   #endif
+}
+
+void StatsPublisher::open()
+{
+    if (mHasOpened)
+        return;
+
+    mHasOpened = true;
+
+   #if JUCE_LINUX || JUCE_MAC
+    static std::atomic<int> nextInstanceId { 0 };
+
+    int processId = (int) getpid();
+    int instanceId = nextInstanceId++;
+
+    mName = "/" INFATUATION_STATS_PREFIX + juce::String (processId) + "." + juce::String (instanceId);
+
+    int fileDescriptor = shm_open (mName.toRawUTF8(), O_CREAT | O_RDWR | O_TRUNC, 0644);
+
+    if (fileDescriptor < 0)
+    {
+        DBG ("Couldn't create stats segment " << mName);
+        return;
+    }
+
+    if (ftruncate (fileDescriptor, sizeof (InfatuationStatsSegment)) == 0)
+    {
+        void* address = mmap (nullptr, sizeof (InfatuationStatsSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fileDescriptor, 0);
+
+        if (address != MAP_FAILED)
+        {
+            // the region comes back zeroed, so only the header needs filling in
+            mSegment = static_cast<InfatuationStatsSegment*> (address);
+            mSegment->processId = processId;
+            mSegment->instanceId = instanceId;
+            mSegment->version = INFATUATION_STATS_VERSION;
+
+            std::atomic_thread_fence (std::memory_order_release);
+            mSegment->magic = INFATUATION_STATS_MAGIC;
+        }
+    }
+
+    close (fileDescriptor);
+
+    if (mSegment == nullptr)
+        shm_unlink (mName.toRawUTF8());
+   #endif
+}
+
+bool StatsPublisher::isPublishing() const noexcept
+{
+    return mSegment != nullptr;
+}
+
+void StatsPublisher::setDelayBufferBytes (juce::uint64 numBytes) noexcept
+{
+    if (mSegment != nullptr)
+        mSegment->delayBufferBytes.store (numBytes, std::memory_order_relaxed);
+}
+
+void StatsPublisher::recordBlock (juce::uint64 nanoseconds, bool isOverrun, int effectType, bool isIdle) noexcept
+{
+    if (mSegment == nullptr)
+        return;
+
+    auto& segment = *mSegment;
+    auto relaxed = std::memory_order_relaxed;
+
+    segment.totalBlockNanoseconds.store (segment.totalBlockNanoseconds.load (relaxed) + nanoseconds, relaxed);
+
+    if (nanoseconds > segment.maxBlockNanoseconds.load (relaxed))
+        segment.maxBlockNanoseconds.store (nanoseconds, relaxed);
+
+    if (isOverrun)
+        segment.overrunCount.store (segment.overrunCount.load (relaxed) + 1, relaxed);
+
+    segment.effectType.store (effectType, relaxed);
+    segment.isIdle.store (isIdle ? 1 : 0, relaxed);
+
+    // last, so a reader that sees the new count sees the rest of the block
+    segment.blockCount.store (segment.blockCount.load (relaxed) + 1, std::memory_order_release);
+}
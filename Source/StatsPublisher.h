@@ -0,0 +1,48 @@
+/*
+  ==============================================================================
+
+    StatsPublisher.h
+
+    Creates an instance's shared-memory stats segment (see StatsSegment.h)
+    and updates it from the audio thread. On platforms without POSIX shared
+    memory, or if the region can't be created, every call is a no-op.
+
+    The segment is only created once the instance is first prepared, so the
+    ones a host makes and never plays (plugin scans, disabled tracks in a
+    template) cost no system calls and leave nothing in /dev/shm.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "StatsSegment.h"
+
+//==============================================================================
+/**
+*/
+class StatsPublisher
+{
+public:
+    StatsPublisher();
+    ~StatsPublisher();
+
+    // Creates the segment the first time it's called. Not for the audio thread.
+    void open();
+
+    bool isPublishing() const noexcept;
+
+    void setDelayBufferBytes (juce::uint64 numBytes) noexcept;
+
+    // Audio thread only: the counters have a single writer, so these are
+    // plain loads and stores rather than read-modify-writes.
+    void recordBlock (juce::uint64 nanoseconds, bool isOverrun, int effectType, bool isIdle) noexcept;
+
+private:
+    InfatuationStatsSegment* mSegment = nullptr;
+    juce::String mName;
+    bool mHasOpened = false;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (StatsPublisher)
+};
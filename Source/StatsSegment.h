@@ -0,0 +1,69 @@
+/*
+  ==============================================================================
+
+    StatsSegment.h
+
+    Layout of the POSIX shared-memory region each Infatuation instance
+    publishes its health counters in. This header doesn't depend on JUCE so
+    that external monitors (see Tools/infatuation-stat) can include it.
+
+    Each instance creates one region named
+
+        /infatuation.<pid>.<instance>
+
+    (visible as /dev/shm/infatuation.<pid>.<instance> on Linux) and unlinks
+    it when the instance is destroyed. All fields are little-endian, the
+    region is 64 bytes long:
+
+        offset  size  field
+        0       4     magic                  INFATUATION_STATS_MAGIC
+        4       4     version                INFATUATION_STATS_VERSION
+        8       4     processId
+        12      4     instanceId
+        16      8     blockCount             blocks processed
+        24      8     overrunCount           blocks that took longer than numSamples / sampleRate
+        32      8     totalBlockNanoseconds  divide by blockCount for the average
+        40      8     maxBlockNanoseconds
+        48      8     delayBufferBytes       bytes allocated for the delay lines,
+                                             of every channel pair
+        56      4     effectType             1 delay, 2 chorus, 3 flanger
+        60      4     isIdle                 1 if the last block's output was silent
+
+    The audio thread is the only writer and only ever does plain atomic
+    stores, so readers may see a field a block ahead of another but never a
+    torn value.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#define INFATUATION_STATS_MAGIC 0x54464e49  // "INFT"
+#define INFATUATION_STATS_VERSION 1
+#define INFATUATION_STATS_PREFIX "infatuation."
+
+struct InfatuationStatsSegment
+{
+    uint32_t magic;
+    uint32_t version;
+    int32_t processId;
+    int32_t instanceId;
+
+    std::atomic<uint64_t> blockCount;
+    std::atomic<uint64_t> overrunCount;
+    std::atomic<uint64_t> totalBlockNanoseconds;
+    std::atomic<uint64_t> maxBlockNanoseconds;
+    std::atomic<uint64_t> delayBufferBytes;
+
+    std::atomic<int32_t> effectType;
+    std::atomic<int32_t> isIdle;
+};
+
+static_assert (sizeof (InfatuationStatsSegment) == 64, "InfatuationStatsSegment layout changed");
+static_assert (offsetof (InfatuationStatsSegment, blockCount) == 16, "InfatuationStatsSegment layout changed");
+static_assert (offsetof (InfatuationStatsSegment, effectType) == 56, "InfatuationStatsSegment layout changed");
+static_assert (std::atomic<uint64_t>::is_always_lock_free, "shared counters have to be lock-free to work across processes");
@@ -0,0 +1,702 @@
+/*
+  ==============================================================================
+
+    infatuation-bench
+
+    Measures the core's throughput. Renders the same noise through a number
+    of separate engines at Eco quality and through one batch engine, checks
+    that every stream comes out the same, and prints how many streams each
+    runs per core in real time.
+
+        c++ -std=c++17 -O2 Tools/infatuation-bench/Main.cpp Source/Core/DSPBuffer.cpp \
+            Source/Core/DSPKernels.cpp Source/Core/InfatuationBatchEngine.cpp \
+            Source/Core/InfatuationCore.cpp Source/Core/InfatuationEngine.cpp \
+            Source/Core/MappedFile.cpp Source/Core/WorkerPool.cpp -o infatuation-bench -pthread
+
+        infatuation-bench --streams 64 --type flanger
+
+    Each stream gets its own parameters and seed, so the lanes of a batch
+    don't all take the same path through the delay lines.
+
+    With --bus it instead times one wide bus, an engine per channel pair as
+    the plugin runs it, on the calling thread alone and then shared with a
+    WorkerPool, for bus widths from 2 to 64 channels:
+
+        infatuation-bench --bus --workers 3 --block 64
+
+    With --soak it plays host instead: one callback per block runs every
+    instance in turn, each with its own engine, I/O buffers, random effect
+    type, quality and wave, and parameters that keep changing as automation
+    would. It goes through instance counts from 1 to 1000 (or only the one
+    given with --instances) for --seconds of audio each, and prints the CPU
+    time per block, resident memory, the worst block and, where Linux lets
+    us open the counter, last-level cache misses per sample:
+
+        infatuation-bench --soak --seconds 120 --block 128
+
+  ==============================================================================
+*/
+
+#include "../../Source/Core/InfatuationCore.h"
+#include "../../Source/Core/InfatuationEngine.h"
+#include "../../Source/Core/WorkerPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined (__linux__)
+ #include <linux/perf_event.h>
+ #include <sys/ioctl.h>
+ #include <sys/syscall.h>
+ #include <unistd.h>
+#endif
+
+#if ! defined (_WIN32)
+ #include <sys/resource.h>
+#endif
+
+#define SOAK_CHANGE_INTERVAL 0.5
+#define SOAK_SMOOTHING_TIME 0.02
+
+//==============================================================================
+struct Options
+{
+    double sampleRate = 48000;
+    int blockSize = 256;
+    int numStreams = 64;
+    double seconds = 10;
+    int effectType = INFATUATION_FLANGER;
+    bool isBusBenchmark = false;
+    bool isSoakBenchmark = false;
+    int numInstances = 0;
+    int numWorkers = -1;
+};
+
+struct StreamBuffers
+{
+    std::vector<float> inLeft, inRight, outLeft, outRight;
+};
+
+static void fillWithNoise (std::vector<float>& buffer, unsigned int seed)
+{
+    for (auto& sample : buffer)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        sample = (float) (seed >> 8) / (float) (1 << 24) - 0.5f;
+    }
+}
+
+// Spread across the useful range of each parameter, differently per stream
+static InfatuationParams getStreamParams (int stream, int effectType)
+{
+    InfatuationParams params;
+    infatuation_default_params (&params);
+
+    params.effectType = effectType;
+    params.quality = INFATUATION_QUALITY_ECO;
+    params.waveType = 1 + stream % 3;
+    params.noiseType = 1 + (stream / 3) % 3;
+    params.dryWet = 0.2f + 0.6f * (float) (stream % 7) / 6;
+    params.depth = 0.1f + 0.8f * (float) (stream % 11) / 10;
+    params.rate = 0.05f + 0.9f * (float) (stream % 13) / 12;
+    params.phaseOffset = (float) (stream % 5) / 4;
+    params.feedback = 0.9f * (float) (stream % 9) / 8;
+    params.delayTime = 0.01f + 1.9f * (float) (stream % 17) / 16;
+    params.noiseLevel = 0.1f * (float) (stream % 4) / 3;
+
+    return params;
+}
+
+static double renderEngines (const Options& options, std::vector<StreamBuffers>& streams, int numSamples)
+{
+    std::vector<InfatuationHandle> engines;
+
+    for (int stream = 0; stream < options.numStreams; ++stream)
+    {
+        InfatuationHandle engine = infatuation_create (options.sampleRate, options.blockSize);
+
+        if (engine == nullptr)
+        {
+            fprintf (stderr, "infatuation-bench: couldn't allocate engine %d\n", stream);
+            exit (1);
+        }
+
+        InfatuationParams params = getStreamParams (stream, options.effectType);
+        infatuation_set_random_seed (engine, 0x1F47 + stream);
+        infatuation_set_params (engine, &params);
+        infatuation_reset (engine);
+        engines.push_back (engine);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (int position = 0; position < numSamples; position += options.blockSize)
+    {
+        int length = std::min (options.blockSize, numSamples - position);
+
+        for (int stream = 0; stream < options.numStreams; ++stream)
+        {
+            auto& buffers = streams[(size_t) stream];
+            const float* in[] = { buffers.inLeft.data() + position, buffers.inRight.data() + position };
+            float* out[] = { buffers.outLeft.data() + position, buffers.outRight.data() + position };
+
+            infatuation_process (engines[(size_t) stream], in, out, length);
+        }
+    }
+
+    double elapsed = std::chrono::duration<double> (std::chrono::steady_clock::now() - start).count();
+
+    for (auto engine : engines)
+        infatuation_destroy (engine);
+
+    return elapsed;
+}
+
+static double renderBatch (const Options& options, std::vector<StreamBuffers>& streams, int numSamples)
+{
+    InfatuationBatchHandle batch = infatuation_batch_create (options.sampleRate, options.numStreams, options.blockSize);
+
+    if (batch == nullptr)
+    {
+        fprintf (stderr, "infatuation-bench: couldn't allocate the batch\n");
+        exit (1);
+    }
+
+    infatuation_batch_set_effect_type (batch, options.effectType);
+
+    for (int stream = 0; stream < options.numStreams; ++stream)
+    {
+        InfatuationParams params = getStreamParams (stream, options.effectType);
+        infatuation_batch_set_random_seed (batch, stream, 0x1F47 + stream);
+        infatuation_batch_set_params (batch, stream, &params);
+    }
+
+    infatuation_batch_reset (batch);
+
+    std::vector<const float*> inLeft ((size_t) options.numStreams), inRight ((size_t) options.numStreams);
+    std::vector<float*> outLeft ((size_t) options.numStreams), outRight ((size_t) options.numStreams);
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (int position = 0; position < numSamples; position += options.blockSize)
+    {
+        int length = std::min (options.blockSize, numSamples - position);
+
+        for (int stream = 0; stream < options.numStreams; ++stream)
+        {
+            auto& buffers = streams[(size_t) stream];
+            inLeft[(size_t) stream] = buffers.inLeft.data() + position;
+            inRight[(size_t) stream] = buffers.inRight.data() + position;
+            outLeft[(size_t) stream] = buffers.outLeft.data() + position;
+            outRight[(size_t) stream] = buffers.outRight.data() + position;
+        }
+
+        infatuation_batch_process (batch, inLeft.data(), inRight.data(), outLeft.data(), outRight.data(), length);
+    }
+
+    double elapsed = std::chrono::duration<double> (std::chrono::steady_clock::now() - start).count();
+
+    infatuation_batch_destroy (batch);
+
+    return elapsed;
+}
+
+//==============================================================================
+struct Bus
+{
+    std::vector<std::unique_ptr<InfatuationEngine>> engines;
+    std::vector<std::vector<float>> channels;
+    int position = 0;
+    int numSamples = 0;
+};
+
+static void processBusPair (void* context, int pair)
+{
+    auto& bus = *static_cast<Bus*> (context);
+    float* left = bus.channels[(size_t) (2 * pair)].data() + bus.position;
+    float* right = bus.channels[(size_t) (2 * pair + 1)].data() + bus.position;
+
+    bus.engines[(size_t) pair]->process (left, right, left, right, bus.numSamples);
+}
+
+struct BusTiming
+{
+    double meanMicroseconds = 0;
+    double worstMicroseconds = 0;
+};
+
+static BusTiming renderBus (const Options& options, Bus& bus, WorkerPool& pool, int numSamples)
+{
+    BusTiming timing;
+    int numBlocks = 0;
+
+    for (bus.position = 0; bus.position < numSamples; bus.position += options.blockSize)
+    {
+        bus.numSamples = std::min (options.blockSize, numSamples - bus.position);
+
+        auto start = std::chrono::steady_clock::now();
+        pool.run (processBusPair, &bus, (int) bus.engines.size());
+        double microseconds = std::chrono::duration<double, std::micro> (std::chrono::steady_clock::now() - start).count();
+
+        timing.meanMicroseconds += microseconds;
+        timing.worstMicroseconds = std::max (timing.worstMicroseconds, microseconds);
+        ++numBlocks;
+    }
+
+    timing.meanMicroseconds /= std::max (1, numBlocks);
+    return timing;
+}
+
+static void prepareBus (const Options& options, Bus& bus, int numChannels, int numSamples)
+{
+    InfatuationParams params = getStreamParams (0, options.effectType);
+    params.quality = INFATUATION_QUALITY_STANDARD;
+
+    bus.engines.clear();
+    bus.channels.assign ((size_t) numChannels, std::vector<float> ((size_t) numSamples));
+
+    for (int pair = 0; pair < numChannels / 2; ++pair)
+    {
+        bus.engines.emplace_back (new InfatuationEngine());
+        bus.engines.back()->setParameters (params);
+        bus.engines.back()->prepare (options.sampleRate, options.blockSize);
+    }
+
+    for (int channel = 0; channel < numChannels; ++channel)
+        fillWithNoise (bus.channels[(size_t) channel], (unsigned int) channel + 1);
+}
+
+static int runBusBenchmark (const Options& options)
+{
+    int numWorkers = options.numWorkers;
+
+    if (numWorkers < 0)
+        numWorkers = std::min (8, std::max (0, (int) std::thread::hardware_concurrency() - 1));
+
+    WorkerPool inlinePool;
+    WorkerPool workerPool;
+    workerPool.start (numWorkers);
+
+    int numSamples = (int) (options.seconds * options.sampleRate);
+    double budget = 1.0e6 * options.blockSize / options.sampleRate;
+
+    printf ("%d-sample blocks, %.0f us budget, %d workers%s\n", options.blockSize, budget,
+            workerPool.getNumWorkers(), workerPool.hasRealtimePriority() ? " at real-time priority" : "");
+    printf ("channels   inline mean/worst us   pooled mean/worst us   speed-up   inline blocks\n");
+
+    bool allMatched = true;
+
+    for (int numChannels : { 2, 4, 8, 16, 24, 32, 48, 64 })
+    {
+        Bus inlineBus, pooledBus;
+        prepareBus (options, inlineBus, numChannels, numSamples);
+        prepareBus (options, pooledBus, numChannels, numSamples);
+
+        uint64_t inlineBlocksBefore = workerPool.getNumInlineBlocks();
+        uint64_t blocksBefore = workerPool.getNumBlocks();
+
+        BusTiming inlineTiming = renderBus (options, inlineBus, inlinePool, numSamples);
+        BusTiming pooledTiming = renderBus (options, pooledBus, workerPool, numSamples);
+
+        printf ("%8d   %9.1f %10.1f   %9.1f %10.1f   %7.2fx   %5llu / %llu\n", numChannels,
+                inlineTiming.meanMicroseconds, inlineTiming.worstMicroseconds,
+                pooledTiming.meanMicroseconds, pooledTiming.worstMicroseconds,
+                inlineTiming.meanMicroseconds / pooledTiming.meanMicroseconds,
+                (unsigned long long) (workerPool.getNumInlineBlocks() - inlineBlocksBefore),
+                (unsigned long long) (workerPool.getNumBlocks() - blocksBefore));
+
+        if (inlineBus.channels != pooledBus.channels)
+        {
+            printf ("%d channels: the pooled render differs from the inline one\n", numChannels);
+            allMatched = false;
+        }
+    }
+
+    return allMatched ? 0 : 1;
+}
+
+//==============================================================================
+// Counts last-level cache misses on the calling thread, where the kernel lets
+// us; user space only, so it works at the default perf_event_paranoid of 2
+class CacheMissCounter
+{
+public:
+    CacheMissCounter()
+    {
+       #if defined (__linux__)
+        perf_event_attr attributes;
+        memset (&attributes, 0, sizeof (attributes));
+        attributes.size = sizeof (attributes);
+        attributes.type = PERF_TYPE_HW_CACHE;
+        attributes.config = PERF_COUNT_HW_CACHE_LL
+                          | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                          | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        attributes.disabled = 1;
+        attributes.exclude_kernel = 1;
+        attributes.exclude_hv = 1;
+
+        descriptor = (int) syscall (SYS_perf_event_open, &attributes, 0, -1, -1, 0);
+
+        // some CPUs and VMs have no LL cache event, the generic one is close enough
+        if (descriptor < 0)
+        {
+            attributes.type = PERF_TYPE_HARDWARE;
+            attributes.config = PERF_COUNT_HW_CACHE_MISSES;
+            descriptor = (int) syscall (SYS_perf_event_open, &attributes, 0, -1, -1, 0);
+        }
+
+        if (descriptor >= 0)
+            ioctl (descriptor, PERF_EVENT_IOC_ENABLE, 0);
+       #endif
+    }
+
+    ~CacheMissCounter()
+    {
+       #if defined (__linux__)
+        if (descriptor >= 0)
+            close (descriptor);
+       #endif
+    }
+
+    bool isAvailable() const    { return descriptor >= 0; }
+
+    uint64_t read() const
+    {
+        uint64_t count = 0;
+
+       #if defined (__linux__)
+        if (descriptor >= 0 && ::read (descriptor, &count, sizeof (count)) != (ssize_t) sizeof (count))
+            count = 0;
+       #endif
+
+        return count;
+    }
+
+private:
+    int descriptor = -1;
+};
+
+static double getResidentMegabytes()
+{
+   #if defined (__linux__)
+    long totalPages = 0, residentPages = 0;
+
+    if (FILE* statm = fopen ("/proc/self/statm", "r"))
+    {
+        if (fscanf (statm, "%ld %ld", &totalPages, &residentPages) != 2)
+            residentPages = 0;
+
+        fclose (statm);
+    }
+
+    return (double) residentPages * (double) sysconf (_SC_PAGESIZE) / (1024.0 * 1024.0);
+   #elif defined (__APPLE__)
+    // the peak rather than the current size, in bytes here
+    rusage usage;
+    return getrusage (RUSAGE_SELF, &usage) == 0 ? (double) usage.ru_maxrss / (1024.0 * 1024.0) : 0;
+   #elif ! defined (_WIN32)
+    rusage usage;
+    return getrusage (RUSAGE_SELF, &usage) == 0 ? (double) usage.ru_maxrss / 1024.0 : 0;
+   #else
+    return 0;
+   #endif
+}
+
+// What a host keeps per plugin instance: the engine and the track's buffers,
+// each allocated on its own, so they end up spread over the heap as in a session
+struct SoakInstance
+{
+    std::unique_ptr<InfatuationEngine> engine;
+    InfatuationParams params;
+    std::vector<float> left, right;
+    int noiseOffset = 0;
+    int64_t nextChange = 0;
+};
+
+struct SoakResult
+{
+    double cpuMicrosecondsPerBlock = 0;
+    double worstMicroseconds = 0;
+    int numLateBlocks = 0;
+    double residentMegabytes = 0;
+    double cacheMissesPerSample = -1;
+};
+
+// New values for the continuous parameters, as automation or a user would set them
+static void randomiseParams (InfatuationParams& params, std::mt19937& random)
+{
+    std::uniform_real_distribution<float> unit (0.0f, 1.0f);
+
+    params.dryWet = unit (random);
+    params.depth = unit (random);
+    params.rate = unit (random);
+    params.phaseOffset = unit (random);
+    params.feedback = 0.98f * unit (random);
+    params.delayTime = 0.01f + 1.99f * unit (random);
+    params.noiseLevel = 0.1f * unit (random);
+}
+
+static SoakResult runSoak (const Options& options, int numInstances, const std::vector<float>& noise)
+{
+    std::mt19937 random ((unsigned int) numInstances);
+    std::uniform_int_distribution<int> oneToThree (1, 3);
+    std::uniform_int_distribution<int> noiseOffsets (0, (int) noise.size() - options.blockSize - 1);
+    std::uniform_int_distribution<int64_t> changeTimes (1, (int64_t) (2 * SOAK_CHANGE_INTERVAL * options.sampleRate));
+
+    std::vector<std::unique_ptr<SoakInstance>> instances;
+
+    for (int i = 0; i < numInstances; ++i)
+    {
+        auto* instance = new SoakInstance();
+        instances.emplace_back (instance);
+
+        infatuation_default_params (&instance->params);
+        instance->params.effectType = oneToThree (random);
+        instance->params.quality = oneToThree (random);
+        instance->params.waveType = oneToThree (random);
+        instance->params.noiseType = oneToThree (random);
+        randomiseParams (instance->params, random);
+
+        instance->engine.reset (new InfatuationEngine());
+        instance->engine->setRandomSeed (0x1F47 + i);
+        instance->engine->setSmoothing (INFATUATION_SMOOTHING_LINEAR, SOAK_SMOOTHING_TIME);
+        instance->engine->setParameters (instance->params);
+
+        if (! instance->engine->prepare (options.sampleRate, options.blockSize))
+        {
+            fprintf (stderr, "infatuation-bench: couldn't allocate instance %d\n", i);
+            exit (1);
+        }
+
+        instance->left.resize ((size_t) options.blockSize);
+        instance->right.resize ((size_t) options.blockSize);
+        instance->noiseOffset = noiseOffsets (random);
+        instance->nextChange = changeTimes (random);
+    }
+
+    int64_t numSamples = (int64_t) (options.seconds * options.sampleRate);
+    double budget = 1.0e6 * options.blockSize / options.sampleRate;
+
+    SoakResult result;
+    CacheMissCounter cacheMisses;
+    uint64_t cacheMissesBefore = cacheMisses.read();
+    double cpuSeconds = 0;
+    int64_t numBlocks = 0;
+
+    for (int64_t position = 0; position < numSamples; position += options.blockSize)
+    {
+        int length = (int) std::min ((int64_t) options.blockSize, numSamples - position);
+
+        // the host's side of the callback, outside the timing: new input for
+        // every track and whatever automation has moved since the last block
+        for (auto& instance : instances)
+        {
+            memcpy (instance->left.data(), noise.data() + instance->noiseOffset, (size_t) length * sizeof (float));
+            memcpy (instance->right.data(), noise.data() + instance->noiseOffset + 1, (size_t) length * sizeof (float));
+
+            if (position >= instance->nextChange)
+            {
+                randomiseParams (instance->params, random);
+                instance->engine->setParameters (instance->params);
+                instance->nextChange = position + changeTimes (random);
+            }
+        }
+
+        std::clock_t cpuStart = std::clock();
+        auto start = std::chrono::steady_clock::now();
+
+        for (auto& instance : instances)
+        {
+            float* left = instance->left.data();
+            float* right = instance->right.data();
+            instance->engine->process (left, right, left, right, length);
+        }
+
+        double microseconds = std::chrono::duration<double, std::micro> (std::chrono::steady_clock::now() - start).count();
+        cpuSeconds += (double) (std::clock() - cpuStart) / CLOCKS_PER_SEC;
+
+        result.worstMicroseconds = std::max (result.worstMicroseconds, microseconds);
+
+        if (microseconds > budget)
+            ++result.numLateBlocks;
+
+        ++numBlocks;
+    }
+
+    result.cpuMicrosecondsPerBlock = 1.0e6 * cpuSeconds / (double) std::max ((int64_t) 1, numBlocks);
+    result.residentMegabytes = getResidentMegabytes();
+
+    if (cacheMisses.isAvailable())
+        result.cacheMissesPerSample = (double) (cacheMisses.read() - cacheMissesBefore) / ((double) numInstances * (double) numSamples);
+
+    return result;
+}
+
+static int runSoakBenchmark (const Options& options)
+{
+    std::vector<int> counts;
+
+    if (options.numInstances > 0)
+        counts.push_back (options.numInstances);
+    else
+        counts = { 1, 10, 50, 100, 250, 500, 1000 };
+
+    // one long stretch of input that the instances read at different offsets
+    std::vector<float> noise ((size_t) std::max (options.blockSize + 2, (int) options.sampleRate));
+    fillWithNoise (noise, 1);
+
+    double budget = 1.0e6 * options.blockSize / options.sampleRate;
+
+    printf ("%d-sample blocks, %.0f us budget, %g s of audio per count, mixed types and qualities\n",
+            options.blockSize, budget, options.seconds);
+    printf ("instances   cpu us/block   %% budget   worst us   late blocks   RSS MB   LLC misses/sample\n");
+
+    for (int numInstances : counts)
+    {
+        SoakResult result = runSoak (options, numInstances, noise);
+
+        printf ("%9d   %12.1f   %8.1f   %8.1f   %11d   %6.1f   ", numInstances,
+                result.cpuMicrosecondsPerBlock, 100.0 * result.cpuMicrosecondsPerBlock / budget,
+                result.worstMicroseconds, result.numLateBlocks, result.residentMegabytes);
+
+        if (result.cacheMissesPerSample >= 0)
+            printf ("%17.3f\n", result.cacheMissesPerSample);
+        else
+            printf ("%17s\n", "n/a");
+
+        fflush (stdout);
+    }
+
+    return 0;
+}
+
+//==============================================================================
+static void printUsage()
+{
+    fprintf (stderr,
+             "usage: infatuation-bench [options]\n"
+             "  -r, --rate HZ           sample rate (48000)\n"
+             "  -b, --block FRAMES      processing block size (256)\n"
+             "  -n, --streams N         number of stereo streams (64)\n"
+             "  -s, --seconds S         length of audio per stream (10)\n"
+             "  -t, --type TYPE         delay, chorus or flanger (flanger)\n"
+             "      --bus               time wide buses inline and on a worker pool\n"
+             "  -w, --workers N         worker threads for --bus (one per spare core, up to 8)\n"
+             "      --soak              drive many instances with changing parameters, as a host does\n"
+             "  -i, --instances N       only this many instances for --soak (1 to 1000)\n");
+}
+
+static bool parseOptions (int argc, char** argv, Options& options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string option = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        auto takesValue = [&] (const char* shortName, const char* longName)
+        {
+            if (option != shortName && option != longName)
+                return false;
+
+            if (value == nullptr)
+            {
+                fprintf (stderr, "infatuation-bench: %s needs a value\n", longName);
+                exit (1);
+            }
+
+            ++i;
+            return true;
+        };
+
+        if      (takesValue ("-r", "--rate"))       options.sampleRate = atof (value);
+        else if (takesValue ("-b", "--block"))      options.blockSize = atoi (value);
+        else if (takesValue ("-n", "--streams"))    options.numStreams = atoi (value);
+        else if (takesValue ("-s", "--seconds"))    options.seconds = atof (value);
+        else if (takesValue ("-w", "--workers"))    options.numWorkers = atoi (value);
+        else if (takesValue ("-i", "--instances"))  options.numInstances = atoi (value);
+        else if (option == "--bus")                 options.isBusBenchmark = true;
+        else if (option == "--soak")                options.isSoakBenchmark = true;
+        else if (takesValue ("-t", "--type"))
+        {
+            if      (strcmp (value, "delay") == 0)      options.effectType = INFATUATION_DELAY;
+            else if (strcmp (value, "chorus") == 0)     options.effectType = INFATUATION_CHORUS;
+            else if (strcmp (value, "flanger") == 0)    options.effectType = INFATUATION_FLANGER;
+            else return false;
+        }
+        else return false;
+    }
+
+    return options.sampleRate > 0 && options.blockSize > 0 && options.numStreams > 0 && options.seconds > 0
+        && options.numInstances >= 0;
+}
+
+int main (int argc, char** argv)
+{
+    Options options;
+
+    if (! parseOptions (argc, argv, options))
+    {
+        printUsage();
+        return 1;
+    }
+
+    if (options.isBusBenchmark)
+        return runBusBenchmark (options);
+
+    if (options.isSoakBenchmark)
+        return runSoakBenchmark (options);
+
+    int numSamples = (int) (options.seconds * options.sampleRate);
+    std::vector<StreamBuffers> engineStreams ((size_t) options.numStreams);
+
+    for (int stream = 0; stream < options.numStreams; ++stream)
+    {
+        auto& buffers = engineStreams[(size_t) stream];
+
+        for (auto* buffer : { &buffers.inLeft, &buffers.inRight, &buffers.outLeft, &buffers.outRight })
+            buffer->resize ((size_t) numSamples);
+
+        fillWithNoise (buffers.inLeft, 2u * (unsigned int) stream + 1);
+        fillWithNoise (buffers.inRight, 2u * (unsigned int) stream + 2);
+    }
+
+    std::vector<StreamBuffers> batchStreams = engineStreams;
+
+    double engineSeconds = renderEngines (options, engineStreams, numSamples);
+    double batchSeconds = renderBatch (options, batchStreams, numSamples);
+
+    int numMismatched = 0;
+
+    for (int stream = 0; stream < options.numStreams; ++stream)
+    {
+        auto& a = engineStreams[(size_t) stream];
+        auto& b = batchStreams[(size_t) stream];
+
+        if (a.outLeft != b.outLeft || a.outRight != b.outRight)
+            ++numMismatched;
+    }
+
+    double audioSeconds = (double) numSamples / options.sampleRate;
+
+    printf ("%d streams, %.0f s each, %d-sample blocks\n", options.numStreams, audioSeconds, options.blockSize);
+    printf ("engines  %8.3f s  %8.1f streams per core in real time\n", engineSeconds, options.numStreams * audioSeconds / engineSeconds);
+    printf ("batch    %8.3f s  %8.1f streams per core in real time\n", batchSeconds, options.numStreams * audioSeconds / batchSeconds);
+    printf ("speed-up %8.2fx\n", engineSeconds / batchSeconds);
+
+    if (numMismatched > 0)
+    {
+        printf ("%d streams differ between the engines and the batch\n", numMismatched);
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,750 @@
+/*
+  ==============================================================================
+
+    infatuation-daemon
+
+    Runs a live PCM stream through the Infatuation engine. Interleaved audio
+    comes in on stdin (or a Unix domain socket) and the processed audio goes
+    back out on stdout (or the same socket), one fixed-size block at a time.
+    Parameters can be changed while it runs by sending text commands to a
+    control socket. Linux and macOS.
+
+        c++ -std=c++17 -O2 Tools/infatuation-daemon/Main.cpp Source/Core/DSPBuffer.cpp \
+            Source/Core/DSPKernels.cpp Source/Core/InfatuationBatchEngine.cpp \
+            Source/Core/InfatuationCore.cpp Source/Core/InfatuationEngine.cpp \
+            Source/Core/MappedFile.cpp -o infatuation-daemon
+
+        arecord -f FLOAT_LE -c 2 -r 48000 -t raw \
+            | infatuation-daemon --control /tmp/inf.ctl --set "type chorus" \
+            | aplay -f FLOAT_LE -c 2 -r 48000 -t raw
+
+        echo "drywet 0.8" | socat - UNIX-SENDTO:/tmp/inf.ctl
+
+    Latency is bounded by dropping input: if more than --max-latency of
+    audio is waiting to be read, whole frames are skipped until it isn't.
+    A limit of 0 never drops, for feeding it files faster than real time.
+    When the input ends, the frames short of a whole block are processed as
+    one shorter block, so the output is as long as the input. A command
+    with a value outside the range InfatuationCore.h gives is ignored.
+
+    On exit, and whenever it gets SIGUSR1 or a "stats" command, the daemon
+    prints latency percentiles to stderr. "service" is the time from a block
+    being read to its output being written. "end-to-end" adds the block
+    length and the audio still queued behind it. That estimates the worst
+    sample's delay, as long as the producer runs in real time.
+
+  ==============================================================================
+*/
+
+#include "../../Source/Core/InfatuationCore.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <sched.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define HISTOGRAM_RESOLUTION_US 10
+#define HISTOGRAM_BUCKETS 100000    // 10 us buckets up to one second
+
+//==============================================================================
+struct Options
+{
+    double sampleRate = 48000;
+    int numChannels = 2;
+    bool isInt16 = false;
+    int blockSize = 64;
+    double maxLatencyMs = 50;
+    long long seed = 0x1F47;
+    bool useRealtimePriority = false;
+    std::string socketPath;
+    std::string controlPath;
+    std::vector<std::string> commands;
+};
+
+// Fixed-size histogram, so recording a block never allocates
+struct LatencyHistogram
+{
+    std::vector<unsigned int> buckets = std::vector<unsigned int> (HISTOGRAM_BUCKETS + 1, 0);
+    unsigned long long count = 0;
+    double maxMicroseconds = 0;
+
+    void add (double microseconds)
+    {
+        auto bucket = (size_t) (microseconds / HISTOGRAM_RESOLUTION_US);
+        buckets[bucket < HISTOGRAM_BUCKETS ? bucket : HISTOGRAM_BUCKETS]++;
+        count++;
+
+        if (microseconds > maxMicroseconds)
+            maxMicroseconds = microseconds;
+    }
+
+    double getPercentile (double percentile) const
+    {
+        auto target = (unsigned long long) std::ceil (percentile / 100.0 * (double) count);
+        unsigned long long seen = 0;
+
+        for (size_t i = 0; i < buckets.size(); ++i)
+        {
+            seen += buckets[i];
+
+            if (seen >= target && seen > 0)
+                return i < HISTOGRAM_BUCKETS ? std::min ((double) ((i + 1) * HISTOGRAM_RESOLUTION_US), maxMicroseconds) : maxMicroseconds;
+        }
+
+        return 0;
+    }
+
+    void print (const char* name) const
+    {
+        if (count == 0)
+        {
+            fprintf (stderr, "%-11s no blocks\n", name);
+            return;
+        }
+
+        fprintf (stderr, "%-11s p50 %8.0f  p90 %8.0f  p99 %8.0f  p99.9 %8.0f  max %8.0f us\n",
+                 name, getPercentile (50), getPercentile (90), getPercentile (99), getPercentile (99.9), maxMicroseconds);
+    }
+};
+
+static volatile sig_atomic_t shouldQuit = 0;
+static volatile sig_atomic_t shouldReport = 0;
+
+static void handleSignal (int signalNumber)
+{
+    if (signalNumber == SIGUSR1)
+        shouldReport = 1;
+    else
+        shouldQuit = 1;
+}
+
+static double getMicroseconds()
+{
+    using namespace std::chrono;
+    return (double) duration_cast<nanoseconds> (steady_clock::now().time_since_epoch()).count() / 1000.0;
+}
+
+//==============================================================================
+// A name from names, counting from firstValue, or a number from firstValue to lastValue
+static bool parseNamedValue (const char* text, const char* const* names, int firstValue, int lastValue, int& result)
+{
+    for (int i = 0; names[i] != nullptr; ++i)
+    {
+        if (strcmp (text, names[i]) == 0)
+        {
+            result = firstValue + i;
+            return true;
+        }
+    }
+
+    char* end = nullptr;
+    long value = strtol (text, &end, 10);
+
+    if (end == text || *end != 0 || value < firstValue || value > lastValue)
+        return false;
+
+    result = (int) value;
+    return true;
+}
+
+// A number from minimum to maximum, the range InfatuationCore.h gives for the parameter
+static bool parseFloatValue (const char* text, float minimum, float maximum, float& result)
+{
+    char* end = nullptr;
+    float value = strtof (text, &end);
+
+    if (end == text || *end != 0 || ! (value >= minimum && value <= maximum))
+        return false;
+
+    result = value;
+    return true;
+}
+
+// One "name value" or "name=value" command. Returns false, leaving the
+// parameters alone, if it wasn't understood or the value is out of range.
+static bool applyCommand (const char* command, InfatuationParams& params, InfatuationHandle engine,
+                          const LatencyHistogram& service, const LatencyHistogram& endToEnd, unsigned long long numDropped)
+{
+    static const char* const effectNames[] = { "delay", "chorus", "flanger", nullptr };
+    static const char* const waveNames[] = { "sine", "saw", "triangle", nullptr };
+    static const char* const qualityNames[] = { "eco", "standard", "high", nullptr };
+    static const char* const noiseNames[] = { nullptr };
+
+    char line[64] = {};
+    strncpy (line, command, sizeof (line) - 1);
+
+    for (char* c = line; *c != 0; ++c)
+        if (*c == '=')
+            *c = ' ';
+
+    char name[32] = {};
+    char value[32] = {};
+
+    if (sscanf (line, "%31s %31s", name, value) < 1)
+        return true;    // blank line
+
+    if (strcmp (name, "reset") == 0)
+    {
+        infatuation_reset (engine);
+        return true;
+    }
+
+    if (strcmp (name, "stats") == 0)
+    {
+        service.print ("service");
+        endToEnd.print ("end-to-end");
+        fprintf (stderr, "%-11s %llu frames dropped\n", "", numDropped);
+        return true;
+    }
+
+    bool isValid;
+
+    if      (strcmp (name, "type") == 0)        isValid = parseNamedValue (value, effectNames, INFATUATION_DELAY, INFATUATION_FLANGER, params.effectType);
+    else if (strcmp (name, "wave") == 0)        isValid = parseNamedValue (value, waveNames, INFATUATION_WAVE_SINE, INFATUATION_WAVE_TRIANGLE, params.waveType);
+    else if (strcmp (name, "quality") == 0)     isValid = parseNamedValue (value, qualityNames, INFATUATION_QUALITY_ECO, INFATUATION_QUALITY_HIGH, params.quality);
+    else if (strcmp (name, "noise") == 0)       isValid = parseNamedValue (value, noiseNames, 1, 3, params.noiseType);
+    else if (strcmp (name, "drywet") == 0)      isValid = parseFloatValue (value, 0.0f, 1.0f, params.dryWet);
+    else if (strcmp (name, "depth") == 0)       isValid = parseFloatValue (value, 0.0f, 1.0f, params.depth);
+    else if (strcmp (name, "rate") == 0)        isValid = parseFloatValue (value, 0.0f, 1.0f, params.rate);
+    else if (strcmp (name, "phaseoffset") == 0) isValid = parseFloatValue (value, 0.0f, 1.0f, params.phaseOffset);
+    else if (strcmp (name, "feedback") == 0)    isValid = parseFloatValue (value, 0.0f, 0.98f, params.feedback);
+    else if (strcmp (name, "delaytime") == 0)   isValid = parseFloatValue (value, 0.01f, 2.0f, params.delayTime);
+    else if (strcmp (name, "noiselevel") == 0)  isValid = parseFloatValue (value, 0.0f, 1.0f, params.noiseLevel);
+    else return false;
+
+    if (! isValid)
+        return false;
+
+    infatuation_set_params (engine, &params);
+    return true;
+}
+
+static void applyCommands (char* text, InfatuationParams& params, InfatuationHandle engine,
+                           const LatencyHistogram& service, const LatencyHistogram& endToEnd, unsigned long long numDropped)
+{
+    char* savePointer = nullptr;
+
+    for (char* line = strtok_r (text, "\n;", &savePointer); line != nullptr; line = strtok_r (nullptr, "\n;", &savePointer))
+        if (! applyCommand (line, params, engine, service, endToEnd, numDropped))
+            fprintf (stderr, "infatuation-daemon: ignoring \"%s\"\n", line);
+}
+
+//==============================================================================
+// Reads until the buffer is full, the stream ends or there's nothing more to
+// read right now. Returns false on end of stream or error.
+static bool readAvailable (int fileDescriptor, char* buffer, size_t size, size_t& filled)
+{
+    while (filled < size)
+    {
+        ssize_t numRead = read (fileDescriptor, buffer + filled, size - filled);
+
+        if (numRead > 0)
+        {
+            filled += (size_t) numRead;
+            continue;
+        }
+
+        if (numRead < 0 && errno == EINTR)
+            continue;
+
+        if (numRead < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return true;
+
+        return false;
+    }
+
+    return true;
+}
+
+static bool writeAll (int fileDescriptor, const char* buffer, size_t size)
+{
+    while (size > 0)
+    {
+        ssize_t numWritten = write (fileDescriptor, buffer, size);
+
+        if (numWritten < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                pollfd output { fileDescriptor, POLLOUT, 0 };
+                poll (&output, 1, -1);
+                continue;
+            }
+
+            return false;
+        }
+
+        buffer += numWritten;
+        size -= (size_t) numWritten;
+    }
+
+    return true;
+}
+
+static size_t getQueuedBytes (int fileDescriptor)
+{
+    int numBytes = 0;
+    return ioctl (fileDescriptor, FIONREAD, &numBytes) == 0 && numBytes > 0 ? (size_t) numBytes : 0;
+}
+
+//==============================================================================
+class Stream
+{
+public:
+    Stream (const Options& options, InfatuationHandle engine)
+        : mOptions (options),
+          mEngine (engine),
+          mFrameBytes ((size_t) options.numChannels * (options.isInt16 ? sizeof (short) : sizeof (float))),
+          mBlockBytes (mFrameBytes * (size_t) options.blockSize),
+          mMaxQueuedBytes (mFrameBytes * (size_t) (options.maxLatencyMs / 1000.0 * options.sampleRate))
+    {
+        // everything the audio path touches is allocated and locked up front
+        mInput.resize (mBlockBytes);
+        mOutput.resize (mBlockBytes);
+        mLeft.resize ((size_t) options.blockSize);
+        mRight.resize ((size_t) options.blockSize);
+
+        mlock (mInput.data(), mInput.size());
+        mlock (mOutput.data(), mOutput.size());
+        mlock (mLeft.data(), mLeft.size() * sizeof (float));
+        mlock (mRight.data(), mRight.size() * sizeof (float));
+    }
+
+    // Processes whatever is waiting on inputFd. Returns false at end of
+    // stream, after processing any frames left over from the last whole
+    // block as a short one, so every input frame gets an output frame.
+    bool service (int inputFd, int outputFd)
+    {
+        dropExcessInput (inputFd);
+
+        if (! readAvailable (inputFd, mInput.data(), mBlockBytes, mFilled))
+        {
+            flush (outputFd);
+            return false;
+        }
+
+        if (mFilled < mBlockBytes)
+            return true;
+
+        double readTime = getMicroseconds();
+        size_t queuedFrames = getQueuedBytes (inputFd) / mFrameBytes;
+
+        processBlock (mOptions.blockSize);
+        mFilled = 0;
+
+        if (! writeAll (outputFd, mOutput.data(), mBlockBytes))
+            return false;
+
+        double serviceTime = getMicroseconds() - readTime;
+        double bufferedTime = (double) (mOptions.blockSize + (int) queuedFrames) * 1.0e6 / mOptions.sampleRate;
+
+        mServiceLatency.add (serviceTime);
+        mEndToEndLatency.add (serviceTime + bufferedTime);
+        return true;
+    }
+
+    void clear()
+    {
+        mFilled = 0;
+        infatuation_reset (mEngine);
+    }
+
+    const LatencyHistogram& getServiceLatency() const      { return mServiceLatency; }
+    const LatencyHistogram& getEndToEndLatency() const     { return mEndToEndLatency; }
+    unsigned long long getNumDroppedFrames() const         { return mNumDroppedFrames; }
+
+private:
+    void flush (int outputFd)
+    {
+        // a trailing partial frame has nothing to pair it with and is dropped
+        int numFrames = (int) (mFilled / mFrameBytes);
+        mFilled = 0;
+
+        if (numFrames == 0)
+            return;
+
+        processBlock (numFrames);
+        writeAll (outputFd, mOutput.data(), (size_t) numFrames * mFrameBytes);
+    }
+
+    void dropExcessInput (int inputFd)
+    {
+        if (mOptions.maxLatencyMs <= 0)
+            return;
+
+        size_t queued = getQueuedBytes (inputFd);
+
+        if (queued <= mMaxQueuedBytes + mBlockBytes)
+            return;
+
+        // skip whole frames so the stream stays aligned, finishing any block
+        // already started rather than splicing mid-block
+        size_t numToDrop = (queued - mMaxQueuedBytes) / mFrameBytes * mFrameBytes;
+        size_t numDropped = 0;
+
+        while (numDropped < numToDrop)
+        {
+            size_t chunk = numToDrop - numDropped < mBlockBytes ? numToDrop - numDropped : mBlockBytes;
+            ssize_t numRead = read (inputFd, mOutput.data(), chunk);
+
+            if (numRead <= 0)
+                break;
+
+            numDropped += (size_t) numRead;
+        }
+
+        // a short read can leave us mid-frame, so top up to the next frame boundary
+        while (numDropped % mFrameBytes != 0)
+        {
+            ssize_t numRead = read (inputFd, mOutput.data(), mFrameBytes - numDropped % mFrameBytes);
+
+            if (numRead <= 0)
+                break;
+
+            numDropped += (size_t) numRead;
+        }
+
+        mNumDroppedFrames += numDropped / mFrameBytes;
+    }
+
+    void processBlock (int blockSize)
+    {
+        int numChannels = mOptions.numChannels;
+
+        if (mOptions.isInt16)
+        {
+            auto* samples = reinterpret_cast<const short*> (mInput.data());
+
+            for (int i = 0; i < blockSize; ++i)
+            {
+                mLeft[(size_t) i] = samples[i * numChannels] * (1.0f / 32768.0f);
+                mRight[(size_t) i] = samples[i * numChannels + numChannels - 1] * (1.0f / 32768.0f);
+            }
+        }
+        else
+        {
+            auto* samples = reinterpret_cast<const float*> (mInput.data());
+
+            for (int i = 0; i < blockSize; ++i)
+            {
+                mLeft[(size_t) i] = samples[i * numChannels];
+                mRight[(size_t) i] = samples[i * numChannels + numChannels - 1];
+            }
+        }
+
+        const float* in[2] = { mLeft.data(), mRight.data() };
+        float* out[2] = { mLeft.data(), mRight.data() };
+
+        infatuation_process (mEngine, in, out, blockSize);
+
+        // mono streams keep the left output
+        if (mOptions.isInt16)
+        {
+            auto* samples = reinterpret_cast<short*> (mOutput.data());
+
+            for (int i = 0; i < blockSize; ++i)
+            {
+                for (int channel = 0; channel < numChannels; ++channel)
+                {
+                    float sample = (channel == 0 ? mLeft : mRight)[(size_t) i] * 32768.0f;
+                    sample = sample < -32768.0f ? -32768.0f : (sample > 32767.0f ? 32767.0f : sample);
+                    samples[i * numChannels + channel] = (short) std::lrint (sample);
+                }
+            }
+        }
+        else
+        {
+            auto* samples = reinterpret_cast<float*> (mOutput.data());
+
+            for (int i = 0; i < blockSize; ++i)
+                for (int channel = 0; channel < numChannels; ++channel)
+                    samples[i * numChannels + channel] = (channel == 0 ? mLeft : mRight)[(size_t) i];
+        }
+    }
+
+    const Options& mOptions;
+    InfatuationHandle mEngine;
+
+    size_t mFrameBytes;
+    size_t mBlockBytes;
+    size_t mMaxQueuedBytes;
+
+    std::vector<char> mInput;
+    std::vector<char> mOutput;
+    std::vector<float> mLeft;
+    std::vector<float> mRight;
+    size_t mFilled = 0;
+
+    LatencyHistogram mServiceLatency;
+    LatencyHistogram mEndToEndLatency;
+    unsigned long long mNumDroppedFrames = 0;
+};
+
+//==============================================================================
+static int openUnixSocket (const std::string& path, int type)
+{
+    int fileDescriptor = socket (AF_UNIX, type, 0);
+
+    if (fileDescriptor < 0)
+        return -1;
+
+    sockaddr_un address {};
+    address.sun_family = AF_UNIX;
+    strncpy (address.sun_path, path.c_str(), sizeof (address.sun_path) - 1);
+
+    unlink (path.c_str());
+
+    if (bind (fileDescriptor, (sockaddr*) &address, sizeof (address)) != 0
+         || (type == SOCK_STREAM && listen (fileDescriptor, 1) != 0))
+    {
+        close (fileDescriptor);
+        return -1;
+    }
+
+    return fileDescriptor;
+}
+
+static void setNonBlocking (int fileDescriptor)
+{
+    fcntl (fileDescriptor, F_SETFL, fcntl (fileDescriptor, F_GETFL) | O_NONBLOCK);
+}
+
+static void printUsage()
+{
+    fprintf (stderr,
+             "usage: infatuation-daemon [options]\n"
+             "  -r, --rate HZ           sample rate (48000)\n"
+             "  -c, --channels N        1 or 2 interleaved channels (2)\n"
+             "  -f, --format FORMAT     f32 or s16, native byte order (f32)\n"
+             "  -b, --block FRAMES      processing block size (64)\n"
+             "  -l, --max-latency MS    drop input queued beyond this, 0 never drops (50)\n"
+             "  -s, --socket PATH       serve one client at a time on a Unix socket\n"
+             "                          instead of stdin/stdout\n"
+             "  -C, --control PATH      Unix datagram socket for commands\n"
+             "  -e, --set COMMAND       apply a command at startup, e.g. \"type flanger\"\n"
+             "      --seed N            noise generator seed\n"
+             "      --realtime          ask for SCHED_FIFO\n"
+             "\n"
+             "commands, one per line: type delay|chorus|flanger, wave sine|saw|triangle,\n"
+             "quality eco|standard|high, noise 1-3, drywet, depth, rate, phaseoffset,\n"
+             "feedback, delaytime, noiselevel <value>, reset, stats\n");
+}
+
+static bool parseOptions (int argc, char** argv, Options& options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string option = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        auto takesValue = [&] (const char* shortName, const char* longName)
+        {
+            if (option != shortName && option != longName)
+                return false;
+
+            if (value == nullptr)
+            {
+                fprintf (stderr, "infatuation-daemon: %s needs a value\n", longName);
+                exit (1);
+            }
+
+            ++i;
+            return true;
+        };
+
+        if      (takesValue ("-r", "--rate"))           options.sampleRate = atof (value);
+        else if (takesValue ("-c", "--channels"))       options.numChannels = atoi (value);
+        else if (takesValue ("-f", "--format"))         options.isInt16 = strcmp (value, "s16") == 0;
+        else if (takesValue ("-b", "--block"))          options.blockSize = atoi (value);
+        else if (takesValue ("-l", "--max-latency"))    options.maxLatencyMs = atof (value);
+        else if (takesValue ("-s", "--socket"))         options.socketPath = value;
+        else if (takesValue ("-C", "--control"))        options.controlPath = value;
+        else if (takesValue ("-e", "--set"))            options.commands.push_back (value);
+        else if (takesValue ("", "--seed"))             options.seed = atoll (value);
+        else if (option == "--realtime")                options.useRealtimePriority = true;
+        else return false;
+    }
+
+    return options.sampleRate > 0 && (options.numChannels == 1 || options.numChannels == 2)
+            && options.blockSize > 0 && options.maxLatencyMs >= 0;
+}
+
+int main (int argc, char** argv)
+{
+    Options options;
+
+    if (! parseOptions (argc, argv, options))
+    {
+        printUsage();
+        return 1;
+    }
+
+    InfatuationParams params;
+    infatuation_default_params (&params);
+
+    InfatuationHandle engine = infatuation_create (options.sampleRate, options.blockSize);
+
+    if (engine == nullptr)
+    {
+        fprintf (stderr, "infatuation-daemon: couldn't allocate the engine\n");
+        return 1;
+    }
+
+    Stream stream (options, engine);
+
+    infatuation_set_random_seed (engine, options.seed);
+
+    for (auto& command : options.commands)
+    {
+        std::vector<char> text (command.begin(), command.end());
+        text.push_back (0);
+        applyCommands (text.data(), params, engine, stream.getServiceLatency(), stream.getEndToEndLatency(), 0);
+    }
+
+    infatuation_reset (engine);
+
+    signal (SIGINT, handleSignal);
+    signal (SIGTERM, handleSignal);
+    signal (SIGUSR1, handleSignal);
+    signal (SIGPIPE, SIG_IGN);
+
+    if (options.useRealtimePriority)
+    {
+        sched_param priority {};
+        priority.sched_priority = sched_get_priority_min (SCHED_FIFO) + 10;
+
+        if (sched_setscheduler (0, SCHED_FIFO, &priority) != 0)
+            fprintf (stderr, "infatuation-daemon: couldn't get real-time priority: %s\n", strerror (errno));
+    }
+
+    int controlFd = -1;
+
+    if (! options.controlPath.empty())
+    {
+        controlFd = openUnixSocket (options.controlPath, SOCK_DGRAM);
+
+        if (controlFd < 0)
+        {
+            fprintf (stderr, "infatuation-daemon: couldn't open %s: %s\n", options.controlPath.c_str(), strerror (errno));
+            return 1;
+        }
+
+        setNonBlocking (controlFd);
+    }
+
+    int listenFd = -1;
+    int inputFd = STDIN_FILENO;
+    int outputFd = STDOUT_FILENO;
+
+    if (! options.socketPath.empty())
+    {
+        listenFd = openUnixSocket (options.socketPath, SOCK_STREAM);
+
+        if (listenFd < 0)
+        {
+            fprintf (stderr, "infatuation-daemon: couldn't open %s: %s\n", options.socketPath.c_str(), strerror (errno));
+            return 1;
+        }
+
+        inputFd = outputFd = -1;
+    }
+    else
+    {
+        setNonBlocking (inputFd);
+    }
+
+    char controlText[1024];
+
+    while (! shouldQuit)
+    {
+        pollfd fileDescriptors[2];
+        int numFileDescriptors = 0;
+
+        int streamFd = inputFd >= 0 ? inputFd : listenFd;
+        fileDescriptors[numFileDescriptors++] = { streamFd, POLLIN, 0 };
+
+        if (controlFd >= 0)
+            fileDescriptors[numFileDescriptors++] = { controlFd, POLLIN, 0 };
+
+        if (poll (fileDescriptors, (nfds_t) numFileDescriptors, -1) < 0 && errno != EINTR)
+            break;
+
+        if (shouldReport)
+        {
+            shouldReport = 0;
+            char command[] = "stats";
+            applyCommands (command, params, engine, stream.getServiceLatency(), stream.getEndToEndLatency(), stream.getNumDroppedFrames());
+        }
+
+        // parameter changes land between blocks
+        if (controlFd >= 0 && (fileDescriptors[1].revents & POLLIN) != 0)
+        {
+            ssize_t numBytes;
+
+            while ((numBytes = recv (controlFd, controlText, sizeof (controlText) - 1, 0)) > 0)
+            {
+                controlText[numBytes] = 0;
+                applyCommands (controlText, params, engine, stream.getServiceLatency(), stream.getEndToEndLatency(), stream.getNumDroppedFrames());
+            }
+        }
+
+        if ((fileDescriptors[0].revents & (POLLIN | POLLHUP | POLLERR)) == 0)
+            continue;
+
+        if (inputFd < 0)
+        {
+            inputFd = outputFd = accept (listenFd, nullptr, nullptr);
+
+            if (inputFd >= 0)
+                setNonBlocking (inputFd);
+
+            continue;
+        }
+
+        if (! stream.service (inputFd, outputFd))
+        {
+            if (listenFd < 0)
+                break;
+
+            // client went away, wait for the next one with a clean engine
+            close (inputFd);
+            inputFd = outputFd = -1;
+            stream.clear();
+        }
+    }
+
+    char command[] = "stats";
+    applyCommands (command, params, engine, stream.getServiceLatency(), stream.getEndToEndLatency(), stream.getNumDroppedFrames());
+
+    if (listenFd >= 0)
+    {
+        close (listenFd);
+        unlink (options.socketPath.c_str());
+    }
+
+    if (controlFd >= 0)
+    {
+        close (controlFd);
+        unlink (options.controlPath.c_str());
+    }
+
+    infatuation_destroy (engine);
+    return 0;
+}
@@ -0,0 +1,246 @@
+/*
+  ==============================================================================
+
+    infatuation-startup
+
+    Measures what loading a session costs, one step at a time, the way a
+    host goes through them for a template full of instances:
+
+        constructor             creating each processor
+        setStateInformation     restoring the saved session into it
+        first prepareToPlay     allocating and clearing the delay lines
+        second prepareToPlay    the same settings again, which hosts often
+                                send while a session is still loading
+        first blocks            a second of audio through each instance
+        editor open             creating an editor and painting it once
+
+    It needs JUCE, unlike the other tools, so it has its own Projucer
+    console project that compiles the plugin's sources in:
+
+        Projucer --resave Tools/infatuation-startup/InfatuationStartup.jucer
+        make -C Tools/infatuation-startup/Builds/LinuxMakefile CONFIG=Release
+
+        infatuation-startup --instances 200 --type flanger
+
+    Every step runs on all instances before the next one starts, so the
+    numbers include whatever one instance's work costs the next (shared
+    threads, allocator growth) as they would in a host.
+
+    The project builds with INFATUATION_REALTIME_CHECKS=1, so the first
+    blocks also run under the realtime safety checker. Any allocation, lock
+    or blocking call made from processBlock is reported with its stack and
+    the tool exits with status 2, which makes it a regression test for the
+    audio path as well as a timer.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../Source/PluginProcessor.h"
+#include "../../Source/RealtimeSafetyChecker.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+//==============================================================================
+struct Options
+{
+    int numInstances = 200;
+    double sampleRate = 48000;
+    int blockSize = 512;
+    int effectType = INFATUATION_FLANGER;
+    bool shouldOpenEditors = true;
+};
+
+using Processors = std::vector<std::unique_ptr<InfatuationAudioProcessor>>;
+
+template <typename Step>
+static double timeStep (Step&& step)
+{
+    auto start = std::chrono::steady_clock::now();
+    step();
+    return std::chrono::duration<double> (std::chrono::steady_clock::now() - start).count();
+}
+
+static void printStep (const char* name, double seconds, int numInstances)
+{
+    printf ("%-22s %9.2f ms %9.1f us per instance\n", name, seconds * 1.0e3, seconds * 1.0e6 / numInstances);
+}
+
+// What a host would have saved, with the effect type picked on the command line
+static juce::MemoryBlock createSessionState (const Options& options)
+{
+    InfatuationAudioProcessor processor;
+    auto* typeID = dynamic_cast<juce::AudioParameterInt*> (processor.getParameters()[6]);
+
+    if (typeID != nullptr)
+        *typeID = options.effectType;
+
+    juce::MemoryBlock state;
+    processor.getStateInformation (state);
+    return state;
+}
+
+static void processFirstBlocks (Processors& processors, const Options& options)
+{
+    juce::AudioBuffer<float> buffer (2, options.blockSize);
+    juce::MidiBuffer midiMessages;
+    int numBlocks = juce::jmax (1, (int) (options.sampleRate / options.blockSize));
+    juce::Random random (1);
+
+    for (auto& processor : processors)
+    {
+        for (int block = 0; block < numBlocks; ++block)
+        {
+            for (int channel = 0; channel < 2; ++channel)
+                for (int i = 0; i < options.blockSize; ++i)
+                    buffer.setSample (channel, i, random.nextFloat() * 2.0f - 1.0f);
+
+            processor->processBlock (buffer, midiMessages);
+        }
+    }
+}
+
+static void openEditors (Processors& processors)
+{
+    for (auto& processor : processors)
+    {
+        std::unique_ptr<juce::AudioProcessorEditor> editor (processor->createEditorIfNeeded());
+
+        if (editor != nullptr)
+            editor->createComponentSnapshot (editor->getLocalBounds());
+    }
+}
+
+//==============================================================================
+static void printUsage()
+{
+    fprintf (stderr,
+             "usage: infatuation-startup [options]\n"
+             "  -n, --instances N   instances to load (200)\n"
+             "  -r, --rate HZ       sample rate (48000)\n"
+             "  -b, --block N       block size (512)\n"
+             "  -t, --type NAME     delay, chorus or flanger (flanger)\n"
+             "      --no-editor     skip opening the editors\n");
+}
+
+static bool parseOptions (int argc, char** argv, Options& options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string option = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        auto takesValue = [&] (const char* shortName, const char* longName)
+        {
+            if (option != shortName && option != longName)
+                return false;
+
+            if (value == nullptr)
+            {
+                fprintf (stderr, "infatuation-startup: %s needs a value\n", longName);
+                exit (1);
+            }
+
+            ++i;
+            return true;
+        };
+
+        if      (takesValue ("-n", "--instances"))  options.numInstances = atoi (value);
+        else if (takesValue ("-r", "--rate"))       options.sampleRate = atof (value);
+        else if (takesValue ("-b", "--block"))      options.blockSize = atoi (value);
+        else if (option == "--no-editor")           options.shouldOpenEditors = false;
+        else if (takesValue ("-t", "--type"))
+        {
+            if      (strcmp (value, "delay") == 0)      options.effectType = INFATUATION_DELAY;
+            else if (strcmp (value, "chorus") == 0)     options.effectType = INFATUATION_CHORUS;
+            else if (strcmp (value, "flanger") == 0)    options.effectType = INFATUATION_FLANGER;
+            else return false;
+        }
+        else return false;
+    }
+
+    return options.numInstances > 0 && options.sampleRate > 0 && options.blockSize > 0;
+}
+
+int main (int argc, char** argv)
+{
+    Options options;
+
+    if (! parseOptions (argc, argv, options))
+    {
+        printUsage();
+        return 1;
+    }
+
+    // the editors need a message manager, even without a display
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::MemoryBlock state = createSessionState (options);
+    Processors processors;
+    processors.reserve ((size_t) options.numInstances);
+
+    double constructorSeconds = timeStep ([&]
+    {
+        for (int i = 0; i < options.numInstances; ++i)
+            processors.push_back (std::make_unique<InfatuationAudioProcessor>());
+    });
+
+    double stateSeconds = timeStep ([&]
+    {
+        for (auto& processor : processors)
+            processor->setStateInformation (state.getData(), (int) state.getSize());
+    });
+
+    auto prepareAll = [&]
+    {
+        for (auto& processor : processors)
+        {
+            processor->setPlayConfigDetails (2, 2, options.sampleRate, options.blockSize);
+            processor->prepareToPlay (options.sampleRate, options.blockSize);
+        }
+    };
+
+    double firstPrepareSeconds = timeStep (prepareAll);
+    double secondPrepareSeconds = timeStep (prepareAll);
+
+    RealtimeSafetyChecker::resetViolations();
+    double processSeconds = timeStep ([&] { processFirstBlocks (processors, options); });
+    int numViolations = RealtimeSafetyChecker::getNumViolations();
+
+    double editorSeconds = options.shouldOpenEditors ? timeStep ([&] { openEditors (processors); }) : 0;
+
+    double destructorSeconds = timeStep ([&] { processors.clear(); });
+
+    printf ("%d instances, %.0f Hz, %d-sample blocks\n", options.numInstances, options.sampleRate, options.blockSize);
+    printStep ("constructor", constructorSeconds, options.numInstances);
+    printStep ("setStateInformation", stateSeconds, options.numInstances);
+    printStep ("first prepareToPlay", firstPrepareSeconds, options.numInstances);
+    printStep ("second prepareToPlay", secondPrepareSeconds, options.numInstances);
+    printStep ("first blocks", processSeconds, options.numInstances);
+
+    if (options.shouldOpenEditors)
+        printStep ("editor open", editorSeconds, options.numInstances);
+
+    printStep ("destructor", destructorSeconds, options.numInstances);
+
+    double loadSeconds = constructorSeconds + stateSeconds + firstPrepareSeconds + secondPrepareSeconds;
+    printStep ("session load", loadSeconds, options.numInstances);
+
+   #if INFATUATION_REALTIME_CHECKS
+    if (numViolations > 0)
+    {
+        fprintf (stderr, "infatuation-startup: %d realtime safety violations in processBlock\n", numViolations);
+        return 2;
+    }
+   #else
+    juce::ignoreUnused (numViolations);
+   #endif
+
+    return 0;
+}
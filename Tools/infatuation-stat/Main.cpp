@@ -0,0 +1,147 @@
+/*
+  ==============================================================================
+
+    infatuation-stat
+
+    Prints a live table of every Infatuation instance on this machine, read
+    from the shared-memory segments described in Source/StatsSegment.h.
+    Linux only, since that's where POSIX shared memory can be listed.
+
+        c++ -std=c++17 -O2 Tools/infatuation-stat/Main.cpp -o infatuation-stat -lrt
+
+        infatuation-stat            refresh once a second
+        infatuation-stat -1         print one table and exit
+
+  ==============================================================================
+*/
+
+#include "../../Source/StatsSegment.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+struct Instance
+{
+    std::string name;
+    const InfatuationStatsSegment* segment;
+};
+
+static std::vector<Instance> openInstances()
+{
+    std::vector<Instance> instances;
+    DIR* directory = opendir ("/dev/shm");
+
+    if (directory == nullptr)
+        return instances;
+
+    while (auto* entry = readdir (directory))
+    {
+        if (strncmp (entry->d_name, INFATUATION_STATS_PREFIX, strlen (INFATUATION_STATS_PREFIX)) != 0)
+            continue;
+
+        std::string name = std::string ("/") + entry->d_name;
+        int fileDescriptor = shm_open (name.c_str(), O_RDONLY, 0);
+
+        if (fileDescriptor < 0)
+            continue;
+
+        void* address = mmap (nullptr, sizeof (InfatuationStatsSegment), PROT_READ, MAP_SHARED, fileDescriptor, 0);
+        close (fileDescriptor);
+
+        if (address == MAP_FAILED)
+            continue;
+
+        auto* segment = static_cast<const InfatuationStatsSegment*> (address);
+
+        if (segment->magic != INFATUATION_STATS_MAGIC || segment->version != INFATUATION_STATS_VERSION)
+        {
+            munmap (address, sizeof (InfatuationStatsSegment));
+            continue;
+        }
+
+        instances.push_back ({ name, segment });
+    }
+
+    closedir (directory);
+    return instances;
+}
+
+static void closeInstances (std::vector<Instance>& instances)
+{
+    for (auto& instance : instances)
+        munmap ((void*) instance.segment, sizeof (InfatuationStatsSegment));
+
+    instances.clear();
+}
+
+static const char* getEffectName (int effectType)
+{
+    switch (effectType)
+    {
+        case 1:     return "delay";
+        case 2:     return "chorus";
+        case 3:     return "flanger";
+        default:    return "-";
+    }
+}
+
+static void printTable (const std::vector<Instance>& instances)
+{
+    printf ("%8s %5s %8s %12s %9s %10s %10s %10s  %s\n",
+            "pid", "inst", "effect", "blocks", "overruns", "avg us", "max us", "delay KB", "state");
+
+    for (auto& instance : instances)
+    {
+        auto& segment = *instance.segment;
+
+        auto blockCount = segment.blockCount.load (std::memory_order_acquire);
+        auto totalNanoseconds = segment.totalBlockNanoseconds.load (std::memory_order_relaxed);
+        double averageMicroseconds = blockCount > 0 ? (double) totalNanoseconds / (double) blockCount / 1000.0 : 0.0;
+
+        // a segment left behind by a process that crashed
+        bool isAlive = kill (segment.processId, 0) == 0;
+
+        printf ("%8d %5d %8s %12llu %9llu %10.1f %10.1f %10llu  %s\n",
+                segment.processId,
+                segment.instanceId,
+                getEffectName (segment.effectType.load (std::memory_order_relaxed)),
+                (unsigned long long) blockCount,
+                (unsigned long long) segment.overrunCount.load (std::memory_order_relaxed),
+                averageMicroseconds,
+                (double) segment.maxBlockNanoseconds.load (std::memory_order_relaxed) / 1000.0,
+                (unsigned long long) (segment.delayBufferBytes.load (std::memory_order_relaxed) / 1024),
+                ! isAlive ? "dead" : (segment.isIdle.load (std::memory_order_relaxed) ? "idle" : "active"));
+    }
+
+    if (instances.empty())
+        printf ("no Infatuation instances running\n");
+}
+
+int main (int argc, char** argv)
+{
+    bool printOnce = argc > 1 && strcmp (argv[1], "-1") == 0;
+
+    for (;;)
+    {
+        auto instances = openInstances();
+
+        if (! printOnce)
+            printf ("\033[H\033[2J");
+
+        printTable (instances);
+        closeInstances (instances);
+
+        if (printOnce)
+            return 0;
+
+        fflush (stdout);
+        sleep (1);
+    }
+}
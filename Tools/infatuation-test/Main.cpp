@@ -0,0 +1,890 @@
+/*
+  ==============================================================================
+
+    infatuation-test
+
+    Regression test for the core. Renders an impulse, a sine sweep and
+    noise through the delay, chorus and flanger at each quality, with a
+    parameter change half way through so the glides are covered too, and
+    checks every render against the checked-in reference output. Each case
+    is rendered at several block sizes, all of which have to match the
+    reference bit for bit. It also times every type and quality and fails
+    if one takes more nanoseconds per sample than its baseline allows.
+
+    Before any of that, each SIMD variant of the block kernels the CPU can
+    run is checked against the scalar one, bit for bit, over random data
+    of many lengths and alignments. Then every type, wave and quality is
+    started part way through a render with setRenderPosition and a
+    pre-roll, the way the offline renderer starts its chunks, and has to
+    come within RENDER_POSITION_ERROR_BOUND of a render from the start.
+    Each type and quality is also saved to a checkpoint mid-glide and
+    loaded into a fresh engine at another block size, which has to carry
+    on bit for bit; checkpoints from another sample rate or version have
+    to be turned away.
+
+    Every block goes through the engine inside a realtime region of the
+    RealtimeSafetyChecker, which aborts with a stack trace if the engine
+    allocates, locks or blocks there.
+
+        c++ -std=c++17 -O2 -DINFATUATION_REALTIME_CHECKS=1 Tools/infatuation-test/Main.cpp \
+            Source/Core/DSPBuffer.cpp Source/Core/DSPKernels.cpp Source/Core/InfatuationBatchEngine.cpp \
+            Source/Core/InfatuationCore.cpp Source/Core/InfatuationEngine.cpp \
+            Source/Core/MappedFile.cpp Source/Core/WorkerPool.cpp Source/RealtimeSafetyChecker.cpp \
+            -o infatuation-test -pthread -ldl
+
+        infatuation-test
+
+    Run it from the top of the repo, or point --reference at the file. The
+    reference holds a hash and the RMS level of each render, and the ns per
+    sample each type and quality took when it was written. After a change
+    that is meant to alter the output, or on a new benchmark machine,
+    regenerate it with --write and check in the result.
+
+    Exits with 0 if everything matched and nothing was too slow.
+
+  ==============================================================================
+*/
+
+#include "../../Source/Core/InfatuationCore.h"
+#include "../../Source/Core/InfatuationEngine.h"
+#include "../../Source/RealtimeSafetyChecker.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#if ! INFATUATION_REALTIME_CHECKS
+ #error "build with -DINFATUATION_REALTIME_CHECKS=1, see the top of this file"
+#endif
+
+#ifndef M_PI
+ #define M_PI 3.14159265358979323846
+#endif
+
+#define TEST_SAMPLE_RATE 48000
+#define TEST_LENGTH 48000
+#define TEST_SMOOTHING_TIME 0.02
+#define TEST_TIMING_RUNS 3
+
+#define RENDER_POSITION_LENGTH 120000
+#define RENDER_POSITION_ERROR_BOUND 1.0e-4f
+
+// the parameter change comes just before the checkpoint, so it is saved mid-glide
+#define CHECKPOINT_CHANGE_POSITION 29500
+#define CHECKPOINT_POSITION 30011
+#define CHECKPOINT_OTHER_SAMPLE_RATE 44100
+
+static const int blockSizes[] = { 1, 37, 512, 4096 };
+static const int timedBlockSize = 512;
+static const int checkpointBlockSize = 37;
+
+static const char* const typeNames[] = { "", "delay", "chorus", "flanger" };
+static const char* const qualityNames[] = { "", "eco", "standard", "high" };
+static const char* const signalNames[] = { "impulse", "sweep", "noise" };
+static const char* const waveNames[] = { "", "sine", "saw", "triangle" };
+
+// at a rate of 1 Hz the triangle peaks, and the LFO delay is longest, on
+// whole seconds, where a pre-roll that is too short shows up most
+static const int renderPositions[] = { 48000, 60017, 96000 };
+
+//==============================================================================
+struct Options
+{
+    std::string referencePath = "Tools/infatuation-test/reference.txt";
+    bool shouldWrite = false;
+    bool shouldTime = true;
+    double perfTolerance = 2.0;
+};
+
+struct Signal
+{
+    std::vector<float> left, right;
+};
+
+struct Render
+{
+    uint64_t hash = 0;
+    double rms = 0;
+};
+
+static Signal makeSignal (int signal, int length = TEST_LENGTH)
+{
+    Signal result;
+    result.left.assign ((size_t) length, 0.0f);
+    result.right.assign ((size_t) length, 0.0f);
+
+    if (signal == 0)
+    {
+        // a second impulse after the parameter change, to catch the new feedback
+        result.left[0] = 1.0f;
+        result.right[(size_t) TEST_LENGTH / 2] = 1.0f;
+    }
+    else if (signal == 1)
+    {
+        // exponential sweep from 20 Hz to 20 kHz, the right channel a quarter turn on
+        double rate = std::log (1000.0) / TEST_LENGTH;
+        double scale = 2.0 * M_PI * 20.0 / (TEST_SAMPLE_RATE * rate);
+
+        for (int i = 0; i < TEST_LENGTH; ++i)
+        {
+            double phase = scale * (std::exp (rate * i) - 1.0);
+            result.left[(size_t) i] = 0.5f * (float) std::sin (phase);
+            result.right[(size_t) i] = 0.5f * (float) std::cos (phase);
+        }
+    }
+    else
+    {
+        unsigned int seed = 1;
+
+        for (int i = 0; i < length; ++i)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            result.left[(size_t) i] = (float) (seed >> 8) / (float) (1 << 24) - 0.5f;
+            seed = seed * 1664525u + 1013904223u;
+            result.right[(size_t) i] = (float) (seed >> 8) / (float) (1 << 24) - 0.5f;
+        }
+    }
+
+    return result;
+}
+
+static InfatuationParams getParams (int effectType, int quality, bool isChanged)
+{
+    InfatuationParams params;
+    infatuation_default_params (&params);
+
+    params.effectType = effectType;
+    params.quality = quality;
+    params.waveType = INFATUATION_WAVE_SINE;
+    params.noiseType = 2;
+    params.dryWet = 0.5f;
+    params.depth = 0.6f;
+    params.rate = 0.3f;
+    params.phaseOffset = 0.25f;
+    params.feedback = 0.6f;
+    params.delayTime = 0.25f;
+    params.noiseLevel = 0.01f;
+
+    if (isChanged)
+    {
+        params.dryWet = 0.8f;
+        params.depth = 0.3f;
+        params.rate = 0.7f;
+        params.phaseOffset = 0.5f;
+        params.feedback = 0.85f;
+        params.delayTime = 0.4f;
+        params.noiseLevel = 0.02f;
+    }
+
+    return params;
+}
+
+// FNV-1a over the bits of every output sample
+static uint64_t hashSamples (const std::vector<float>& samples, uint64_t hash)
+{
+    for (float sample : samples)
+    {
+        uint32_t bits;
+        memcpy (&bits, &sample, sizeof (bits));
+
+        for (int byte = 0; byte < 4; ++byte)
+        {
+            hash ^= (bits >> (8 * byte)) & 0xff;
+            hash *= 0x100000001b3ULL;
+        }
+    }
+
+    return hash;
+}
+
+static Render render (const Signal& signal, int effectType, int quality, int blockSize, double* seconds = nullptr)
+{
+    InfatuationEngine engine;
+    engine.setRandomSeed (DEFAULT_RANDOM_SEED);
+    engine.setSmoothing (INFATUATION_SMOOTHING_LINEAR, TEST_SMOOTHING_TIME);
+    engine.setParameters (getParams (effectType, quality, false));
+
+    if (! engine.prepare (TEST_SAMPLE_RATE, blockSize))
+    {
+        fprintf (stderr, "infatuation-test: couldn't allocate the engine\n");
+        exit (1);
+    }
+
+    std::vector<float> left = signal.left, right = signal.right;
+
+    auto start = std::chrono::steady_clock::now();
+
+    // the change lands on the same sample whatever the block size
+    for (int position = 0; position < TEST_LENGTH;)
+    {
+        RealtimeSafetyChecker::ScopedRealtimeRegion realtimeRegion;
+
+        if (position == TEST_LENGTH / 2)
+            engine.setParameters (getParams (effectType, quality, true));
+
+        int end = position < TEST_LENGTH / 2 ? TEST_LENGTH / 2 : TEST_LENGTH;
+        int length = std::min (blockSize, end - position);
+
+        engine.process (left.data() + position, right.data() + position,
+                        left.data() + position, right.data() + position, length);
+
+        position += length;
+    }
+
+    if (seconds != nullptr)
+        *seconds = std::chrono::duration<double> (std::chrono::steady_clock::now() - start).count();
+
+    Render result;
+    result.hash = hashSamples (right, hashSamples (left, 0xcbf29ce484222325ULL));
+
+    for (int i = 0; i < TEST_LENGTH; ++i)
+        result.rms += (double) left[(size_t) i] * left[(size_t) i] + (double) right[(size_t) i] * right[(size_t) i];
+
+    result.rms = std::sqrt (result.rms / (2.0 * TEST_LENGTH));
+    return result;
+}
+
+static std::string getCaseName (int effectType, int quality, int signal)
+{
+    return std::string (typeNames[effectType]) + " " + qualityNames[quality] + " " + signalNames[signal];
+}
+
+static std::string getTimingName (int effectType, int quality)
+{
+    return std::string (typeNames[effectType]) + " " + qualityNames[quality];
+}
+
+//==============================================================================
+static void fillRandom (std::vector<float>& buffer, unsigned int& seed, float low, float high)
+{
+    for (auto& sample : buffer)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        sample = low + (high - low) * (float) (seed >> 8) / (float) (1 << 24);
+    }
+}
+
+static bool checkKernel (const char* kernel, InfatuationKernels::Variant variant, int length, int offset,
+                         const std::vector<float>& expected, const std::vector<float>& actual)
+{
+    if (memcmp (expected.data(), actual.data(), expected.size() * sizeof (float)) == 0)
+        return true;
+
+    printf ("FAIL %s %s: differs from scalar at length %d, offset %d\n",
+            InfatuationKernels::getVariantName (variant), kernel, length, offset);
+    return false;
+}
+
+// The generator state one step before state, through the inverse of the
+// multiplier modulo 2^48
+static uint64_t getPreviousRandomState (uint64_t state)
+{
+    const uint64_t multiplier = 0x5deece66dULL;
+
+    // Newton's iteration, each pass doubles the number of correct low bits
+    uint64_t inverse = multiplier;
+
+    for (int i = 0; i < 5; ++i)
+        inverse *= 2 - multiplier * inverse;
+
+    return ((state - 11) * inverse) & 0xffffffffffffULL;
+}
+
+// Runs every kernel of the variant and of the scalar table on the same
+// random input, starting at every offset within a 64-byte line so the
+// unaligned heads and tails are covered, and compares the results.
+static int checkKernelVariant (InfatuationKernels::Variant variant)
+{
+    using namespace InfatuationKernels;
+
+    const KernelTable& scalar = getKernels (Variant::scalar);
+    const KernelTable& kernels = getKernels (variant);
+    const int circularBufferLength = 9973;
+
+    unsigned int seed = 7;
+    std::vector<float> circularBuffer ((size_t) circularBufferLength);
+    fillRandom (circularBuffer, seed, -1.0f, 1.0f);
+
+    int numFailures = 0;
+
+    for (int length : { 0, 1, 3, 7, 8, 15, 16, 17, 31, 33, 63, 64, 65, 127, 500, 1021, 4096 })
+    {
+        for (int offset = 0; offset < 16; ++offset)
+        {
+            size_t size = (size_t) (length + offset);
+            std::vector<float> in (size), wet (size), noise (size), readHeads (size);
+            fillRandom (in, seed, -1.0f, 1.0f);
+            fillRandom (wet, seed, -1.0f, 1.0f);
+            fillRandom (noise, seed, 0.0f, 1.0f);
+            fillRandom (readHeads, seed, 0.0f, (float) circularBufferLength);
+
+            // the last read heads sit right by the end, where the read wraps
+            for (int i = std::max (offset, (int) size - 4); i < (int) size; ++i)
+                readHeads[(size_t) i] = (float) circularBufferLength - 0.25f * (float) ((int) size - i);
+
+            float wetLevel = (float) (seed >> 8) / (float) (1 << 24);
+
+            std::vector<float> expected = in, actual = in;
+            scalar.mixDryWet (expected.data() + offset, wet.data() + offset, noise.data() + offset, wetLevel, length);
+            kernels.mixDryWet (actual.data() + offset, wet.data() + offset, noise.data() + offset, wetLevel, length);
+
+            if (! checkKernel ("mixDryWet", variant, length, offset, expected, actual))
+                ++numFailures;
+
+            std::vector<float> expectedSend (size), actualSend (size);
+            expected = in;
+            actual = in;
+            scalar.mixDryWetSend (expected.data() + offset, expectedSend.data() + offset, wet.data() + offset, noise.data() + offset, wetLevel, length);
+            kernels.mixDryWetSend (actual.data() + offset, actualSend.data() + offset, wet.data() + offset, noise.data() + offset, wetLevel, length);
+
+            if (! checkKernel ("mixDryWetSend", variant, length, offset, expected, actual)
+                || ! checkKernel ("mixDryWetSend", variant, length, offset, expectedSend, actualSend))
+                ++numFailures;
+
+            // started so that value number offset comes out of the top state,
+            // which rounds up to 1 and has to be pulled back below it
+            uint64_t expectedState = 0xffffffffffffULL;
+
+            for (int i = 0; i <= offset; ++i)
+                expectedState = getPreviousRandomState (expectedState);
+
+            uint64_t actualState = expectedState;
+            expected.assign (size, 0.0f);
+            actual.assign (size, 0.0f);
+            scalar.generateRandom (expected.data() + offset, expectedState, length);
+            kernels.generateRandom (actual.data() + offset, actualState, length);
+
+            if (! checkKernel ("generateRandom", variant, length, offset, expected, actual))
+            {
+                ++numFailures;
+            }
+            else if (actualState != expectedState)
+            {
+                printf ("FAIL %s generateRandom: leaves a different state at length %d, offset %d\n",
+                        getVariantName (variant), length, offset);
+                ++numFailures;
+            }
+
+            for (int noiseType = 1; noiseType <= 3; ++noiseType)
+            {
+                float scale = noiseType == 1 ? 1.0f : (noiseType == 2 ? 2.0f : 0.5f);
+                float noiseOffset = noiseType == 1 ? 0.0f : (noiseType == 2 ? -1.0f : -0.25f);
+
+                expected = noise;
+                actual = noise;
+                scalar.shapeNoise (expected.data() + offset, scale, noiseOffset, wetLevel, length);
+                kernels.shapeNoise (actual.data() + offset, scale, noiseOffset, wetLevel, length);
+
+                if (! checkKernel ("shapeNoise", variant, length, offset, expected, actual))
+                    ++numFailures;
+            }
+
+            expected.assign (size, 0.0f);
+            actual.assign (size, 0.0f);
+            scalar.interpolate (expected.data() + offset, circularBuffer.data(), circularBufferLength, readHeads.data() + offset, length);
+            kernels.interpolate (actual.data() + offset, circularBuffer.data(), circularBufferLength, readHeads.data() + offset, length);
+
+            if (! checkKernel ("interpolate", variant, length, offset, expected, actual))
+                ++numFailures;
+        }
+    }
+
+    return numFailures;
+}
+
+static int checkKernelVariants()
+{
+    using namespace InfatuationKernels;
+
+    int numFailures = 0;
+
+    for (Variant variant : { Variant::sse2, Variant::avx2, Variant::avx512 })
+    {
+        // getKernels falls back to a lower table for variants this CPU can't run
+        if (getKernels (variant).variant != variant)
+        {
+            printf ("%-18s skipped, not supported by this CPU\n", getVariantName (variant));
+            continue;
+        }
+
+        int variantFailures = checkKernelVariant (variant);
+        numFailures += variantFailures;
+
+        if (variantFailures == 0)
+            printf ("%-18s matches scalar\n", getVariantName (variant));
+    }
+
+    return numFailures;
+}
+
+//==============================================================================
+static InfatuationParams getRenderPositionParams (int effectType, int waveType, int quality)
+{
+    InfatuationParams params = getParams (effectType, quality, false);
+    params.waveType = waveType;
+    params.depth = 1.0f;
+    params.rate = 1.0f;
+    params.feedback = 0.3f;
+    params.delayTime = 0.1f;
+    return params;
+}
+
+static void prepareEngine (InfatuationEngine& engine, const InfatuationParams& params)
+{
+    engine.setRandomSeed (DEFAULT_RANDOM_SEED);
+    engine.setParameters (params);
+
+    if (! engine.prepare (TEST_SAMPLE_RATE, timedBlockSize))
+    {
+        fprintf (stderr, "infatuation-test: couldn't allocate the engine\n");
+        exit (1);
+    }
+}
+
+static void processRange (InfatuationEngine& engine, const Signal& signal, std::vector<float>& left, std::vector<float>& right,
+                          int start, int end, int blockSize = timedBlockSize)
+{
+    for (int position = start; position < end; position += blockSize)
+    {
+        int length = std::min (blockSize, end - position);
+
+        RealtimeSafetyChecker::ScopedRealtimeRegion realtimeRegion;
+        engine.process (signal.left.data() + position, signal.right.data() + position,
+                        left.data() + position, right.data() + position, length);
+    }
+}
+
+// Starts an engine at each of renderPositions the way a chunk of an offline
+// render is started, after a pre-roll of getStateMemoryInSamples, and
+// compares what it produces from there on with a render from the start.
+static int checkRenderPositions (const Signal& signal)
+{
+    int numFailures = 0;
+    float largestError = 0;
+
+    for (int effectType = INFATUATION_DELAY; effectType <= INFATUATION_FLANGER; ++effectType)
+    {
+        for (int waveType = INFATUATION_WAVE_SINE; waveType <= INFATUATION_WAVE_TRIANGLE; ++waveType)
+        {
+            for (int quality = INFATUATION_QUALITY_ECO; quality <= INFATUATION_QUALITY_HIGH; ++quality)
+            {
+                InfatuationParams params = getRenderPositionParams (effectType, waveType, quality);
+
+                InfatuationEngine serial;
+                prepareEngine (serial, params);
+
+                std::vector<float> serialLeft = signal.left, serialRight = signal.right;
+                processRange (serial, signal, serialLeft, serialRight, 0, RENDER_POSITION_LENGTH);
+
+                for (int position : renderPositions)
+                {
+                    InfatuationEngine chunk;
+                    prepareEngine (chunk, params);
+
+                    int start = position - (int) chunk.getStateMemoryInSamples (RENDER_POSITION_ERROR_BOUND);
+
+                    if (start < 0)
+                    {
+                        printf ("FAIL render position %s %s %s: pre-roll is longer than %d samples\n",
+                                typeNames[effectType], waveNames[waveType], qualityNames[quality], position);
+                        ++numFailures;
+                        continue;
+                    }
+
+                    chunk.setRenderPosition (start);
+
+                    std::vector<float> left = signal.left, right = signal.right;
+                    processRange (chunk, signal, left, right, start, RENDER_POSITION_LENGTH);
+
+                    float error = 0;
+
+                    for (int i = position; i < RENDER_POSITION_LENGTH; ++i)
+                        error = std::max ({ error, std::abs (left[(size_t) i] - serialLeft[(size_t) i]),
+                                            std::abs (right[(size_t) i] - serialRight[(size_t) i]) });
+
+                    largestError = std::max (largestError, error);
+
+                    if (! (error <= RENDER_POSITION_ERROR_BOUND))
+                    {
+                        printf ("FAIL render position %s %s %s from %d: off by %g\n",
+                                typeNames[effectType], waveNames[waveType], qualityNames[quality], position, (double) error);
+                        ++numFailures;
+                    }
+                }
+            }
+        }
+    }
+
+    if (numFailures == 0)
+        printf ("%-18s within %g of a render from the start\n", "render positions", (double) largestError);
+
+    return numFailures;
+}
+
+//==============================================================================
+// Copies the checkpoint at path to copyPath with its version number changed
+static bool writeOtherVersion (const std::string& path, const std::string& copyPath)
+{
+    FILE* file = fopen (path.c_str(), "rb");
+
+    if (file == nullptr)
+        return false;
+
+    std::vector<char> data;
+    char buffer[65536];
+    size_t numRead;
+
+    while ((numRead = fread (buffer, 1, sizeof (buffer), file)) > 0)
+        data.insert (data.end(), buffer, buffer + numRead);
+
+    fclose (file);
+
+    // the version follows the 8-byte magic
+    uint32_t version;
+
+    if (data.size() < 8 + sizeof (version))
+        return false;
+
+    memcpy (&version, data.data() + 8, sizeof (version));
+    ++version;
+    memcpy (data.data() + 8, &version, sizeof (version));
+
+    FILE* copy = fopen (copyPath.c_str(), "wb");
+
+    if (copy == nullptr)
+        return false;
+
+    bool isWritten = fwrite (data.data(), 1, data.size(), copy) == data.size();
+    return fclose (copy) == 0 && isWritten;
+}
+
+// Renders every type and quality straight through, and again with a
+// checkpoint saved part way, in the middle of a glide, and loaded into a
+// fresh engine that goes on in blocks of another size. From the checkpoint
+// on the two have to match bit for bit. Then a checkpoint has to be turned
+// away by an engine at another sample rate, and once its version is changed.
+static int checkCheckpoints (const Signal& signal)
+{
+    const char* directory = getenv ("TMPDIR");
+    std::string path = std::string (directory != nullptr ? directory : "/tmp") + "/infatuation-test.ckpt";
+    std::string otherVersionPath = path + ".version";
+    const size_t remainingBytes = (size_t) (TEST_LENGTH - CHECKPOINT_POSITION) * sizeof (float);
+
+    int numFailures = 0;
+
+    for (int effectType = INFATUATION_DELAY; effectType <= INFATUATION_FLANGER; ++effectType)
+    {
+        for (int quality = INFATUATION_QUALITY_ECO; quality <= INFATUATION_QUALITY_HIGH; ++quality)
+        {
+            InfatuationParams changedParams = getParams (effectType, quality, true);
+
+            InfatuationEngine serial;
+            serial.setSmoothing (INFATUATION_SMOOTHING_LINEAR, TEST_SMOOTHING_TIME);
+            prepareEngine (serial, getParams (effectType, quality, false));
+
+            std::vector<float> serialLeft = signal.left, serialRight = signal.right;
+            processRange (serial, signal, serialLeft, serialRight, 0, CHECKPOINT_CHANGE_POSITION);
+            serial.setParameters (changedParams);
+            processRange (serial, signal, serialLeft, serialRight, CHECKPOINT_CHANGE_POSITION, TEST_LENGTH);
+
+            InfatuationEngine saved;
+            saved.setSmoothing (INFATUATION_SMOOTHING_LINEAR, TEST_SMOOTHING_TIME);
+            prepareEngine (saved, getParams (effectType, quality, false));
+
+            std::vector<float> left = signal.left, right = signal.right;
+            processRange (saved, signal, left, right, 0, CHECKPOINT_CHANGE_POSITION);
+            saved.setParameters (changedParams);
+            processRange (saved, signal, left, right, CHECKPOINT_CHANGE_POSITION, CHECKPOINT_POSITION);
+
+            if (! saved.saveCheckpoint (path.c_str(), CHECKPOINT_POSITION))
+            {
+                printf ("FAIL checkpoint %s %s: couldn't save to %s\n", typeNames[effectType], qualityNames[quality], path.c_str());
+                ++numFailures;
+                continue;
+            }
+
+            InfatuationEngine loaded;
+            int64_t position = 0;
+
+            if (! loaded.prepare (TEST_SAMPLE_RATE, checkpointBlockSize)
+                || ! loaded.loadCheckpoint (path.c_str(), &position) || position != CHECKPOINT_POSITION)
+            {
+                printf ("FAIL checkpoint %s %s: couldn't load it back\n", typeNames[effectType], qualityNames[quality]);
+                ++numFailures;
+                continue;
+            }
+
+            processRange (loaded, signal, left, right, CHECKPOINT_POSITION, TEST_LENGTH, checkpointBlockSize);
+
+            if (memcmp (left.data() + CHECKPOINT_POSITION, serialLeft.data() + CHECKPOINT_POSITION, remainingBytes) != 0
+                || memcmp (right.data() + CHECKPOINT_POSITION, serialRight.data() + CHECKPOINT_POSITION, remainingBytes) != 0)
+            {
+                printf ("FAIL checkpoint %s %s: differs from a render straight through after loading\n",
+                        typeNames[effectType], qualityNames[quality]);
+                ++numFailures;
+            }
+        }
+    }
+
+    // the last checkpoint saved is still at path
+    InfatuationEngine otherSampleRate;
+
+    if (otherSampleRate.prepare (CHECKPOINT_OTHER_SAMPLE_RATE, timedBlockSize) && otherSampleRate.loadCheckpoint (path.c_str()))
+    {
+        printf ("FAIL checkpoint: loaded at %d Hz, saved at %d Hz\n", CHECKPOINT_OTHER_SAMPLE_RATE, TEST_SAMPLE_RATE);
+        ++numFailures;
+    }
+
+    InfatuationEngine otherVersion;
+
+    if (! writeOtherVersion (path, otherVersionPath) || ! otherVersion.prepare (TEST_SAMPLE_RATE, timedBlockSize))
+    {
+        printf ("FAIL checkpoint: couldn't write %s\n", otherVersionPath.c_str());
+        ++numFailures;
+    }
+    else if (otherVersion.loadCheckpoint (otherVersionPath.c_str()) || ! otherVersion.loadCheckpoint (path.c_str()))
+    {
+        printf ("FAIL checkpoint: loaded one with another version number, or turned away the original\n");
+        ++numFailures;
+    }
+
+    remove (path.c_str());
+    remove (otherVersionPath.c_str());
+
+    if (numFailures == 0)
+        printf ("%-18s continue bit for bit at %d-sample blocks\n", "checkpoints", checkpointBlockSize);
+
+    return numFailures;
+}
+
+//==============================================================================
+struct Reference
+{
+    std::map<std::string, Render> renders;
+    std::map<std::string, double> nanosecondsPerSample;
+};
+
+// Lines of "render TYPE QUALITY SIGNAL HASH RMS" and "time TYPE QUALITY NS",
+// anything starting with # is a comment
+static bool readReference (const std::string& path, Reference& reference)
+{
+    FILE* file = fopen (path.c_str(), "r");
+
+    if (file == nullptr)
+        return false;
+
+    char line[256], type[16], quality[16], signal[16];
+    unsigned long long hash;
+    double value;
+
+    while (fgets (line, sizeof (line), file) != nullptr)
+    {
+        if (sscanf (line, "render %15s %15s %15s %llx %lf", type, quality, signal, &hash, &value) == 5)
+            reference.renders[std::string (type) + " " + quality + " " + signal] = Render { (uint64_t) hash, value };
+        else if (sscanf (line, "time %15s %15s %lf", type, quality, &value) == 3)
+            reference.nanosecondsPerSample[std::string (type) + " " + quality] = value;
+    }
+
+    fclose (file);
+    return true;
+}
+
+static bool writeReference (const std::string& path, const Reference& reference)
+{
+    FILE* file = fopen (path.c_str(), "w");
+
+    if (file == nullptr)
+        return false;
+
+    fprintf (file, "# written by infatuation-test --write\n");
+
+    for (auto& entry : reference.renders)
+        fprintf (file, "render %s %016llx %.9g\n", entry.first.c_str(), (unsigned long long) entry.second.hash, entry.second.rms);
+
+    for (auto& entry : reference.nanosecondsPerSample)
+        fprintf (file, "time %s %.2f\n", entry.first.c_str(), entry.second);
+
+    return fclose (file) == 0;
+}
+
+//==============================================================================
+static void printUsage()
+{
+    fprintf (stderr,
+             "usage: infatuation-test [options]\n"
+             "      --reference PATH       reference file (Tools/infatuation-test/reference.txt)\n"
+             "      --write                regenerate the reference instead of checking it\n"
+             "      --no-timing            skip the ns per sample check\n"
+             "      --perf-tolerance X     fail if slower than X times the baseline (2)\n");
+}
+
+static bool parseOptions (int argc, char** argv, Options& options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string option = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        auto takesValue = [&] (const char* longName)
+        {
+            if (option != longName)
+                return false;
+
+            if (value == nullptr)
+            {
+                fprintf (stderr, "infatuation-test: %s needs a value\n", longName);
+                exit (1);
+            }
+
+            ++i;
+            return true;
+        };
+
+        if      (takesValue ("--reference"))        options.referencePath = value;
+        else if (takesValue ("--perf-tolerance"))   options.perfTolerance = atof (value);
+        else if (option == "--write")               options.shouldWrite = true;
+        else if (option == "--no-timing")           options.shouldTime = false;
+        else return false;
+    }
+
+    return options.perfTolerance > 0;
+}
+
+int main (int argc, char** argv)
+{
+    Options options;
+
+    if (! parseOptions (argc, argv, options))
+    {
+        printUsage();
+        return 1;
+    }
+
+    Reference reference;
+
+    if (! options.shouldWrite && ! readReference (options.referencePath, reference))
+    {
+        fprintf (stderr, "infatuation-test: can't read %s\n", options.referencePath.c_str());
+        return 1;
+    }
+
+    // a call that isn't realtime-safe takes the test down with its stack
+    RealtimeSafetyChecker::setAbortOnViolation (true);
+
+    Reference measured;
+    int numRenders = 0;
+    int numFailures = checkKernelVariants();
+
+    std::vector<Signal> signals;
+
+    for (int signal = 0; signal < 3; ++signal)
+        signals.push_back (makeSignal (signal));
+
+    numFailures += checkRenderPositions (makeSignal (2, RENDER_POSITION_LENGTH));
+    numFailures += checkCheckpoints (signals[2]);
+
+    for (int effectType = INFATUATION_DELAY; effectType <= INFATUATION_FLANGER; ++effectType)
+    {
+        for (int quality = INFATUATION_QUALITY_ECO; quality <= INFATUATION_QUALITY_HIGH; ++quality)
+        {
+            for (int signal = 0; signal < 3; ++signal)
+            {
+                std::string name = getCaseName (effectType, quality, signal);
+                Render first = render (signals[(size_t) signal], effectType, quality, blockSizes[0]);
+                measured.renders[name] = first;
+
+                for (int blockSize : blockSizes)
+                {
+                    Render result = (blockSize == blockSizes[0]) ? first : render (signals[(size_t) signal], effectType, quality, blockSize);
+                    ++numRenders;
+
+                    if (result.hash != first.hash)
+                    {
+                        printf ("FAIL %s: %d-sample blocks differ from %d-sample blocks\n", name.c_str(), blockSize, blockSizes[0]);
+                        ++numFailures;
+                    }
+
+                    if (options.shouldWrite)
+                        continue;
+
+                    auto expected = reference.renders.find (name);
+
+                    if (expected == reference.renders.end())
+                    {
+                        printf ("FAIL %s: not in the reference\n", name.c_str());
+                        ++numFailures;
+                        break;
+                    }
+
+                    if (result.hash != expected->second.hash)
+                    {
+                        printf ("FAIL %s at %d-sample blocks: output differs from the reference (RMS %.9g, expected %.9g)\n",
+                                name.c_str(), blockSize, result.rms, expected->second.rms);
+                        ++numFailures;
+                    }
+                }
+            }
+
+            if (! options.shouldTime && ! options.shouldWrite)
+                continue;
+
+            // the best of a few runs over noise, which keeps every path busy
+            double bestSeconds = 1.0e9;
+
+            for (int run = 0; run < TEST_TIMING_RUNS; ++run)
+            {
+                double seconds = 0;
+                render (signals[2], effectType, quality, timedBlockSize, &seconds);
+                bestSeconds = std::min (bestSeconds, seconds);
+            }
+
+            std::string name = getTimingName (effectType, quality);
+            double nanoseconds = 1.0e9 * bestSeconds / TEST_LENGTH;
+            measured.nanosecondsPerSample[name] = nanoseconds;
+
+            if (options.shouldWrite)
+                continue;
+
+            auto baseline = reference.nanosecondsPerSample.find (name);
+
+            if (baseline == reference.nanosecondsPerSample.end())
+            {
+                printf ("FAIL %s: no timing baseline\n", name.c_str());
+                ++numFailures;
+            }
+            else if (nanoseconds > baseline->second * options.perfTolerance)
+            {
+                printf ("FAIL %s: %.1f ns per sample, baseline %.1f\n", name.c_str(), nanoseconds, baseline->second);
+                ++numFailures;
+            }
+            else
+            {
+                printf ("%-18s %8.1f ns per sample, baseline %.1f\n", name.c_str(), nanoseconds, baseline->second);
+            }
+        }
+    }
+
+    if (options.shouldWrite)
+    {
+        if (numFailures > 0 || ! writeReference (options.referencePath, measured))
+        {
+            fprintf (stderr, "infatuation-test: not writing %s\n", options.referencePath.c_str());
+            return 1;
+        }
+
+        printf ("wrote %d renders to %s\n", (int) measured.renders.size(), options.referencePath.c_str());
+        return 0;
+    }
+
+    printf ("%d renders, %d failures, %s kernels\n", numRenders, numFailures,
+            InfatuationKernels::getVariantName (InfatuationKernels::getBestVariant()));
+
+    return numFailures > 0 ? 1 : 0;
+}